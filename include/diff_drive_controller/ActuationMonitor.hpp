@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file ActuationMonitor.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_ACTUATIONMONITOR_HPP
+#define EZW_ROSCONTROLLERS_ACTUATIONMONITOR_HPP
+
+#include "diff_drive_controller/DriveStats.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Confirmation of the setpoints sent to a drive, from the readback of its velocity demand.
+         *        Each new setpoint is kept pending until a readback of the drive shows it applied: the
+         *        velocity demand matches it while the drive is operation enabled. The time from the
+         *        setpoint being sent to this readback is the command-to-actuation latency. Older setpoints
+         *        are superseded by the confirmation of a newer one, the drive may skip them. A setpoint
+         *        still pending after the timeout, extended by the ramp of the drive from its last velocity
+         *        demand, is reported once as unconfirmed.
+         */
+        class ActuationMonitor {
+          public:
+            /**
+             * @brief Class constructor
+             * @param[in, out] stats Statistics of the drive, the latencies and confirmations are recorded in them
+             * @param[in] tolerance_rpm Maximum difference between the velocity demand and the setpoint
+             * @param[in] timeout_ns A setpoint not confirmed within this time is unconfirmed
+             */
+            ActuationMonitor(DriveStats &stats, int32_t tolerance_rpm, int64_t timeout_ns);
+
+            /**
+             * @brief Ramps of the drive in profile velocity mode
+             * @param[in] acceleration_rpm_s, deceleration_rpm_s Ramps of the motor, 0 when the drive applies the setpoints at once
+             */
+            void setRamps(double acceleration_rpm_s, double deceleration_rpm_s);
+
+            /**
+             * @brief A setpoint was accepted by the drive, resending the last one doesn't restart its timing
+             * @param[in] speed_rpm Motor target velocity
+             * @param[in] now_ns Monotonic time it was sent
+             */
+            void command(int32_t speed_rpm, int64_t now_ns);
+
+            /**
+             * @brief Readback of the drive
+             * @param[in] demand_rpm Velocity demand applied by the drive
+             * @param[in] status_word CiA 402 status word
+             * @param[in] now_ns Monotonic time of the readback
+             * @return true if a setpoint just missed its timeout
+             */
+            bool readback(int32_t demand_rpm, uint16_t status_word, int64_t now_ns);
+
+            /**
+             * @brief While halted, the drive doesn't apply its setpoints and none is tracked
+             */
+            void setHalted(bool halted);
+
+            /**
+             * @brief Forget the pending setpoints, when the readbacks are interrupted
+             */
+            void reset();
+
+            /**
+             * @brief Last setpoint which missed its timeout
+             */
+            int32_t unconfirmedSetpoint() const;
+
+            /**
+             * @brief The status word reports the operation enabled state
+             */
+            static bool operationEnabled(uint16_t status_word);
+
+          private:
+            struct Setpoint {
+                int32_t speed_rpm;
+                int64_t sent_ns, timeout_ns;
+            };
+
+            int64_t rampNs(int32_t speed_rpm) const;
+
+            DriveStats &          m_stats;
+            int32_t               m_tolerance_rpm;
+            int64_t               m_timeout_ns;
+            double                m_acceleration_rpm_s = 0.0, m_deceleration_rpm_s = 0.0;
+            std::vector<Setpoint> m_pending; // Oldest first, bounded
+            int32_t               m_last_rpm = 0, m_unconfirmed_rpm = 0, m_demand_rpm = 0;
+            bool                  m_halted = false, m_tracking = false;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_ACTUATIONMONITOR_HPP */
@@ -0,0 +1,86 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file CanopenDrive.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_CANOPENDRIVE_HPP
+#define EZW_ROSCONTROLLERS_CANOPENDRIVE_HPP
+
+#include "diff_drive_controller/CanopenMaster.hpp"
+#include "diff_drive_controller/DriveInterface.hpp"
+
+#include <memory>
+#include <string>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Drive backend talking CANopen to the wheel through a SocketCAN interface,
+         *        without the CANOpen service. The setpoints are sent in RPDO1, the position, the
+         *        status word and the velocity demands come back in TPDO1 and TPDO2 at each SYNC, the
+         *        other objects are reached by expedited SDO. The vl velocity is in motor rpm, the
+         *        position unit is derived from the encoder resolution and the factor group of the drive,
+         *        and the profiled velocities and accelerations are in position units per second and per
+         *        second squared.
+         */
+        class CanopenDrive : public DriveInterface {
+          public:
+            /**
+             * @brief Class constructor
+             * @param[in] master CANopen master of the bus of the wheel
+             * @param[in] node_id Node ID of the drive
+             * @param[in] pdo_max_age_ns The objects are read by SDO when the last TPDO carrying them is older
+             */
+            CanopenDrive(std::shared_ptr<CanopenMaster> master, uint8_t node_id, int64_t pdo_max_age_ns);
+
+            /**
+             * @brief Load the wheel's configuration and map the PDOs of the drive
+             * @param[in] name Name of the wheel, used in the logs
+             * @param[in] config_file Path to the `.ini` configuration file of the wheel
+             * @return ERROR_NONE on success
+             */
+            ezw_error_t init(const std::string &name, const std::string &config_file);
+
+            double getDiameter() const override;
+            double getReduction() const override;
+
+            ezw_error_t getOdometryValue(int32_t &dist_mm) override;
+            ezw_error_t getNMTState(smccore::Controller::NMTState &state) override;
+            ezw_error_t setNMTState(smccore::Controller::NMTCommand command) override;
+            ezw_error_t getPDSState(smccore::Controller::PDSState &state) override;
+            ezw_error_t enterInOperationEnabledState() override;
+            ezw_error_t setHalt(bool halt) override;
+            ezw_error_t setTargetVelocity(int32_t speed_rpm) override;
+            ezw_error_t getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value) override;
+            ezw_error_t getVelocityDemand(int32_t &speed_rpm) override;
+            ezw_error_t getStatusWord(uint16_t &status_word) override;
+            ezw_error_t setOperationMode(OperationMode mode) override;
+            ezw_error_t setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s) override;
+            ezw_error_t startRelativeMove(int32_t distance_mm) override;
+            ezw_error_t setCommunicationTimeout(uint16_t timeout_ms) override;
+            ezw_error_t sendHeartbeat() override;
+
+          private:
+            ezw_error_t getPosition(int64_t &increments); // Accumulated over the wraps of the drive's INT32 position
+            ezw_error_t setControlWord(uint16_t control_word);
+            int32_t     toUnits(double rpm) const; // Motor rpm (or rpm/s) to position units per second (or s^2)
+
+            std::shared_ptr<CanopenMaster> m_master;
+            uint8_t                        m_node_id;
+            int64_t                        m_pdo_max_age_ns;
+            double                         m_diameter_mm = 0.0, m_reduction = 1.0;
+            double                         m_mm_per_increment = 0.0, m_mm_per_unit = 0.0, m_units_per_rpm = 1.0;
+            uint32_t                       m_raw_position     = 0;
+            int64_t                        m_increments       = 0;
+            bool                           m_position_known   = false;
+            uint16_t                       m_control_word     = 0;
+            bool                           m_halt             = false;
+            OperationMode                  m_mode             = OperationMode::VELOCITY;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_CANOPENDRIVE_HPP */
@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file CanopenMaster.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_CANOPENMASTER_HPP
+#define EZW_ROSCONTROLLERS_CANOPENMASTER_HPP
+
+#include "diff_drive_controller/DriveInterface.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Minimal CANopen master on a SocketCAN interface, shared by the drives of a bus.
+         *        It sends the NMT commands, the expedited SDO transfers, the RPDOs and the host
+         *        heartbeat from the calling thread, and produces the SYNC from its own thread.
+         *        A receive thread dispatches the SDO responses to the waiting callers, and keeps
+         *        the last heartbeat and the last TPDO1 and TPDO2 of each node, so reading them never waits
+         *        for the bus.
+         */
+        class CanopenMaster {
+          public:
+            // NMT commands (CiA 301)
+            static constexpr uint8_t NMT_START          = 0x01;
+            static constexpr uint8_t NMT_STOP           = 0x02;
+            static constexpr uint8_t NMT_PREOPERATIONAL = 0x80;
+            static constexpr uint8_t NMT_RESET_NODE     = 0x81;
+            static constexpr uint8_t NMT_RESET_COMM     = 0x82;
+
+            // NMT states reported by the heartbeats
+            static constexpr uint8_t NMT_STATE_BOOTUP         = 0x00;
+            static constexpr uint8_t NMT_STATE_STOPPED        = 0x04;
+            static constexpr uint8_t NMT_STATE_OPERATIONAL    = 0x05;
+            static constexpr uint8_t NMT_STATE_PREOPERATIONAL = 0x7F;
+
+            /**
+             * @brief Class constructor
+             * @param[in] node_id Node ID of the master, in its heartbeats
+             * @param[in] sdo_timeout_ms Time a node has to answer an SDO request
+             */
+            CanopenMaster(uint8_t node_id, int sdo_timeout_ms);
+            ~CanopenMaster();
+
+            /**
+             * @brief Open the interface and start the receive and SYNC threads
+             * @param[in] interface SocketCAN interface, e.g. can0 or vcan0
+             * @param[in] sync_period_ms Period of the SYNC, 0 to not produce it
+             * @return true on success
+             */
+            bool start(const std::string &interface, int sync_period_ms);
+
+            void stop();
+
+            uint8_t            nodeId() const;
+            const std::string &interface() const;
+            int                syncPeriodMs() const;
+
+            ezw_error_t sendNmt(uint8_t command, uint8_t node_id);
+
+            /**
+             * @brief Expedited SDO download, waiting for the node's confirmation
+             * @param[in] size Size of the object in bytes, 1 to 4
+             */
+            ezw_error_t sdoDownload(uint8_t node_id, uint16_t index, uint8_t subindex, uint32_t value, uint8_t size);
+
+            /**
+             * @brief Expedited SDO upload, waiting for the node's response
+             * @param[out] value Value of the object, zero extended
+             */
+            ezw_error_t sdoUpload(uint8_t node_id, uint16_t index, uint8_t subindex, uint32_t &value);
+
+            /**
+             * @brief Send a PDO, without confirmation
+             */
+            ezw_error_t sendPdo(uint16_t cob_id, const uint8_t *data, uint8_t size);
+
+            /**
+             * @brief Heartbeat of the master, refreshing the consumer timeout of the nodes
+             */
+            ezw_error_t sendHeartbeat();
+
+            /**
+             * @brief Last NMT state reported by the heartbeat of a node
+             * @param[in] max_age_ns The state is unknown when the last heartbeat is older
+             * @return false if no heartbeat was received from the node within max_age_ns
+             */
+            bool nmtState(uint8_t node_id, uint8_t &state, int64_t max_age_ns);
+
+            /**
+             * @brief Last TPDO received from a node
+             * @param[in] number Number of the TPDO, 1 or 2
+             * @param[out] data Payload, 8 bytes
+             * @param[in] max_age_ns The PDO is stale when it is older
+             * @return false if no such TPDO was received from the node within max_age_ns
+             */
+            bool tpdo(uint8_t node_id, unsigned number, uint8_t *data, int64_t max_age_ns);
+
+          private:
+            static constexpr unsigned TPDOS = 2; // TPDOs kept for each node
+
+            struct Node {
+                std::mutex              sdo_mtx; // One SDO transaction at a time
+                std::mutex              mtx;     // Protects the fields below, written by the receive thread
+                std::condition_variable sdo_cv;
+                bool                    sdo_waiting = false, sdo_answered = false;
+                uint8_t                 sdo_response[8] = {};
+                uint8_t                 nmt_state       = NMT_STATE_BOOTUP;
+                int64_t                 heartbeat_ns    = 0;
+                uint8_t                 tpdo[TPDOS][8]  = {};
+                int64_t                 tpdo_ns[TPDOS]  = {};
+            };
+
+            void        runReceive();
+            void        runSync();
+            ezw_error_t send(uint32_t cob_id, const uint8_t *data, uint8_t size);
+            ezw_error_t sdoTransfer(uint8_t node_id, const uint8_t *request, uint8_t *response);
+
+            uint8_t               m_node_id;
+            int64_t               m_sdo_timeout_ns;
+            int                   m_socket = -1, m_sync_period_ms = 0;
+            std::string           m_interface;
+            std::array<Node, 128> m_nodes;
+            std::atomic<bool>     m_stop{false};
+            std::thread           m_receive_thread, m_sync_thread;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_CANOPENMASTER_HPP */
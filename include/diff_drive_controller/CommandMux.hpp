@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file CommandMux.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_COMMANDMUX_HPP
+#define EZW_ROSCONTROLLERS_COMMANDMUX_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Priority arbitration between several command sources, like twist_mux.
+         *        A command is executed if its source has the highest priority among the
+         *        sources which are still active, a source being active until its last command
+         *        is older than its timeout. The first declared source wins between sources of
+         *        the same priority. An engaged lock blocks all the sources whose priority isn't
+         *        above its own. A lock is engaged by a true message, and also when its last
+         *        message is older than its timeout, so that a lock whose publisher died stays
+         *        engaged. A timeout of 0 never expires.
+         */
+        class CommandMux {
+          public:
+            /**
+             * @brief Declare a command source
+             * @param[in] name Name recorded with the commands executed from the source
+             * @param[in] priority The highest priority wins
+             * @param[in] timeout_s The source is released when no command was received for this time
+             * @return Index of the source
+             */
+            size_t addSource(const std::string &name, int priority, double timeout_s);
+
+            /**
+             * @brief Declare a lock
+             * @param[in] name Name of the lock
+             * @param[in] priority Sources of a priority lower or equal are blocked while the lock is engaged
+             * @param[in] timeout_s The lock engages when no message was received for this time
+             * @return Index of the lock
+             */
+            size_t addLock(const std::string &name, int priority, double timeout_s);
+
+            /**
+             * @brief Arbitrate a command received from a source
+             * @param[in] source Index of the source
+             * @param[in] now_ns Monotonic time of the command
+             * @return true if the command has to be executed
+             */
+            bool arbitrate(size_t source, int64_t now_ns);
+
+            /**
+             * @brief Update a lock
+             * @param[in] lock Index of the lock
+             * @param[in] locked Value of the lock message
+             * @param[in] now_ns Monotonic time of the message
+             */
+            void setLock(size_t lock, bool locked, int64_t now_ns);
+
+            size_t             sources() const;
+            const std::string &sourceName(size_t source) const;
+
+            /**
+             * @brief Commands of a source executed, and blocked by a higher priority source or a lock
+             */
+            uint64_t executed(size_t source) const;
+            uint64_t overridden(size_t source) const;
+
+          private:
+            struct Input {
+                Input(const std::string &name, int priority, double timeout_s);
+
+                bool expired(int64_t now_ns) const;
+
+                std::string           name;
+                int                   priority;
+                int64_t               timeout_ns;
+                int64_t               stamp_ns = 0;
+                bool                  received = false, locked = false;
+                std::atomic<uint64_t> executed{0}, overridden{0};
+            };
+
+            // The inputs are never moved once declared, their counters are read by other threads
+            std::deque<Input> m_sources, m_locks;
+            std::mutex        m_mtx;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_COMMANDMUX_HPP */
@@ -7,19 +7,47 @@
 #ifndef EZW_ROSCONTROLLERS_DIFFDRIVECONTROLLER_HPP
 #define EZW_ROSCONTROLLERS_DIFFDRIVECONTROLLER_HPP
 
-/* SMC core */
-#include "ezw-smc-core/Config.hpp"
-#include "ezw-smc-core/Controller.hpp"
+#include "diff_drive_controller/ActuationMonitor.hpp"
+#include "diff_drive_controller/CanopenMaster.hpp"
+#include "diff_drive_controller/CommandMux.hpp"
+#include "diff_drive_controller/DriveCharacterisation.hpp"
+#include "diff_drive_controller/DriveInterface.hpp"
+#include "diff_drive_controller/DriveStats.hpp"
+#include "diff_drive_controller/KinematicCalibrator.hpp"
+#include "diff_drive_controller/LoadShedder.hpp"
+#include "diff_drive_controller/MetricsServer.hpp"
+#include "diff_drive_controller/OdometryIntegrator.hpp"
+#include "diff_drive_controller/SerializedMessages.hpp"
+#include "diff_drive_controller/SlipDetector.hpp"
+#include "diff_drive_controller/SpscQueue.hpp"
+#include "diff_drive_controller/StateStore.hpp"
 
+#include <swd_ros_controllers/DriveRampConfig.h>
+#include <swd_ros_controllers/KinematicCalibration.h>
+#include <swd_ros_controllers/OdometryStatus.h>
+#include <swd_ros_controllers/RelativeMoveAction.h>
+#include <swd_ros_controllers/RobotState.h>
 #include <swd_ros_controllers/SafetyFunctions.h>
+#include <swd_ros_controllers/SetOdometry.h>
+#include <swd_ros_controllers/WheelSlip.h>
 
+#include <diagnostic_msgs/DiagnosticStatus.h>
 #include <geometry_msgs/Point.h>
 #include <geometry_msgs/Twist.h>
+#include <sensor_msgs/Imu.h>
 #include <std_msgs/Bool.h>
 #include <std_msgs/String.h>
 
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
+#include <actionlib/server/simple_action_server.h>
+#include <dynamic_reconfigure/server.h>
 #include <ros/node_handle.h>
 #include <ros/timer.h>
 
@@ -42,8 +70,9 @@ namespace ezw
          *   represents respectively the left and right motor speed in (rad/s)
          * - `/node/cmd_vel` of type `geometry_msgs::Twist`: The linear and angular
          *   velocities.
-         * The controller publishes the odometry to `/node/odom` and TFs, the safety
-         * functions to `/node/safety`.
+         * The controller publishes the odometry to `/node/odom` and TFs, the odometry
+         * quality to `/node/odom_status`, the wheel slip events to `/node/wheel_slip`, the safety functions to `/node/safety`,
+         * and all of them from the same control cycle to `/node/robot_state`.
          */
 
         class DiffDriveController {
@@ -54,33 +83,217 @@ namespace ezw
              */
             DiffDriveController(const std::shared_ptr<ros::NodeHandle> nh);
 
+            ~DiffDriveController();
+
           private:
-            ros::Publisher                   m_pub_odom, m_pub_safety;
-            ros::Subscriber                  m_sub_command, m_sub_brake;
+            /**
+             * @brief Integrated pose handed over by the control loop to the publication thread
+             */
+            struct PoseSample {
+                ros::Time stamp;
+                uint32_t  seq;
+                double    x, y, theta, x_err, y_err, theta_err;      // Pose (m, rad) and its standard deviations
+                double    linear, angular, linear_err, angular_err; // Speeds (m/s, rad/s) and their standard deviations
+                bool      tf_due, status_due;                       // The overload policy keeps the TF, the odometry status
+                bool      degraded, left_extrapolated, right_extrapolated, slip;
+                uint64_t  degraded_samples, slip_samples;
+
+                // Rest of the robot state, from the same cycle
+                bool      state_due;
+                double    left_position, right_position, left_velocity, right_velocity; // Raw wheels (m, m/s)
+                int32_t   left_setpoint_rpm, right_setpoint_rpm;
+                int8_t    left_nmt_state, right_nmt_state, left_pds_state, right_pds_state; // -1 when the last read failed
+                bool      safe_torque_off, safe_brake_control, safety_limited_speed, sdi_forward, sdi_backward;
+                ros::Time safety_stamp; // Zero until the safety functions are read
+            };
+
+            ros::Publisher                   m_pub_odom, m_pub_odom_status, m_pub_safety, m_pub_diagnostics, m_pub_calibration, m_pub_wheel_slip, m_pub_tf, m_pub_command_source, m_pub_robot_state;
+            ros::Subscriber                  m_sub_brake, m_sub_imu;
+            ros::ServiceServer               m_srv_set_odometry;
             std::shared_ptr<ros::NodeHandle> m_nh;
             tf2_ros::TransformBroadcaster    m_tf2_br;
 
             // Param
-            double      m_baseline_m, m_left_wheel_diameter_m, m_right_wheel_diameter_m, m_l_motor_reduction, m_r_motor_reduction, m_left_encoder_relative_error, m_right_encoder_relative_error;
+            double      m_baseline_m, m_left_wheel_diameter_m, m_right_wheel_diameter_m, m_l_motor_reduction, m_r_motor_reduction, m_left_encoder_relative_error, m_right_encoder_relative_error, m_extrapolation_relative_error;
+            double      m_extrapolation_max_accel_mps2;
             int         m_pub_freq_hz, m_watchdog_receive_ms, m_left_wheel_polarity, m_max_motor_speed_rpm, m_motor_sls_rpm;
             std::string m_odom_frame, m_base_frame, m_left_config_file, m_right_config_file;
-            bool        m_have_backward_sls, m_publish_odom, m_publish_tf, m_publish_safety, m_nmt_ok, m_pds_ok;
+            bool        m_have_backward_sls, m_publish_odom, m_publish_tf, m_publish_safety, m_publish_robot_state, m_overload_shedding, m_nmt_ok = false, m_pds_ok = false;
+            bool        m_drive_timeout = false; // The drives stop on their own without heartbeat for m_watchdog_receive_ms
+            bool        m_soft_brake    = false; // The drives are halted by the soft brake, they don't apply the setpoints
+            bool        m_left_safety = true, m_right_safety = true; // The wheel's safety functions can be read, not with SocketCAN
+
+            // Health counters, fed by the drives and the control loop, published by the diagnostics thread
+            // and the metrics server. Declared before the drives, which keep a reference on their statistics.
+            DriveStats                     m_left_stats, m_right_stats;
+            LoopStats                      m_loop_stats;
+            CommandStats                   m_command_stats;
+            SafetyStats                    m_safety_stats;
+            RecoveryStats                  m_recovery_stats;
+            uint64_t                       m_reported_inconsistencies = 0;
+            std::thread                    m_diagnostics_thread;
+            std::mutex                     m_diagnostics_mtx;
+            std::condition_variable        m_diagnostics_cv;
+            bool                           m_diagnostics_stop = false;
+            std::unique_ptr<MetricsServer> m_metrics_server;
+
+            ros::Timer                      m_timer_odom, m_timer_watchdog, m_timer_pds, m_timer_safety, m_timer_standby;
+            std::unique_ptr<DriveInterface> m_left_controller, m_right_controller;
 
-            ros::Timer               m_timer_odom, m_timer_watchdog, m_timer_pds, m_timer_safety;
-            ezw::smccore::Controller m_left_controller, m_right_controller;
+            // CANopen masters of the SocketCAN backend, by interface
+            std::map<std::string, std::shared_ptr<CanopenMaster>> m_can_masters;
 
             std::mutex                           m_safety_msg_mtx;
             swd_ros_controllers::SafetyFunctions m_safety_msg;
 
+            // Integrated odometry, only updated atomically under m_odom_mtx
+            std::mutex m_odom_mtx;
+
+            OdometryIntegrator m_integrator;
+
             double  m_x_prev = 0.0, m_y_prev = 0.0, m_theta_prev = 0.0;
             double  m_x_prev_err = 0.0, m_y_prev_err = 0.0, m_theta_prev_err = 0.0;
+            double  m_wheels_heading_offset = 0.0; // Heading integrated from the wheels only, minus the fused one
             int32_t m_dist_left_prev_mm = 0, m_dist_right_prev_mm = 0;
 
+            // Last measured wheel speeds, used to extrapolate a wheel when its encoder can't be read
+            double                m_left_speed_mps = 0.0, m_right_speed_mps = 0.0;
+            uint32_t              m_left_missed_samples = 0, m_right_missed_samples = 0;
+            std::atomic<uint64_t> m_degraded_samples{0};
+            ros::Time             m_odom_prev_stamp;
+            uint32_t              m_odom_seq = 0;
+
+            // Pre-serialised odometry and TF, only the changing fields are patched at each cycle
+            std::unique_ptr<SerializedOdometry>  m_serialized_odom;
+            std::unique_ptr<SerializedTransform> m_serialized_tf;
+
+            // Publication stage, the control loop only queues the integrated poses, they are published by their own
+            // thread so that slow subscribers never delay the next acquisition
+            SpscQueue<PoseSample, 64> m_pose_samples;
+            std::thread               m_publication_thread;
+            std::mutex                m_publication_mtx;
+            std::condition_variable   m_publication_cv;
+            bool                      m_publication_stop = false;
+
+            // Command sources, arbitrated by priority, with a single source when none is configured
+            CommandMux                   m_command_mux;
+            std::vector<ros::Subscriber> m_sub_command_sources, m_sub_command_locks;
+            std::atomic<int>             m_command_source{-1};
+
+            // Last setpoints successfully sent to the drives (motor rpm)
+            int32_t m_left_setpoint_rpm = 0, m_right_setpoint_rpm = 0;
+
+            // Mode of the velocity setpoints, ramped by the drives in profile velocity mode
+            DriveInterface::OperationMode                                                      m_velocity_mode = DriveInterface::OperationMode::VELOCITY;
+            double                                                                             m_drive_acceleration_mps2, m_drive_deceleration_mps2;
+            std::unique_ptr<dynamic_reconfigure::Server<swd_ros_controllers::DriveRampConfig>> m_reconfigure_server;
+
+            // Relative moves, executed by the drives in profile position mode. The travels are counted
+            // in the drives' mm from the start of the move, their targets being relative to it.
+            struct RelativeMove {
+                int32_t   left_start_mm = 0, right_start_mm = 0, left_target_mm = 0, right_target_mm = 0;
+                int32_t   left_travel_mm = 0, right_travel_mm = 0;
+                bool      left_started = false, right_started = false;
+                ros::Time deadline;
+            };
+
+            std::unique_ptr<actionlib::SimpleActionServer<swd_ros_controllers::RelativeMoveAction>> m_move_server;
+            ros::Timer                                                                              m_timer_move;
+            double                                                                                  m_move_speed_mps, m_move_acceleration_mps2;
+            bool                                                                                    m_move_active = false;
+            RelativeMove                                                                            m_move;
+
+            // Actuation readback, only for the backends able to read the drive back
+            std::unique_ptr<ActuationMonitor> m_left_actuation, m_right_actuation;
+            int                               m_actuation_timeout_ms      = 0;
+            uint64_t                          m_left_reported_unconfirmed = 0, m_right_reported_unconfirmed = 0;
+
+            // Hot standby, the state is mirrored in shared memory and only the owner drives the wheels.
+            // The owner's heartbeat is refreshed by its own thread, while the control loop completes its cycles.
+            bool                    m_hot_standby = false;
+            std::atomic<bool>       m_active{true};
+            int                     m_hot_standby_timeout_ms, m_hot_standby_stall_ms;
+            StateStore              m_state_store;
+            std::atomic<int64_t>    m_loop_alive_ns{0};
+            std::thread             m_heartbeat_thread;
+            std::mutex              m_heartbeat_mtx;
+            std::condition_variable m_heartbeat_cv;
+            bool                    m_heartbeat_stop = false;
+
+            // Odometry checkpoint, persisted across restarts
+            StateStore m_checkpoint;
+
+            // Gyro aided heading, the yaw increment integrated at the IMU rate is fused at each odometry step
+            bool              m_use_imu;
+            double            m_imu_gyro_weight, m_imu_yaw_rate_stddev, m_imu_timeout_s;
+            std::mutex        m_imu_mtx;
+            double            m_imu_d_theta = 0.0, m_imu_dt = 0.0, m_imu_yaw_rate = 0.0, m_gyro_bias = 0.0;
+            ros::Time         m_imu_prev_stamp;
+            std::atomic<bool> m_robot_still{true};
+
+            // Online kinematic calibration, the scales correct the wheel diameters
+            std::unique_ptr<KinematicCalibrator> m_calibrator;
+            bool                                 m_calibration_apply;
+            double                               m_nominal_baseline_m, m_left_scale = 1.0, m_right_scale = 1.0;
+
+            // Wheel slip and stall detection, an event is published when the state changes
+            std::unique_ptr<SlipDetector>  m_slip_detector;
+            std::atomic<uint64_t>          m_slip_samples{0};
+            swd_ros_controllers::WheelSlip m_slip_event;
+
+            // Characterisation mode, the test sequence runs in its own thread instead of the control loop
+            std::unique_ptr<DriveCharacterisation> m_characterisation;
+            std::thread                            m_characterisation_thread;
+
+            // Overload policy
+            std::unique_ptr<LoadShedder> m_load_shedder;
+            uint64_t                     m_odom_cycles = 0, m_safety_cycles = 0;
+
+            std::unique_ptr<DriveInterface> makeDrive(const std::string &name, const std::string &config_file, const std::string &backend);
+            std::unique_ptr<DriveInterface> makeCanopenDrive(const std::string &name, const std::string &config_file);
+            void                            publishDiagnostic(const diagnostic_msgs::DiagnosticStatus &status);
+            void                            runHeartbeat();
+            void                            runDiagnostics();
+            void                            runPublication();
+            void                            publishPose(const PoseSample &sample);
+            void                            publishRobotState(const PoseSample &sample);
+            void                            publishHealth();
+            std::string                     renderMetrics();
+            ControllerState                 currentState(const ros::Time &timestamp);
+            void                            restorePose(const ControllerState &state);
+            void                            publishState(const ros::Time &timestamp);
+            void                            restoreCheckpoint(int max_gap_mm);
+            void                            publishWheelSlip(const ros::Time &timestamp, bool yaw_slip, double yaw_rate_error);
+            void                            calibrate(double d_left, double d_right, double d_theta, const ros::Time &timestamp);
+            void                            runCharacterisation(double speed_rpm, int sample_hz, std::string report_file);
+            void                            takeOver(int64_t heartbeat_age_ns);
+            void                            stepDown();
+            void                            startTimers(bool start);
+            void                            applyVelocityMode();
+            bool                            applyDriveRamps();
+            void                            sendHeartbeats();
+
             void setSpeeds(int32_t left_speed, int32_t right_speed);
-            void cbSetSpeed(const geometry_msgs::PointConstPtr &speed);
-            void cbCmdVel(const geometry_msgs::TwistPtr &speed);
+            bool acceptCommand(size_t source);
+            void cbSetSpeed(const geometry_msgs::PointConstPtr &speed, size_t source);
+            void cbCmdVel(const geometry_msgs::TwistConstPtr &speed, size_t source);
+            void cbCommandLock(const std_msgs::Bool::ConstPtr &msg, size_t lock);
             void cbSoftBrake(const std_msgs::Bool::ConstPtr &msg);
-            void cbTimerOdom(), cbWatchdog(), cbTimerStateMachine(), cbTimerSafety();
+            void cbReconfigure(swd_ros_controllers::DriveRampConfig &config, uint32_t level);
+            void cbImu(const sensor_msgs::ImuConstPtr &msg);
+            bool cbSetOdometry(swd_ros_controllers::SetOdometry::Request &req, swd_ros_controllers::SetOdometry::Response &res);
+            void updateLoadShedding(bool deadline_missed);
+            void checkActuation(LoadShedder::Level shed_level);
+            void cbMoveGoal();
+            void cbMovePreempt();
+            void cbTimerMove();
+            bool startMove(const swd_ros_controllers::RelativeMoveGoal &goal, std::string &error);
+            void stopMove();
+
+            swd_ros_controllers::RelativeMoveResult moveResult(const std::string &message) const;
+            void cbTimerOdom(const ros::TimerEvent &event);
+            void cbWatchdog(), cbTimerStateMachine(), cbTimerSafety(), cbTimerStandby();
+            void readSafetyFunction(ezw::smccore::Controller::SafetyFunctionId id, const char *name, bool &res_l, bool &res_r);
         };
     } // namespace swd
 } // namespace ezw
@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file DriveCharacterisation.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_DRIVECHARACTERISATION_HPP
+#define EZW_ROSCONTROLLERS_DRIVECHARACTERISATION_HPP
+
+#include <string>
+#include <vector>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Identification of the drives' speed response.
+         *        The test sequence is a step up and down, followed by a linear chirp from
+         *        `chirp_min_hz` to `chirp_max_hz`, both between 0 and the test speed. The
+         *        commanded speeds and the encoder positions are recorded, then:
+         * - the step is fitted by a first order plus dead time model, on the positions to
+         *   avoid differentiating the encoders' quantization,
+         * - the chirp is cut in segments of two periods, the commanded speed and the position
+         *   are projected on the chirp's phase to get the frequency response, the bandwidth
+         *   is the frequency where the gain drops by 3 dB.
+         */
+        class DriveCharacterisation {
+          public:
+            enum class Wheel
+            {
+                LEFT  = 0,
+                RIGHT = 1
+            };
+
+            struct FrequencyPoint {
+                double frequency_hz, gain, phase_rad;
+            };
+
+            struct Result {
+                bool   step_valid = false;
+                double dead_time_s = 0.0, time_constant_s = 0.0, gain = 0.0, fit_rms_m = 0.0;
+                double model_bandwidth_hz = 0.0; // 1 / (2 pi time_constant)
+                double bandwidth_hz       = 0.0; // Measured on the chirp, 0 if not reached
+
+                std::vector<FrequencyPoint> response;
+            };
+
+            /**
+             * @brief Class constructor
+             * @param[in] step_s Duration of each step level
+             * @param[in] chirp_s Duration of the chirp
+             * @param[in] chirp_min_hz, chirp_max_hz Start and end frequencies of the chirp
+             */
+            DriveCharacterisation(double step_s, double chirp_s, double chirp_min_hz, double chirp_max_hz);
+
+            /**
+             * @brief Total duration of the test sequence
+             */
+            double duration() const;
+
+            /**
+             * @brief Setpoint of the test sequence, normalized in [0, 1]
+             * @param[in] t Time since the start of the sequence
+             */
+            double setpoint(double t) const;
+
+            /**
+             * @brief Record one sample
+             * @param[in] t Time since the start of the sequence
+             * @param[in] left_cmd_mps, right_cmd_mps Speeds actually commanded to the drives
+             * @param[in] left_m, right_m Encoder positions
+             */
+            void record(double t, double left_cmd_mps, double right_cmd_mps, double left_m, double right_m);
+
+            size_t samples() const;
+
+            /**
+             * @brief Mean sampling rate of the recorded samples
+             */
+            double sampleRate() const;
+
+            Result analyse(Wheel wheel) const;
+
+            /**
+             * @brief Write the results as YAML, and the raw samples as CSV next to it
+             */
+            bool writeReport(const std::string &path, const Result &left, const Result &right) const;
+
+          private:
+            struct Sample {
+                double t, cmd_mps[2], position_m[2];
+            };
+
+            double chirpPhase(double t) const;
+            void   analyseStep(Wheel wheel, Result &result) const;
+            void   analyseChirp(Wheel wheel, Result &result) const;
+
+            double              m_step_s, m_chirp_s, m_chirp_min_hz, m_chirp_max_hz;
+            std::vector<Sample> m_samples;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_DRIVECHARACTERISATION_HPP */
@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file DriveInterface.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_DRIVEINTERFACE_HPP
+#define EZW_ROSCONTROLLERS_DRIVEINTERFACE_HPP
+
+/* SMC core */
+#include "ezw-smc-core/Controller.hpp"
+
+#include <cstdint>
+
+// Error codes returned by the in-process backends, outside the range used by the SMC core
+#define DRIVE_ERROR_NOT_READY     static_cast<ezw_error_t>(0x7F01)
+#define DRIVE_ERROR_NOT_SUPPORTED static_cast<ezw_error_t>(0x7F02)
+#define DRIVE_ERROR_TIMEOUT       static_cast<ezw_error_t>(0x7F03)
+#define DRIVE_ERROR_IO            static_cast<ezw_error_t>(0x7F04)
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Interface of a wheel drive backend, the methods follow the
+         *        `ezw::smccore::Controller` API used by the controllers.
+         */
+        class DriveInterface {
+          public:
+            /**
+             * @brief CiA 402 modes of operation (object 0x6060)
+             */
+            enum class OperationMode : int8_t
+            {
+                PROFILE_POSITION = 1,
+                VELOCITY         = 2, // Mode of the velocity setpoints, at startup
+                PROFILE_VELOCITY = 3  // Velocity setpoints ramped by the drive
+            };
+
+            virtual ~DriveInterface() = default;
+
+            /**
+             * @brief Wheel diameter in mm
+             */
+            virtual double getDiameter() const = 0;
+
+            /**
+             * @brief Motor reduction ratio
+             */
+            virtual double getReduction() const = 0;
+
+            /**
+             * @brief Travelled distance of the wheel in mm
+             */
+            virtual ezw_error_t getOdometryValue(int32_t &dist_mm) = 0;
+
+            virtual ezw_error_t getNMTState(smccore::Controller::NMTState &state)  = 0;
+            virtual ezw_error_t setNMTState(smccore::Controller::NMTCommand command) = 0;
+            virtual ezw_error_t getPDSState(smccore::Controller::PDSState &state)  = 0;
+            virtual ezw_error_t enterInOperationEnabledState()                     = 0;
+            virtual ezw_error_t setHalt(bool halt)                                 = 0;
+
+            /**
+             * @brief Set the motor target velocity in rpm
+             */
+            virtual ezw_error_t setTargetVelocity(int32_t speed_rpm) = 0;
+
+            virtual ezw_error_t getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value) = 0;
+
+            /**
+             * @brief Velocity demand applied by the drive in rpm (CiA 402 object 0x606B)
+             */
+            virtual ezw_error_t getVelocityDemand(int32_t &speed_rpm) = 0;
+
+            /**
+             * @brief CiA 402 status word (object 0x6041)
+             */
+            virtual ezw_error_t getStatusWord(uint16_t &status_word) = 0;
+
+            virtual ezw_error_t setOperationMode(OperationMode mode) = 0;
+
+            /**
+             * @brief Motion profile of the profiled modes (objects 0x6081, 0x6083 and 0x6084)
+             * @param[in] velocity_rpm Maximum motor speed of a position move, unused in profile velocity mode
+             * @param[in] acceleration_rpm_s, deceleration_rpm_s Motor accelerations in rpm/s
+             */
+            virtual ezw_error_t setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s) = 0;
+
+            /**
+             * @brief Start a move relative to the current position, in profile position mode (object 0x607A).
+             *        Its completion is reported by the target reached bit of the status word.
+             * @param[in] distance_mm Travel of the wheel, in the unit and direction of getOdometryValue()
+             */
+            virtual ezw_error_t startRelativeMove(int32_t distance_mm) = 0;
+
+            /**
+             * @brief Communication timeout of the drive, the heartbeat consumer time of the host (object 0x1016).
+             *        Without a heartbeat from the host within this time, the drive stops on its own (abort
+             *        connection option, object 0x6007), whatever the state of the host.
+             * @param[in] timeout_ms 0 disables it
+             */
+            virtual ezw_error_t setCommunicationTimeout(uint16_t timeout_ms) = 0;
+
+            /**
+             * @brief Heartbeat of the host, refreshing the communication timeout
+             */
+            virtual ezw_error_t sendHeartbeat() = 0;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_DRIVEINTERFACE_HPP */
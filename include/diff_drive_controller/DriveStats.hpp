@@ -0,0 +1,163 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file DriveStats.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_DRIVESTATS_HPP
+#define EZW_ROSCONTROLLERS_DRIVESTATS_HPP
+
+/* SMC core */
+#include "ezw-smc-core/Controller.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Lock-free latency histogram, with power of two buckets from 1 us to 16 s.
+         *        Recording only increments atomic counters, so it can be done from the control
+         *        loop. The summaries are computed over the window since the previous summary,
+         *        by a single reader thread.
+         */
+        class LatencyHistogram {
+          public:
+            static constexpr int BUCKETS = 24;
+
+            struct Summary {
+                uint64_t count  = 0;
+                double   p50_us = 0.0, p90_us = 0.0, p99_us = 0.0, max_us = 0.0;
+            };
+
+            void record(int64_t ns);
+
+            /**
+             * @brief Counts per bucket and sum of all the recorded durations since the start
+             */
+            void cumulative(uint64_t counts[BUCKETS], int64_t &sum_ns) const;
+
+            /**
+             * @brief Upper bound of a bucket in us
+             */
+            static double upperBoundUs(int bucket);
+
+            /**
+             * @brief Statistics since the previous call, the percentiles are the upper bounds of their buckets
+             * @note Only one thread may call it
+             */
+            Summary summarize();
+
+          private:
+            std::atomic<uint64_t> m_counts[BUCKETS] = {};
+            std::atomic<int64_t>  m_max_ns{0}, m_sum_ns{0};
+            uint64_t              m_previous[BUCKETS] = {};
+        };
+
+        /**
+         * @brief Records the duration of a scope in a histogram
+         */
+        class ScopedLatency {
+          public:
+            explicit ScopedLatency(LatencyHistogram &histogram);
+            ~ScopedLatency();
+
+          private:
+            LatencyHistogram &                    m_histogram;
+            std::chrono::steady_clock::time_point m_start;
+        };
+
+        /**
+         * @brief Lock-free error counters by error code, in a fixed number of slots
+         */
+        class ErrorCounters {
+          public:
+            static constexpr size_t SLOTS = 16;
+
+            void record(ezw_error_t err);
+
+            /**
+             * @brief Copy the (code, count) pairs of the used slots
+             * @return Number of pairs copied
+             */
+            size_t snapshot(std::pair<int32_t, uint64_t> *counters, size_t max) const;
+
+            uint64_t total() const;
+
+            /**
+             * @brief Errors whose code didn't fit in the slots
+             */
+            uint64_t others() const;
+
+          private:
+            std::atomic<int32_t>  m_codes[SLOTS] = {};
+            std::atomic<uint64_t> m_counts[SLOTS] = {};
+            std::atomic<uint64_t> m_total{0}, m_others{0};
+        };
+
+        /**
+         * @brief Health of a drive, fed by its backend calls
+         */
+        struct DriveStats {
+            LatencyHistogram      latency;
+            ErrorCounters         errors;
+            std::atomic<uint64_t> calls{0};
+
+            // Last read states, -1 until read
+            std::atomic<int> nmt_state{-1}, pds_state{-1};
+
+            // Actuation readback, from a setpoint being sent to the velocity demand reaching it
+            LatencyHistogram      actuation;
+            std::atomic<uint64_t> actuation_confirmed{0}, actuation_unconfirmed{0};
+            std::atomic<int32_t>  velocity_demand_rpm{0};
+            std::atomic<int>      status_word{-1};
+        };
+
+        /**
+         * @brief Timing of the control loop
+         */
+        struct LoopStats {
+            LatencyHistogram      lateness, duration;
+            std::atomic<uint64_t> cycles{0}, missed_deadlines{0};
+            std::atomic<uint64_t> publication_drops{0}; // Poses not published, the publication stage lagged a full queue behind
+            std::atomic<int>      shed_level{0};
+        };
+
+        /**
+         * @brief Fate of the velocity commands
+         */
+        struct CommandStats {
+            std::atomic<uint64_t> received{0};
+            std::atomic<uint64_t> suppressed{0}; // Ignored, the controller doesn't drive the wheels
+            std::atomic<uint64_t> overridden{0}; // Blocked by a higher priority source or a lock
+            std::atomic<uint64_t> limited{0};    // Scaled down by a speed limit
+            std::atomic<uint64_t> failed{0};     // Not accepted by a drive
+            std::atomic<uint64_t> timeouts{0};   // Stale, the wheels were stopped by the watchdog
+        };
+
+        /**
+         * @brief Safety functions edges and the controller's reaction to them
+         */
+        struct SafetyStats {
+            std::atomic<uint64_t> edges{0}, sbc_inconsistencies{0}, sto_inconsistencies{0};
+
+            // Time from an edge being read to the next setpoint sent, which applies the new limits
+            LatencyHistogram     reaction;
+            std::atomic<int64_t> pending_edge_ns{0};
+        };
+
+        /**
+         * @brief Recovery events
+         */
+        struct RecoveryStats {
+            std::atomic<uint64_t> failovers{0}, nmt_restarts{0}, pds_restarts{0}, shedding_changes{0};
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_DRIVESTATS_HPP */
@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file InstrumentedDrive.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_INSTRUMENTEDDRIVE_HPP
+#define EZW_ROSCONTROLLERS_INSTRUMENTEDDRIVE_HPP
+
+#include "diff_drive_controller/DriveInterface.hpp"
+#include "diff_drive_controller/DriveStats.hpp"
+
+#include <memory>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Drive decorator measuring the latency of each backend call, counting its
+         *        errors by code, and keeping the last NMT and PDS states read.
+         */
+        class InstrumentedDrive : public DriveInterface {
+          public:
+            /**
+             * @brief Class constructor
+             * @param[in] drive Instrumented backend
+             * @param[in, out] stats Statistics fed by the calls, must outlive the drive
+             */
+            InstrumentedDrive(std::unique_ptr<DriveInterface> drive, DriveStats &stats);
+
+            double getDiameter() const override;
+            double getReduction() const override;
+
+            ezw_error_t getOdometryValue(int32_t &dist_mm) override;
+            ezw_error_t getNMTState(smccore::Controller::NMTState &state) override;
+            ezw_error_t setNMTState(smccore::Controller::NMTCommand command) override;
+            ezw_error_t getPDSState(smccore::Controller::PDSState &state) override;
+            ezw_error_t enterInOperationEnabledState() override;
+            ezw_error_t setHalt(bool halt) override;
+            ezw_error_t setTargetVelocity(int32_t speed_rpm) override;
+            ezw_error_t getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value) override;
+            ezw_error_t getVelocityDemand(int32_t &speed_rpm) override;
+            ezw_error_t getStatusWord(uint16_t &status_word) override;
+            ezw_error_t setOperationMode(OperationMode mode) override;
+            ezw_error_t setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s) override;
+            ezw_error_t startRelativeMove(int32_t distance_mm) override;
+            ezw_error_t setCommunicationTimeout(uint16_t timeout_ms) override;
+            ezw_error_t sendHeartbeat() override;
+
+          private:
+            template <typename Call>
+            ezw_error_t measure(Call call);
+
+            std::unique_ptr<DriveInterface> m_drive;
+            DriveStats &                    m_stats;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_INSTRUMENTEDDRIVE_HPP */
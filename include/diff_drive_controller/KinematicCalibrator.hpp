@@ -0,0 +1,71 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file KinematicCalibrator.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_KINEMATICCALIBRATOR_HPP
+#define EZW_ROSCONTROLLERS_KINEMATICCALIBRATOR_HPP
+
+#include <cstdint>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Online estimation of the effective baseline and wheel diameters of a
+         *        differential drive robot, from the heading increments measured by a gyro.
+         *        With kl, kr the correction factors of the left and right wheel diameters
+         *        and b the effective baseline, the heading increment is:
+         *            d_theta = (kr * d_right - kl * d_left) / b = a * d_right - c * d_left
+         *        (a, c) is estimated by recursive least squares with exponential forgetting.
+         *        Only the ratio kr / kl is observable from the heading, the mean scale
+         *        (kl + kr) / 2 is assumed to be 1.
+         */
+        class KinematicCalibrator {
+          public:
+            /**
+             * @brief Class constructor
+             * @param[in] baseline_m Nominal baseline, used as initial estimate
+             * @param[in] forgetting_factor RLS forgetting factor in ]0, 1]
+             * @param[in] min_travel_m Wheel travel accumulated before each RLS update,
+             *            it averages the encoders quantization out
+             */
+            KinematicCalibrator(double baseline_m, double forgetting_factor, double min_travel_m);
+
+            /**
+             * @brief Account for one odometry step
+             * @param[in] d_left Raw left wheel displacement in m
+             * @param[in] d_right Raw right wheel displacement in m
+             * @param[in] d_theta Gyro heading increment over the same interval in rad
+             * @return true if the estimate has been updated
+             */
+            bool update(double d_left, double d_right, double d_theta);
+
+            /**
+             * @brief Restart the accumulation of the current step, e.g. on a gap of gyro data
+             */
+            void discard();
+
+            double   baseline() const;
+            double   leftScale() const;
+            double   rightScale() const;
+            uint32_t samples() const;
+
+            /**
+             * @brief The estimate is settled enough to be applied
+             */
+            bool converged() const;
+
+          private:
+            double   m_lambda, m_min_travel_m;
+            double   m_a, m_c;             // Estimated parameters
+            double   m_p[2][2];            // Covariance of the estimate
+            double   m_acc_left = 0.0, m_acc_right = 0.0, m_acc_theta = 0.0;
+            uint32_t m_samples  = 0;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_KINEMATICCALIBRATOR_HPP */
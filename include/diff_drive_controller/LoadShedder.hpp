@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file LoadShedder.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_LOADSHEDDER_HPP
+#define EZW_ROSCONTROLLERS_LOADSHEDDER_HPP
+
+#include <cstdint>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Overload policy of the control loop.
+         *        Deadline misses of the control loop are counted over windows of a fixed
+         *        number of cycles. When the ratio of missed deadlines in a window exceeds
+         *        the configured threshold, the shedding level is raised by one step. The
+         *        level is lowered by one step after a number of consecutive windows without
+         *        any missed deadline.
+         */
+        class LoadShedder {
+          public:
+            enum class Level
+            {
+                NOMINAL          = 0, // Everything runs at its configured rate
+                SHED_TF          = 1, // TF is decimated
+                SHED_SAFETY_RATE = 2, // Safety functions other than the SLS are polled and published at a lower rate
+                SHED_TELEMETRY   = 3  // Nominal odometry status samples are dropped
+            };
+
+            /**
+             * @brief Class constructor
+             * @param[in] window_cycles Number of control cycles of an observation window
+             * @param[in] miss_ratio Ratio of missed deadlines in a window above which the level is raised
+             * @param[in] recover_windows Number of consecutive clean windows before the level is lowered
+             */
+            LoadShedder(uint32_t window_cycles, double miss_ratio, uint32_t recover_windows);
+
+            /**
+             * @brief Account for one control cycle
+             * @param[in] deadline_missed The cycle missed its deadline
+             * @return true if the shedding level changed
+             */
+            bool update(bool deadline_missed);
+
+            Level level() const;
+
+            /**
+             * @brief Ratio of missed deadlines in the last complete window
+             */
+            double lastMissRatio() const;
+
+            static const char *levelName(Level level);
+
+          private:
+            uint32_t m_window_cycles, m_recover_windows;
+            double   m_miss_ratio;
+            uint32_t m_cycles = 0, m_misses = 0, m_clean_windows = 0;
+            double   m_last_miss_ratio = 0.0;
+            Level    m_level           = Level::NOMINAL;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_LOADSHEDDER_HPP */
@@ -0,0 +1,56 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file MetricsServer.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_METRICSSERVER_HPP
+#define EZW_ROSCONTROLLERS_METRICSSERVER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Minimal HTTP/1.0 listener serving metrics in the Prometheus text format on
+         *        `GET /metrics`. Requests are served one at a time from a low priority thread,
+         *        the metrics are rendered on each scrape.
+         */
+        class MetricsServer {
+          public:
+            /**
+             * @brief Class constructor
+             * @param[in] render Renders the metrics, called from the server thread
+             */
+            explicit MetricsServer(std::function<std::string()> render);
+            ~MetricsServer();
+
+            /**
+             * @brief Listen on the given address and start serving
+             * @param[in] address IPv4 address to bind, e.g. 127.0.0.1 to stay local
+             * @param[in] port TCP port
+             * @return true on success
+             */
+            bool start(const std::string &address, uint16_t port);
+
+            void stop();
+
+          private:
+            void run();
+            void serve(int client);
+
+            std::function<std::string()> m_render;
+            int                          m_fd = -1;
+            std::atomic<bool>            m_stop{false};
+            std::thread                  m_thread;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_METRICSSERVER_HPP */
@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file OdometryIntegrator.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_ODOMETRYINTEGRATOR_HPP
+#define EZW_ROSCONTROLLERS_ODOMETRYINTEGRATOR_HPP
+
+#include <string>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Planar pose of the base, and its standard deviations
+         */
+        struct OdometryPose {
+            double x = 0.0, y = 0.0, theta = 0.0;
+            double x_err = 0.0, y_err = 0.0, theta_err = 0.0;
+        };
+
+        /**
+         * @brief Integration of the differential drive kinematic model, one encoder sample at a time.
+         *        The schemes differ by the heading the displacement of a step is projected with:
+         *        - EULER: the heading at the start of the step,
+         *        - MIDPOINT: the mean heading over the step,
+         *        - EXACT: the arc of circle travelled at constant wheel speeds over the step.
+         *        The uncertainty is propagated to first order with the heading of the scheme.
+         */
+        class OdometryIntegrator {
+          public:
+            enum class Scheme
+            {
+                EULER    = 0,
+                MIDPOINT = 1,
+                EXACT    = 2
+            };
+
+            explicit OdometryIntegrator(Scheme scheme = Scheme::EULER);
+
+            /**
+             * @brief Displacement of the base center and heading increment from the wheels' displacements
+             * @param[in] d_left, d_right Wheels displacements (m)
+             * @param[in] d_left_err, d_right_err Their standard deviations (m)
+             * @param[in] baseline Distance between the wheels (m)
+             * @param[out] d_center, d_theta Center displacement (m) and heading increment (rad)
+             * @param[out] d_center_err, d_theta_err Their standard deviations
+             */
+            static void kinematics(double d_left, double d_right, double d_left_err, double d_right_err, double baseline, double &d_center, double &d_theta,
+                                   double &d_center_err, double &d_theta_err);
+
+            /**
+             * @brief Integrate one step
+             * @param[in] prev Pose at the start of the step
+             * @param[in] d_center, d_theta Center displacement (m) and heading increment (rad) over the step
+             * @param[in] d_center_err, d_theta_err Their standard deviations
+             * @return Pose at the end of the step, the heading bounded to [-pi, pi]
+             */
+            OdometryPose step(const OdometryPose &prev, double d_center, double d_theta, double d_center_err, double d_theta_err) const;
+
+            Scheme scheme() const;
+
+            static const char *schemeName(Scheme scheme);
+
+            /**
+             * @brief Scheme from its name, as returned by schemeName()
+             * @return false if the name is unknown
+             */
+            static bool parseScheme(const std::string &name, Scheme &scheme);
+
+          private:
+            Scheme m_scheme;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_ODOMETRYINTEGRATOR_HPP */
@@ -0,0 +1,178 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SerializedMessages.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_SERIALIZEDMESSAGES_HPP
+#define EZW_ROSCONTROLLERS_SERIALIZEDMESSAGES_HPP
+
+#include <nav_msgs/Odometry.h>
+#include <tf2_msgs/TFMessage.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <ros/serialization.h>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Message kept in its serialised form.
+         *        The buffer is serialised once from a template message, then only the
+         *        fields that change are patched in place at fixed offsets. Publishing it
+         *        copies the buffer as is, nothing is serialised on the control loop.
+         *        The offsets stay valid because the variable length fields (the frame ids)
+         *        are set once in the template.
+         */
+        template <class M>
+        class SerializedMessage {
+          public:
+            using Message = M;
+
+            explicit SerializedMessage(const M &message)
+                : m_buffer(ros::serialization::serializationLength(message))
+            {
+                ros::serialization::OStream stream(m_buffer.data(), static_cast<uint32_t>(m_buffer.size()));
+                ros::serialization::serialize(stream, message);
+            }
+
+            const uint8_t *data() const
+            {
+                return m_buffer.data();
+            }
+
+            uint32_t size() const
+            {
+                return static_cast<uint32_t>(m_buffer.size());
+            }
+
+            /**
+             * @brief The message as published, the publisher deduces the type from it
+             */
+            const SerializedMessage<M> &message() const
+            {
+                return *this;
+            }
+
+          protected:
+            /**
+             * @brief Overwrite a fixed size field, ROS serialisation is the little endian memory image
+             */
+            template <typename T>
+            void patch(size_t offset, const T &value)
+            {
+                std::memcpy(&m_buffer[offset], &value, sizeof(T));
+            }
+
+            void patchStamp(size_t header_offset, uint32_t seq, const ros::Time &stamp)
+            {
+                patch(header_offset, seq);
+                patch(header_offset + 4, stamp.sec);
+                patch(header_offset + 8, stamp.nsec);
+            }
+
+          private:
+            std::vector<uint8_t> m_buffer;
+        };
+
+        /**
+         * @brief Pre-serialised nav_msgs/Odometry, published on the odom topic.
+         *        Only the diagonal terms of the covariances used by the controller are patched,
+         *        the other terms stay zero.
+         */
+        class SerializedOdometry : public SerializedMessage<nav_msgs::Odometry> {
+          public:
+            SerializedOdometry(const std::string &frame_id, const std::string &child_frame_id);
+
+            void setHeader(uint32_t seq, const ros::Time &stamp);
+
+            /**
+             * @brief Planar pose and its covariance
+             * @param[in] x, y Position (m)
+             * @param[in] qz, qw Yaw quaternion components
+             * @param[in] var_x, var_y, var_theta Variances of x (m^2), y (m^2) and theta (rad^2)
+             */
+            void setPose(double x, double y, double qz, double qw, double var_x, double var_y, double var_theta);
+
+            /**
+             * @brief Planar twist and its covariance
+             * @param[in] linear Linear speed (m/s)
+             * @param[in] angular Angular speed (rad/s)
+             * @param[in] var_linear, var_angular Variances of the linear ((m/s)^2) and angular ((rad/s)^2) speeds
+             */
+            void setTwist(double linear, double angular, double var_linear, double var_angular);
+
+          private:
+            size_t m_pose_offset, m_pose_covariance_offset, m_twist_offset, m_twist_covariance_offset;
+        };
+
+        /**
+         * @brief Pre-serialised tf2_msgs/TFMessage holding a single transform, published on /tf.
+         */
+        class SerializedTransform : public SerializedMessage<tf2_msgs::TFMessage> {
+          public:
+            SerializedTransform(const std::string &frame_id, const std::string &child_frame_id);
+
+            void setHeader(uint32_t seq, const ros::Time &stamp);
+
+            /**
+             * @brief Planar transform
+             * @param[in] x, y Translation (m)
+             * @param[in] qz, qw Yaw quaternion components
+             */
+            void setTransform(double x, double y, double qz, double qw);
+
+          private:
+            size_t m_header_offset, m_transform_offset;
+        };
+    } // namespace swd
+} // namespace ezw
+
+// The pre-serialised messages advertise the type of the message they hold, so that they
+// can be published on a topic advertised with that type.
+namespace ros
+{
+    namespace message_traits
+    {
+        template <class M>
+        struct MD5Sum<ezw::swd::SerializedMessage<M>> {
+            static const char *value() { return MD5Sum<M>::value(); }
+            static const char *value(const ezw::swd::SerializedMessage<M> &) { return value(); }
+        };
+
+        template <class M>
+        struct DataType<ezw::swd::SerializedMessage<M>> {
+            static const char *value() { return DataType<M>::value(); }
+            static const char *value(const ezw::swd::SerializedMessage<M> &) { return value(); }
+        };
+
+        template <class M>
+        struct Definition<ezw::swd::SerializedMessage<M>> {
+            static const char *value() { return Definition<M>::value(); }
+            static const char *value(const ezw::swd::SerializedMessage<M> &) { return value(); }
+        };
+    } // namespace message_traits
+
+    namespace serialization
+    {
+        template <class M>
+        struct Serializer<ezw::swd::SerializedMessage<M>> {
+            template <typename Stream>
+            inline static void write(Stream &stream, const ezw::swd::SerializedMessage<M> &message)
+            {
+                std::memcpy(stream.advance(message.size()), message.data(), message.size());
+            }
+
+            inline static uint32_t serializedLength(const ezw::swd::SerializedMessage<M> &message)
+            {
+                return message.size();
+            }
+        };
+    } // namespace serialization
+} // namespace ros
+
+#endif /* EZW_ROSCONTROLLERS_SERIALIZEDMESSAGES_HPP */
@@ -0,0 +1,45 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SharedMemory.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_SHAREDMEMORY_HPP
+#define EZW_ROSCONTROLLERS_SHAREDMEMORY_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Map a POSIX shared memory object, creating it if needed
+         * @param[in] name Name of the shared memory object (e.g. "/swd_controller")
+         * @param[in] size Size of the mapping in bytes
+         * @param[out] created true if the object has been created by this call, the caller
+         *             is then in charge of initializing its content
+         * @return Address of the mapping, nullptr on failure
+         */
+        void *mapSharedMemory(const std::string &name, size_t size, bool &created);
+
+        /**
+         * @brief Map a regular file, created and sized if needed. Stores to the mapping are written
+         *        back to the file by the kernel, the writer never blocks on the disk.
+         * @param[in] path Path of the file
+         * @param[in] size Size of the mapping in bytes
+         * @param[out] created true if the file has been created or resized by this call, the caller
+         *             is then in charge of initializing its content
+         * @return Address of the mapping, nullptr on failure
+         */
+        void *mapFile(const std::string &path, size_t size, bool &created);
+
+        /**
+         * @brief Unmap a mapping returned by one of the map functions
+         */
+        void unmapMemory(void *addr, size_t size);
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_SHAREDMEMORY_HPP */
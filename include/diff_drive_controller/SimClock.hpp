@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SimClock.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_SIMCLOCK_HPP
+#define EZW_ROSCONTROLLERS_SIMCLOCK_HPP
+
+#include <atomic>
+#include <thread>
+#include <ros/node_handle.h>
+#include <ros/time.h>
+
+// Default of the sim_time_factor parameter, read by main and by the controller, 0 disables the simulated clock
+#define DEFAULT_SIM_TIME_FACTOR 0.0
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Simulated ROS clock, published on `/clock` at a multiple of real time.
+         *        The simulated time starts at the wall clock time and advances by fixed steps,
+         *        paced by the wall clock. `/use_sim_time` must be set before the first node
+         *        handle of the process is created, for roscpp to follow the published clock.
+         */
+        class SimClock {
+          public:
+            /**
+             * @brief Class constructor
+             * @param[in] factor Simulated seconds per wall clock second
+             * @param[in] step_s Simulated time between two clock messages
+             */
+            SimClock(double factor, double step_s);
+            ~SimClock();
+
+            /**
+             * @brief Start publishing, and wait for the simulated time to be received
+             */
+            void start();
+
+            void stop();
+
+          private:
+            void run();
+
+            double            m_factor, m_step_s;
+            ros::NodeHandle   m_nh;
+            ros::Publisher    m_pub_clock;
+            std::atomic<bool> m_stop{false};
+            std::thread       m_thread;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_SIMCLOCK_HPP */
@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SimDrive.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_SIMDRIVE_HPP
+#define EZW_ROSCONTROLLERS_SIMDRIVE_HPP
+
+#include "diff_drive_controller/DriveInterface.hpp"
+
+#include <atomic>
+#include <pthread.h>
+#include <string>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Simulated drive backend, running in the controller's process.
+         *        The motor speed follows the target velocity as a first order system in
+         *        velocity mode, the same after the acceleration and deceleration ramps in
+         *        profile velocity mode, and a trapezoidal profile towards the target position in
+         *        profile position mode. The wheel position is integrated on each access using ROS time.
+         *        With a communication timeout, the drive quick stops on its own once the host's
+         *        heartbeat is older than the timeout.
+         *        The simulated wheel can be placed in shared memory, so several
+         *        controllers (e.g. an active and a standby one) drive the same wheel.
+         */
+        class SimDrive : public DriveInterface {
+          public:
+            /**
+             * @brief Class constructor
+             * @param[in] diameter_mm Wheel diameter in mm
+             * @param[in] reduction Motor reduction ratio
+             * @param[in] time_constant_s Time constant of the motor speed response in seconds
+             */
+            SimDrive(double diameter_mm, double reduction, double time_constant_s);
+            ~SimDrive() override;
+
+            /**
+             * @brief Move the simulated wheel to a shared memory object, created if needed
+             * @param[in] shm_name Name of the shared memory object
+             * @return true on success
+             */
+            bool share(const std::string &shm_name);
+
+            double getDiameter() const override;
+            double getReduction() const override;
+
+            ezw_error_t getOdometryValue(int32_t &dist_mm) override;
+            ezw_error_t getNMTState(smccore::Controller::NMTState &state) override;
+            ezw_error_t setNMTState(smccore::Controller::NMTCommand command) override;
+            ezw_error_t getPDSState(smccore::Controller::PDSState &state) override;
+            ezw_error_t enterInOperationEnabledState() override;
+            ezw_error_t setHalt(bool halt) override;
+            ezw_error_t setTargetVelocity(int32_t speed_rpm) override;
+            ezw_error_t getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value) override;
+            ezw_error_t getVelocityDemand(int32_t &speed_rpm) override;
+            ezw_error_t getStatusWord(uint16_t &status_word) override;
+            ezw_error_t setOperationMode(OperationMode mode) override;
+            ezw_error_t setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s) override;
+            ezw_error_t startRelativeMove(int32_t distance_mm) override;
+            ezw_error_t setCommunicationTimeout(uint16_t timeout_ms) override;
+            ezw_error_t sendHeartbeat() override;
+
+          private:
+            struct State {
+                std::atomic<uint32_t> magic;
+                pthread_mutex_t       mtx;
+                int32_t               nmt_state, pds_state, mode;
+                bool                  halt, target_reached;
+                double                target_rpm, demand_rpm, speed_rpm, position_mm, target_position_mm;
+                double                profile_velocity_rpm, profile_acceleration_rpm_s, profile_deceleration_rpm_s;
+                int64_t               last_update_ns, heartbeat_timeout_ns, last_heartbeat_ns;
+            };
+
+            class Lock {
+              public:
+                explicit Lock(State *state);
+                ~Lock();
+
+              private:
+                State *m_state;
+            };
+
+            // Advance the simulation up to now, the state must be locked
+            void update();
+
+            // Simulation step, the state must be locked
+            void step(double dt);
+
+            // The drive is operational, the state must be locked
+            bool powered() const;
+
+            // Profile position mode step, the state must be locked
+            void updatePosition(double dt, bool enabled);
+
+            double m_diameter_mm, m_reduction, m_time_constant_s;
+            State  m_local_state;
+            State *m_state;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_SIMDRIVE_HPP */
@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SlipDetector.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_SLIPDETECTOR_HPP
+#define EZW_ROSCONTROLLERS_SLIPDETECTOR_HPP
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Per-cycle wheel slip and stall detection.
+         *        The commanded speed of each wheel is ramped like the drive does in profile velocity
+         *        mode, filtered by a first order model of the drive's response, and compared with the speed measured by its encoder. A wheel
+         *        turning while it should not (or faster/slower than commanded) is slipping, a wheel
+         *        not turning while commanded is stalled. The wheels' yaw rate can also be
+         *        cross-checked against the IMU's one, a mismatch revealing a skid of the base.
+         */
+        class SlipDetector {
+          public:
+            enum class WheelState
+            {
+                OK    = 0,
+                SLIP  = 1, // Measured speed differs from the commanded one
+                STALL = 2  // Commanded but not turning
+            };
+
+            /**
+             * @brief Class constructor
+             * @param[in] response_time_s Time constant of the drives' speed response
+             * @param[in] speed_tolerance_mps Absolute speed tolerance, above the encoder quantization
+             * @param[in] relative_tolerance Speed tolerance relative to the expected speed
+             * @param[in] yaw_rate_tolerance Tolerance between the wheels' and the IMU's yaw rates (rad/s)
+             */
+            SlipDetector(double response_time_s, double speed_tolerance_mps, double relative_tolerance, double yaw_rate_tolerance);
+
+            /**
+             * @brief Ramps of the drives, applied to the commanded speeds before their response
+             * @param[in] acceleration_mps2, deceleration_mps2 Ramps of the wheels, 0 when the drives apply the setpoints at once
+             */
+            void setRamps(double acceleration_mps2, double deceleration_mps2);
+
+            /**
+             * @brief Compare the measured wheel speeds with the commanded ones
+             * @param[in] left_cmd_mps, right_cmd_mps Commanded wheel speeds
+             * @param[in] left_mps, right_mps Measured wheel speeds
+             * @param[in] left_valid, right_valid The measured speed is valid (encoder read)
+             * @param[in] dt Time since the previous update
+             */
+            void update(double left_cmd_mps, double right_cmd_mps, double left_mps, double right_mps, bool left_valid, bool right_valid, double dt);
+
+            /**
+             * @brief Forget the expected speeds and states, while the drives don't follow the setpoints
+             */
+            void reset();
+
+            /**
+             * @brief Cross-check the yaw rate from the wheels with the IMU's one
+             * @return true if the base skids
+             */
+            bool checkYawRate(double wheels_yaw_rate, double imu_yaw_rate) const;
+
+            WheelState leftState() const;
+            WheelState rightState() const;
+
+            /**
+             * @brief Measured minus expected speed of the last update
+             */
+            double leftError() const;
+            double rightError() const;
+
+            static const char *stateName(WheelState state);
+
+          private:
+            WheelState checkWheel(double expected_mps, double measured_mps, double &error) const;
+            double     ramp(double ramped_mps, double cmd_mps, double dt) const;
+
+            double     m_response_time_s, m_speed_tolerance_mps, m_relative_tolerance, m_yaw_rate_tolerance;
+            double     m_acceleration_mps2 = 0.0, m_deceleration_mps2 = 0.0;
+            double     m_left_ramped_mps = 0.0, m_right_ramped_mps = 0.0;
+            double     m_left_expected_mps = 0.0, m_right_expected_mps = 0.0;
+            double     m_left_error = 0.0, m_right_error = 0.0;
+            WheelState m_left_state = WheelState::OK, m_right_state = WheelState::OK;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_SLIPDETECTOR_HPP */
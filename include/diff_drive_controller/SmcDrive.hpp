@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SmcDrive.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_SMCDRIVE_HPP
+#define EZW_ROSCONTROLLERS_SMCDRIVE_HPP
+
+#include "diff_drive_controller/DriveInterface.hpp"
+
+#include <string>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Drive backend using the SMC core, the wheel is reached through
+         *        the CANOpen service over DBus.
+         */
+        class SmcDrive : public DriveInterface {
+          public:
+            /**
+             * @brief Load the wheel's configuration and connect to the CANOpen service
+             * @param[in] name Name of the wheel, used in the logs
+             * @param[in] config_file Path to the `.ini` configuration file of the wheel
+             * @return ERROR_NONE on success
+             */
+            ezw_error_t init(const std::string &name, const std::string &config_file);
+
+            double getDiameter() const override;
+            double getReduction() const override;
+
+            ezw_error_t getOdometryValue(int32_t &dist_mm) override;
+            ezw_error_t getNMTState(smccore::Controller::NMTState &state) override;
+            ezw_error_t setNMTState(smccore::Controller::NMTCommand command) override;
+            ezw_error_t getPDSState(smccore::Controller::PDSState &state) override;
+            ezw_error_t enterInOperationEnabledState() override;
+            ezw_error_t setHalt(bool halt) override;
+            ezw_error_t setTargetVelocity(int32_t speed_rpm) override;
+            ezw_error_t getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value) override;
+            ezw_error_t getVelocityDemand(int32_t &speed_rpm) override;
+            ezw_error_t getStatusWord(uint16_t &status_word) override;
+            ezw_error_t setOperationMode(OperationMode mode) override;
+            ezw_error_t setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s) override;
+            ezw_error_t startRelativeMove(int32_t distance_mm) override;
+            ezw_error_t setCommunicationTimeout(uint16_t timeout_ms) override;
+            ezw_error_t sendHeartbeat() override;
+
+          private:
+            ezw::smccore::Controller m_controller;
+            double                   m_diameter_mm = 0.0, m_reduction = 1.0;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_SMCDRIVE_HPP */
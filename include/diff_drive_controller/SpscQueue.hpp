@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SpscQueue.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_SPSCQUEUE_HPP
+#define EZW_ROSCONTROLLERS_SPSCQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Bounded lock-free queue for a single producer thread and a single consumer thread.
+         *        Neither side ever blocks: push() fails when the queue is full, pop() when it is empty.
+         *        The indexes only grow, their difference is the number of items queued.
+         * @tparam T Item type, copied in and out of the queue
+         * @tparam N Capacity, a power of two
+         */
+        template <class T, size_t N>
+        class SpscQueue {
+            static_assert((N > 0) && (0 == (N & (N - 1))), "The capacity must be a power of two");
+
+          public:
+            /**
+             * @brief Called by the producer only
+             * @return false if the queue is full, the item is then dropped
+             */
+            bool push(const T &item)
+            {
+                size_t head = m_head.load(std::memory_order_relaxed);
+                if (N == (head - m_tail.load(std::memory_order_acquire))) {
+                    return false;
+                }
+
+                m_items[head & (N - 1)] = item;
+                m_head.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            /**
+             * @brief Called by the consumer only
+             * @return false if the queue is empty
+             */
+            bool pop(T &item)
+            {
+                size_t tail = m_tail.load(std::memory_order_relaxed);
+                if (tail == m_head.load(std::memory_order_acquire)) {
+                    return false;
+                }
+
+                item = m_items[tail & (N - 1)];
+                m_tail.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool empty() const
+            {
+                return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+            }
+
+          private:
+            std::array<T, N> m_items;
+
+            // On their own cache lines, each one is written by a single side
+            alignas(64) std::atomic<size_t> m_head{0};
+            alignas(64) std::atomic<size_t> m_tail{0};
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_SPSCQUEUE_HPP */
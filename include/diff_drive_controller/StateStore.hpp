@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file StateStore.hpp
+ */
+
+#ifndef EZW_ROSCONTROLLERS_STATESTORE_HPP
+#define EZW_ROSCONTROLLERS_STATESTORE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace ezw
+{
+    namespace swd
+    {
+        /**
+         * @brief Snapshot of the controller state, written once per control cycle
+         */
+        struct ControllerState {
+            int64_t stamp_ns;                          // ROS time of the odometry sample
+            double  x, y, theta, x_err, y_err, theta_err; // Integrated pose and its uncertainties
+            int32_t dist_left_mm, dist_right_mm;       // Raw encoder values of the sample
+            double  left_speed_mps, right_speed_mps;   // Last measured wheel speeds
+            int32_t left_setpoint_rpm, right_setpoint_rpm;
+            uint8_t nmt_ok, pds_ok, safety_limited_speed;
+        };
+
+        /**
+         * @brief Controller state kept in a memory mapping, shared between processes or
+         *        backed by a file to survive restarts.
+         *        The state is protected by a sequence lock: the single writer never blocks,
+         *        and readers retry when they overlap a write.
+         *        The store also holds the ownership of the drives for the hot standby mode:
+         *        the owner refreshes a heartbeat periodically, and another process may
+         *        only acquire the ownership once the owner died or stopped refreshing it.
+         */
+        class StateStore {
+          public:
+            StateStore() = default;
+            ~StateStore();
+
+            StateStore(const StateStore &) = delete;
+            StateStore &operator=(const StateStore &) = delete;
+
+            /**
+             * @brief Map the POSIX shared memory object `name`, created if needed
+             * @return true on success
+             */
+            bool openShared(const std::string &name);
+
+            /**
+             * @brief Map the file `path`, created if needed. A file of another size or
+             *        format is reset.
+             * @return true on success
+             */
+            bool openFile(const std::string &path);
+
+            bool isOpen() const;
+
+            /**
+             * @brief Publish a new state, wait-free
+             */
+            void write(const ControllerState &state);
+
+            /**
+             * @brief Read the last published state
+             * @return false if no state has been published yet
+             */
+            bool read(ControllerState &state) const;
+
+            /**
+             * @brief Acquire the ownership if there is no live owner
+             * @param[in] timeout_ns Age above which the owner's heartbeat is considered lost
+             * @return true if this process is the owner
+             */
+            bool tryAcquire(int64_t timeout_ns);
+
+            /**
+             * @brief Check that this process still owns the drives
+             */
+            bool isOwner() const;
+
+            /**
+             * @brief Check that the current owner is alive and refreshes its heartbeat
+             */
+            bool ownerAlive(int64_t timeout_ns) const;
+
+            /**
+             * @brief Refresh the heartbeat of the owner
+             */
+            void heartbeat();
+
+            /**
+             * @brief Time elapsed since the last heartbeat, in ns of the monotonic clock
+             */
+            int64_t heartbeatAgeNs() const;
+
+            static int64_t monotonicNs();
+
+          private:
+            struct Segment {
+                std::atomic<uint32_t> magic;
+                std::atomic<uint32_t> seq;
+                ControllerState       state;
+                std::atomic<int32_t>  owner_pid;
+                std::atomic<int64_t>  heartbeat_ns;
+            };
+
+            Segment *m_segment = nullptr;
+        };
+    } // namespace swd
+} // namespace ezw
+
+#endif /* EZW_ROSCONTROLLERS_STATESTORE_HPP */
@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2021 ez-Wheel S.A.S.
+#
+# @file canopen_slave_sim.py
+#
+# Minimal CiA 402 drive simulator answering for one or more node IDs on a SocketCAN
+# interface, to run the SocketCAN backend without drives:
+# - the NMT commands, the expedited SDO transfers and the heartbeat producer (0x1017),
+# - the PDO mappings written by the controller, RPDO1 applied on reception, TPDO1 and TPDO2 sent at each SYNC,
+# - the CiA 402 state machine, the vl, profile velocity and profile position modes,
+# - the consumer heartbeat of the master (0x1016) and the abort connection option (0x6007).
+#
+# The velocities of the profiled modes are in position units per second. By default, the
+# position unit is the encoder increment, --feed enables the factor group (0x6091, 0x6092)
+# with this many position units per motor revolution.
+#
+# sudo ip link add dev vcan0 type vcan && sudo ip link set vcan0 up
+# rosrun swd_ros_controllers canopen_slave_sim.py --interface vcan0 --node-ids 1 2
+
+import argparse
+import select
+import signal
+import socket
+import struct
+import sys
+import time
+
+CAN_FRAME = struct.Struct('=IB3x8s')
+
+NMT_STATE_BOOTUP = 0x00
+NMT_STATE_STOPPED = 0x04
+NMT_STATE_OPERATIONAL = 0x05
+NMT_STATE_PREOPERATIONAL = 0x7F
+
+SDO_ABORT_NO_OBJECT = 0x06020000
+SDO_ABORT_COMMAND = 0x05040001
+
+# CiA 402 states and their status word
+SWITCH_ON_DISABLED = 0x0040
+READY_TO_SWITCH_ON = 0x0021
+SWITCHED_ON = 0x0023
+OPERATION_ENABLED = 0x0027
+QUICK_STOP_ACTIVE = 0x0007
+FAULT = 0x0008
+
+SW_TARGET_REACHED = 0x0400
+SW_REMOTE = 0x0200
+
+MODE_PROFILE_POSITION = 1
+MODE_VELOCITY = 2
+MODE_PROFILE_VELOCITY = 3
+
+
+def signed(value, bits):
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+class Node(object):
+    def __init__(self, bus, node_id, args):
+        self.bus = bus
+        self.node_id = node_id
+        self.verbose = args.verbose
+        # Object dictionary, (index, subindex) -> [value, size in bytes]
+        self.od = {
+            (0x1016, 1): [0, 4], (0x1017, 0): [0, 2],
+            (0x1400, 1): [0x200 + node_id, 4], (0x1400, 2): [0xFF, 1],
+            (0x1800, 1): [0x80000000 | (0x180 + node_id), 4], (0x1800, 2): [1, 1],
+            (0x1801, 1): [0x80000000 | (0x280 + node_id), 4], (0x1801, 2): [1, 1],
+            (0x1600, 0): [0, 1], (0x1A00, 0): [0, 1], (0x1A01, 0): [0, 1],
+            (0x6007, 0): [1, 2], (0x6040, 0): [0, 2], (0x6041, 0): [SWITCH_ON_DISABLED, 2],
+            (0x6042, 0): [0, 2], (0x6043, 0): [0, 2], (0x6060, 0): [0, 1], (0x6061, 0): [0, 1],
+            (0x6063, 0): [0, 4], (0x606B, 0): [0, 4], (0x607A, 0): [0, 4],
+            (0x6081, 0): [0, 4], (0x6083, 0): [0, 4], (0x6084, 0): [0, 4],
+            (0x608F, 1): [args.increments, 4], (0x608F, 2): [1, 4], (0x60FF, 0): [0, 4],
+        }
+        for sub in range(1, 9):
+            self.od[(0x1600, sub)] = [0, 4]
+            self.od[(0x1A00, sub)] = [0, 4]
+            self.od[(0x1A01, sub)] = [0, 4]
+        self.units_per_increment = 1.0
+        if args.feed:
+            self.od.update({(0x6091, 1): [1, 4], (0x6091, 2): [1, 4], (0x6092, 1): [args.feed, 4], (0x6092, 2): [1, 4]})
+            self.units_per_increment = float(args.feed) / args.increments
+
+        self.nmt = NMT_STATE_PREOPERATIONAL
+        self.state = SWITCH_ON_DISABLED
+        self.position = float(args.initial_position)  # Increments, 0x6063 wraps around as an INT32
+        self.speed = 0.0  # Position units per second in the profiled modes, rpm in vl
+        self.target = None  # Profile position target, in position units
+        self.previous_cw = 0
+        self.next_heartbeat = 0.0
+        self.master_heartbeat = None
+        self.stats = {'sdo': 0, 'rpdo': 0, 'tpdo': 0}
+        self.send(0x700 + node_id, bytes([NMT_STATE_BOOTUP]))
+
+    def log(self, text, always=True):
+        if always or self.verbose:
+            print('[node %d] %s' % (self.node_id, text), flush=True)
+
+    def get(self, index, sub=0):
+        return self.od[(index, sub)][0]
+
+    def send(self, cob_id, data):
+        self.bus.send(cob_id, data)
+
+    # NMT
+
+    def nmt_command(self, command):
+        states = {0x01: NMT_STATE_OPERATIONAL, 0x02: NMT_STATE_STOPPED, 0x80: NMT_STATE_PREOPERATIONAL}
+        if command in states:
+            self.nmt = states[command]
+        elif command in (0x81, 0x82):
+            self.send(0x700 + self.node_id, bytes([NMT_STATE_BOOTUP]))
+            self.nmt = NMT_STATE_PREOPERATIONAL
+        self.log('NMT command 0x%02X, state 0x%02X' % (command, self.nmt))
+
+    # SDO
+
+    def sdo(self, data):
+        command, index, sub = data[0], data[1] | (data[2] << 8), data[3]
+        self.stats['sdo'] += 1
+        if self.nmt == NMT_STATE_STOPPED:
+            return
+
+        header = bytes([0, data[1], data[2], sub])
+        if (index, sub) not in self.od:
+            self.send(0x580 + self.node_id, bytes([0x80]) + header[1:] + struct.pack('<I', SDO_ABORT_NO_OBJECT))
+            self.log('SDO 0x%04X:%u aborted, no such object' % (index, sub), self.verbose)
+            return
+
+        entry = self.od[(index, sub)]
+        if command == 0x40:
+            size = entry[1]
+            response = bytes([0x43 | ((4 - size) << 2)]) + header[1:] + struct.pack('<I', entry[0] & 0xFFFFFFFF)
+            self.send(0x580 + self.node_id, response)
+            self.log('SDO upload 0x%04X:%u = %d' % (index, sub, entry[0]), False)
+        elif (command & 0xE3) == 0x23:
+            size = 4 - ((command >> 2) & 0x03)
+            value = int.from_bytes(data[4:4 + size], 'little')
+            self.write(index, sub, value)
+            self.send(0x580 + self.node_id, bytes([0x60]) + header[1:] + bytes(4))
+            self.log('SDO download 0x%04X:%u = 0x%X' % (index, sub, value), index not in (0x6040,) or self.verbose)
+        else:
+            self.send(0x580 + self.node_id, bytes([0x80]) + header[1:] + struct.pack('<I', SDO_ABORT_COMMAND))
+
+    def write(self, index, sub, value):
+        self.od[(index, sub)][0] = value
+        if index == 0x6040:
+            self.control_word(value)
+        elif index == 0x6060:
+            self.od[(0x6061, 0)][0] = value
+            self.speed = 0.0
+            self.target = None
+        elif index == 0x1016:
+            self.master_heartbeat = None
+
+    # PDO
+
+    def mapping(self, index):
+        entries = []
+        for sub in range(1, self.get(index) + 1):
+            entry = self.get(index, sub)
+            entries.append((entry >> 16, (entry >> 8) & 0xFF, (entry & 0xFF) // 8))
+        return entries
+
+    def rpdo(self, data):
+        if (self.nmt != NMT_STATE_OPERATIONAL) or (self.get(0x1400, 1) & 0x80000000):
+            return
+        self.stats['rpdo'] += 1
+        offset = 0
+        for index, sub, size in self.mapping(0x1600):
+            value = int.from_bytes(data[offset:offset + size], 'little')
+            self.od[(index, sub)][0] = value
+            offset += size
+
+    def sync(self):
+        if self.nmt != NMT_STATE_OPERATIONAL:
+            return
+        for communication, mapping in ((0x1800, 0x1A00), (0x1801, 0x1A01)):
+            if self.get(communication, 1) & 0x80000000:
+                continue
+            payload = b''
+            for index, sub, size in self.mapping(mapping):
+                payload += (self.get(index, sub) & ((1 << (8 * size)) - 1)).to_bytes(size, 'little')
+            self.stats['tpdo'] += 1
+            self.send(self.get(communication, 1) & 0x7FF, payload)
+
+    # CiA 402
+
+    def control_word(self, cw):
+        previous = self.state
+        if self.state == FAULT:
+            if cw & 0x80:
+                self.state = SWITCH_ON_DISABLED
+        elif (cw & 0x02) == 0:
+            self.state = SWITCH_ON_DISABLED
+        elif (cw & 0x06) == 0x02:
+            self.state = QUICK_STOP_ACTIVE if self.state == OPERATION_ENABLED else SWITCH_ON_DISABLED
+        elif (cw & 0x0F) == 0x06:
+            self.state = READY_TO_SWITCH_ON
+        elif (cw & 0x0F) == 0x07 and self.state in (READY_TO_SWITCH_ON, OPERATION_ENABLED):
+            self.state = SWITCHED_ON
+        elif (cw & 0x0F) == 0x0F and self.state in (SWITCHED_ON, OPERATION_ENABLED):
+            self.state = OPERATION_ENABLED
+
+        # Profile position: a new set-point on the rising edge of bit 4, relative with bit 6
+        if (self.state == OPERATION_ENABLED) and (self.get(0x6060) == MODE_PROFILE_POSITION):
+            if (cw & 0x10) and not (self.previous_cw & 0x10):
+                target = signed(self.get(0x607A), 32)
+                base = self.target if (self.target is not None) else self.position * self.units_per_increment
+                self.target = base + target if (cw & 0x40) else target
+                self.log('Relative move of %d position units' % target)
+        self.previous_cw = cw
+
+        if self.state != previous:
+            self.log('PDS state 0x%04X -> 0x%04X' % (previous, self.state))
+
+    def update(self, now, dt):
+        if (self.nmt != NMT_STATE_BOOTUP) and (self.get(0x1017) > 0) and (now >= self.next_heartbeat):
+            self.send(0x700 + self.node_id, bytes([self.nmt]))
+            self.next_heartbeat = now + self.get(0x1017) / 1000.0
+
+        # Consumer heartbeat of the master, the abort connection option code applies on its loss
+        consumer_ms = self.get(0x1016, 1) & 0xFFFF
+        if consumer_ms and (self.master_heartbeat is not None) and (now - self.master_heartbeat > consumer_ms / 1000.0):
+            self.master_heartbeat = None
+            option = self.get(0x6007)
+            self.log('Master heartbeat lost, abort connection option %d' % option)
+            if self.state == OPERATION_ENABLED:
+                self.state = {1: FAULT, 2: SWITCH_ON_DISABLED, 3: QUICK_STOP_ACTIVE}.get(option, self.state)
+
+        mode = self.get(0x6060)
+        increments_per_rev = float(self.get(0x608F, 1)) / self.get(0x608F, 2)
+        running = (self.state == OPERATION_ENABLED) and not (self.get(0x6040) & 0x0100)
+
+        if mode == MODE_VELOCITY:
+            self.speed = signed(self.get(0x6042), 16) if running else 0.0
+            self.od[(0x6043, 0)][0] = int(self.speed) & 0xFFFF
+            self.position += self.speed / 60.0 * increments_per_rev * dt
+        elif mode in (MODE_PROFILE_VELOCITY, MODE_PROFILE_POSITION):
+            if mode == MODE_PROFILE_VELOCITY:
+                target = signed(self.get(0x60FF), 32) if running else 0.0
+            elif running and (self.target is not None):
+                remaining = self.target - self.position * self.units_per_increment
+                braking = self.speed * self.speed / (2.0 * max(1, self.get(0x6084)))
+                target = 0.0 if abs(remaining) <= braking else (self.get(0x6081) if remaining > 0 else -self.get(0x6081))
+                if abs(remaining) < 1.0 and abs(self.speed) < self.get(0x6084) * dt * 2:
+                    target, self.speed = 0.0, 0.0
+                    self.position = self.target / self.units_per_increment
+                    self.target = None
+            else:
+                target = 0.0
+            # Ramped with the profile acceleration, or deceleration towards standstill
+            slowing = abs(target) < abs(self.speed) or target * self.speed < 0
+            step = max(1, self.get(0x6084) if slowing else self.get(0x6083)) * dt
+            self.speed += max(-step, min(step, target - self.speed))
+            self.od[(0x606B, 0)][0] = int(round(self.speed)) & 0xFFFFFFFF
+            self.position += self.speed / self.units_per_increment * dt
+
+        self.od[(0x6063, 0)][0] = int(round(self.position)) & 0xFFFFFFFF
+        reached = (mode != MODE_PROFILE_POSITION) or (self.target is None)
+        self.od[(0x6041, 0)][0] = self.state | SW_REMOTE | (SW_TARGET_REACHED if reached else 0)
+
+
+class Bus(object):
+    def __init__(self, sock):
+        self.sock = sock
+
+    def send(self, cob_id, data):
+        # A frame which can't be sent is lost, as on a bus off
+        try:
+            self.sock.send(CAN_FRAME.pack(cob_id, len(data), data.ljust(8, b'\0')))
+        except OSError:
+            pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Simulate CiA 402 drives on a SocketCAN interface.')
+    parser.add_argument('--interface', default='vcan0')
+    parser.add_argument('--fd', type=int, help='Already open socket carrying raw can_frame structs, instead of the interface')
+    parser.add_argument('--node-ids', type=int, nargs='+', default=[1, 2])
+    parser.add_argument('--increments', type=int, default=4096, help='Encoder increments per motor revolution (0x608F)')
+    parser.add_argument('--feed', type=int, default=0, help='Position units per motor revolution, enables the factor group')
+    parser.add_argument('--initial-position', type=int, default=0, help='Initial position in increments, e.g. close to 2^31 to wrap 0x6063')
+    parser.add_argument('--verbose', action='store_true')
+    args = parser.parse_args()
+
+    if args.fd is not None:
+        sock = socket.socket(fileno=args.fd)
+    else:
+        sock = socket.socket(socket.PF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+        sock.bind((args.interface,))
+
+    bus = Bus(sock)
+    nodes = {node_id: Node(bus, node_id, args) for node_id in args.node_ids}
+    running = [True]
+    signal.signal(signal.SIGTERM, lambda *_: running.__setitem__(0, False))
+    signal.signal(signal.SIGINT, lambda *_: running.__setitem__(0, False))
+
+    last = time.monotonic()
+    while running[0]:
+        readable, _, _ = select.select([sock], [], [], 0.001)
+        now = time.monotonic()
+        if readable:
+            try:
+                frame = sock.recv(CAN_FRAME.size)
+            except OSError:
+                frame = b''
+            if len(frame) != CAN_FRAME.size:
+                break
+            cob_id, dlc, data = CAN_FRAME.unpack(frame)
+            cob_id &= 0x7FF
+            data = data[:dlc]
+            function, node_id = cob_id & 0x780, cob_id & 0x7F
+            if cob_id == 0x000:
+                for node in nodes.values():
+                    if data[1] in (0, node.node_id):
+                        node.nmt_command(data[0])
+            elif cob_id == 0x080:
+                for node in nodes.values():
+                    node.sync()
+            elif function == 0x700:
+                for node in nodes.values():
+                    if (node.get(0x1016, 1) >> 16) & 0x7F == node_id:
+                        node.master_heartbeat = now
+            elif node_id in nodes:
+                if function == 0x600:
+                    nodes[node_id].sdo(data)
+                elif cob_id == nodes[node_id].get(0x1400, 1) & 0x7FF:
+                    nodes[node_id].rpdo(data)
+
+        for node in nodes.values():
+            node.update(now, now - last)
+        last = now
+
+    for node in nodes.values():
+        node.log('%d SDO requests, %d RPDOs received, %d TPDOs sent, position %d increments' %
+                 (node.stats['sdo'], node.stats['rpdo'], node.stats['tpdo'], signed(node.get(0x6063), 32)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
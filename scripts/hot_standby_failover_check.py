@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2021 ez-Wheel S.A.S.
+#
+# @file hot_standby_failover_check.py
+#
+# Failover check of two controllers in hot standby, e.g. started with
+# swd_diff_drive_controller_hot_standby.launch on the simulated wheels: the active
+# controller is killed (or stopped), and the standby one has to take the drives over
+# within hot_standby_timeout_ms, plus one heartbeat period and one control period.
+#
+# rosrun swd_ros_controllers hot_standby_failover_check.py [--signal STOP] [--margin-ms 50]
+
+import argparse
+import os
+import signal
+import sys
+import threading
+import time
+import xmlrpc.client
+
+import rosgraph
+import rospy
+from diagnostic_msgs.msg import DiagnosticArray
+
+# Same as in DiffDriveController.cpp
+HOT_STANDBY_HEARTBEATS = 4
+
+
+class Diagnostics(object):
+    def __init__(self, nodes):
+        self.nodes = nodes
+        self.cv = threading.Condition()
+        self.control_loop = {}
+        self.takeover = None
+        rospy.Subscriber('/diagnostics', DiagnosticArray, self.cb_diagnostics, queue_size=100)
+
+    def cb_diagnostics(self, msg):
+        now = time.monotonic()
+        with self.cv:
+            for status in msg.status:
+                node, _, name = status.name.partition(': ')
+                if node not in self.nodes:
+                    continue
+                if name == 'Control loop':
+                    self.control_loop[node] = status.message
+                elif name == 'Hot standby' and self.takeover is None:
+                    values = {kv.key: kv.value for kv in status.values}
+                    self.takeover = (node, now, float(values.get('failover_time_ms', 'nan')))
+            self.cv.notify_all()
+
+    def wait(self, predicate, timeout_s):
+        with self.cv:
+            return self.cv.wait_for(predicate, timeout_s)
+
+
+def node_pid(node):
+    master = rosgraph.Master('/hot_standby_failover_check')
+    return xmlrpc.client.ServerProxy(master.lookupNode(node)).getPid('/hot_standby_failover_check')[2]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Kill the active controller and check the failover time.')
+    parser.add_argument('--nodes', nargs=2, default=['/swd_diff_drive_controller_a', '/swd_diff_drive_controller_b'])
+    parser.add_argument('--signal', choices=['KILL', 'STOP'], default='KILL',
+                        help='KILL for a dead controller, STOP for a hung one, resumed after the failover')
+    parser.add_argument('--margin-ms', type=float, default=50.0, help='Scheduling margin over the expected bound')
+    parser.add_argument('--wait-s', type=float, default=10.0, help='Time for both controllers to come up')
+    args = parser.parse_args(rospy.myargv()[1:])
+
+    rospy.init_node('hot_standby_failover_check', anonymous=True, disable_signals=True)
+    diagnostics = Diagnostics(args.nodes)
+
+    # One active controller and one standby, as reported by their control loop diagnostics
+    def roles_known():
+        return all(n in diagnostics.control_loop for n in args.nodes) and \
+            sum(diagnostics.control_loop[n] == 'Standby' for n in args.nodes) == 1
+    if not diagnostics.wait(roles_known, args.wait_s):
+        print('FAIL: no active and standby pair among %s, got %s' % (args.nodes, diagnostics.control_loop))
+        return 1
+
+    active = next(n for n in args.nodes if diagnostics.control_loop[n] != 'Standby')
+    standby = next(n for n in args.nodes if n != active)
+    timeout_ms = rospy.get_param(standby + '/hot_standby_timeout_ms', 100)
+    pub_freq_hz = rospy.get_param(standby + '/pub_freq_hz', 50)
+    bound_ms = timeout_ms * (1.0 + 1.0 / HOT_STANDBY_HEARTBEATS) + 1000.0 / pub_freq_hz + args.margin_ms
+
+    pid = node_pid(active)
+    print('Active %s (pid %d), standby %s, expecting a takeover within %.1f ms' % (active, pid, standby, bound_ms))
+
+    sig = signal.SIGKILL if args.signal == 'KILL' else signal.SIGSTOP
+    t_signal = time.monotonic()
+    os.kill(pid, sig)
+
+    # The takeover diagnostic is published immediately, not with the periodic ones
+    took_over = diagnostics.wait(lambda: diagnostics.takeover is not None, max(2.0, 4 * bound_ms * 1e-3))
+    if args.signal == 'STOP':
+        os.kill(pid, signal.SIGCONT)
+    if not took_over:
+        print('FAIL: %s did not take over the drives' % standby)
+        return 1
+
+    node, t_takeover, failover_ms = diagnostics.takeover
+    elapsed_ms = (t_takeover - t_signal) * 1e3
+    print('%s took over %.1f ms after SIG%s, %.1f ms after the last heartbeat' % (node, elapsed_ms, args.signal, failover_ms))
+
+    ok = (node == standby) and (elapsed_ms <= bound_ms)
+    if args.signal == 'STOP':
+        # The resumed controller has to notice it was replaced, and switch to standby
+        diagnostics.control_loop.pop(active, None)
+        stepped_down = diagnostics.wait(lambda: diagnostics.control_loop.get(active) == 'Standby', 5.0)
+        print('%s %s to standby after SIGCONT' % (active, 'switched' if stepped_down else 'did NOT switch'))
+        ok = ok and stepped_down
+
+    print('PASS' if ok else 'FAIL')
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file ActuationMonitor.cpp
+ */
+
+#include "diff_drive_controller/ActuationMonitor.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+// Setpoints tracked at once, the oldest is dropped beyond
+#define MAX_PENDING_SETPOINTS 16
+
+// CiA 402 status word, bits of the power drive state
+#define STATUS_WORD_STATE_MASK        0x006F
+#define STATUS_WORD_OPERATION_ENABLED 0x0027
+
+namespace ezw
+{
+    namespace swd
+    {
+        ActuationMonitor::ActuationMonitor(DriveStats &stats, int32_t tolerance_rpm, int64_t timeout_ns) :
+            m_stats(stats), m_tolerance_rpm(tolerance_rpm), m_timeout_ns(timeout_ns)
+        {
+            m_pending.reserve(MAX_PENDING_SETPOINTS);
+        }
+
+        void ActuationMonitor::command(int32_t speed_rpm, int64_t now_ns)
+        {
+            if (m_halted) {
+                return;
+            }
+
+            // A resent setpoint is already tracked, or already applied
+            if (m_tracking && (speed_rpm == m_last_rpm)) {
+                return;
+            }
+            m_last_rpm = speed_rpm;
+            m_tracking = true;
+
+            if (MAX_PENDING_SETPOINTS == m_pending.size()) {
+                m_pending.erase(m_pending.begin());
+            }
+            m_pending.push_back({speed_rpm, now_ns, m_timeout_ns + rampNs(speed_rpm)});
+        }
+
+        bool ActuationMonitor::readback(int32_t demand_rpm, uint16_t status_word, int64_t now_ns)
+        {
+            m_stats.velocity_demand_rpm.store(demand_rpm, std::memory_order_relaxed);
+            m_stats.status_word.store(status_word, std::memory_order_relaxed);
+            m_demand_rpm = demand_rpm;
+
+            if (m_halted || m_pending.empty()) {
+                return false;
+            }
+
+            // The newest applied setpoint confirms, and supersedes the older ones
+            if (operationEnabled(status_word)) {
+                for (size_t i = m_pending.size(); i-- > 0;) {
+                    if (std::abs(demand_rpm - m_pending[i].speed_rpm) <= m_tolerance_rpm) {
+                        m_stats.actuation.record(now_ns - m_pending[i].sent_ns);
+                        m_stats.actuation_confirmed.fetch_add(1, std::memory_order_relaxed);
+                        m_pending.erase(m_pending.begin(), m_pending.begin() + i + 1);
+                        break;
+                    }
+                }
+            }
+
+            // Each setpoint is reported once
+            bool timeout = false;
+            while (!m_pending.empty() && ((now_ns - m_pending.front().sent_ns) > m_pending.front().timeout_ns)) {
+                m_unconfirmed_rpm = m_pending.front().speed_rpm;
+                m_stats.actuation_unconfirmed.fetch_add(1, std::memory_order_relaxed);
+                m_pending.erase(m_pending.begin());
+                timeout = true;
+            }
+
+            return timeout;
+        }
+
+        void ActuationMonitor::setRamps(double acceleration_rpm_s, double deceleration_rpm_s)
+        {
+            m_acceleration_rpm_s = acceleration_rpm_s;
+            m_deceleration_rpm_s = deceleration_rpm_s;
+        }
+
+        int64_t ActuationMonitor::rampNs(int32_t speed_rpm) const
+        {
+            if ((m_acceleration_rpm_s <= 0.0) || (m_deceleration_rpm_s <= 0.0)) {
+                return 0;
+            }
+
+            // From the last velocity demand read back, the drive ramps through zero when reversing
+            double from_rpm = static_cast<double>(m_demand_rpm), to_rpm = static_cast<double>(speed_rpm);
+            double ramp_s;
+            if (from_rpm * to_rpm < 0.0) {
+                ramp_s = std::abs(from_rpm) / m_deceleration_rpm_s + std::abs(to_rpm) / m_acceleration_rpm_s;
+            } else if (std::abs(to_rpm) > std::abs(from_rpm)) {
+                ramp_s = (std::abs(to_rpm) - std::abs(from_rpm)) / m_acceleration_rpm_s;
+            } else {
+                ramp_s = (std::abs(from_rpm) - std::abs(to_rpm)) / m_deceleration_rpm_s;
+            }
+
+            return static_cast<int64_t>(ramp_s * 1e9);
+        }
+
+        void ActuationMonitor::setHalted(bool halted)
+        {
+            m_halted = halted;
+            reset();
+        }
+
+        void ActuationMonitor::reset()
+        {
+            // The next setpoint is tracked, even if it is the last one
+            m_pending.clear();
+            m_tracking = false;
+        }
+
+        int32_t ActuationMonitor::unconfirmedSetpoint() const
+        {
+            return m_unconfirmed_rpm;
+        }
+
+        bool ActuationMonitor::operationEnabled(uint16_t status_word)
+        {
+            return STATUS_WORD_OPERATION_ENABLED == (status_word & STATUS_WORD_STATE_MASK);
+        }
+    } // namespace swd
+} // namespace ezw
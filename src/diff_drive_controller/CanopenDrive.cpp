@@ -0,0 +1,454 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file CanopenDrive.cpp
+ */
+
+#include "diff_drive_controller/CanopenDrive.hpp"
+
+#include "ezw-smc-core/Config.hpp"
+
+#include <ros/console.h>
+
+#include <algorithm>
+#include <cmath>
+
+// Heartbeat of the drive, its NMT state is unknown after HEARTBEAT_LOST_FACTOR periods without one
+#define HEARTBEAT_PRODUCER_MS 100
+#define HEARTBEAT_LOST_FACTOR 3
+
+// CiA 402 control word commands
+#define CW_SHUTDOWN         0x0006
+#define CW_SWITCH_ON        0x0007
+#define CW_ENABLE_OPERATION 0x000F
+#define CW_FAULT_RESET      0x0080
+#define CW_NEW_SETPOINT     0x0010
+#define CW_HALT             0x0100
+
+namespace
+{
+    struct SdoWrite {
+        uint16_t index;
+        uint8_t  subindex;
+        uint32_t value;
+        uint8_t  size;
+    };
+
+    ezw::smccore::Controller::PDSState decodeStatusWord(uint16_t status_word)
+    {
+        using PDSState = ezw::smccore::Controller::PDSState;
+
+        if (0x0008 == (status_word & 0x004F)) {
+            return PDSState::FAULT;
+        }
+        if (0x000F == (status_word & 0x004F)) {
+            return PDSState::FAULT_REACTION_ACTIVE;
+        }
+        if (0x0040 == (status_word & 0x004F)) {
+            return PDSState::SWITCH_ON_DISABLED;
+        }
+
+        switch (status_word & 0x006F) {
+            case 0x0021:
+                return PDSState::READY_TO_SWITCH_ON;
+            case 0x0023:
+                return PDSState::SWITCHED_ON;
+            case 0x0027:
+                return PDSState::OPERATION_ENABLED;
+            case 0x0007:
+                return PDSState::QUICK_STOP_ACTIVE;
+            default:
+                return PDSState::SWITCH_ON_DISABLED; // Not ready to switch on
+        }
+    }
+} // namespace
+
+namespace ezw
+{
+    namespace swd
+    {
+        CanopenDrive::CanopenDrive(std::shared_ptr<CanopenMaster> master, uint8_t node_id, int64_t pdo_max_age_ns) :
+            m_master(std::move(master)), m_node_id(node_id), m_pdo_max_age_ns(pdo_max_age_ns)
+        {
+        }
+
+        ezw_error_t CanopenDrive::init(const std::string &name, const std::string &config_file)
+        {
+            ezw_error_t err;
+
+            /* Config init, for the wheel geometry */
+            auto lConfig = std::make_shared<ezw::smccore::Config>();
+            err          = lConfig->load(config_file);
+            if (err != ERROR_NONE) {
+                ROS_ERROR("Failed loading %s motor's config file <%s>, EZW_ERR: Config.init() return error code : %d", name.c_str(), config_file.c_str(), (int)err);
+                return err;
+            }
+
+            m_diameter_mm = lConfig->getDiameter();
+            m_reduction   = lConfig->getReduction();
+
+            // The PDOs are only mapped in pre-operational, the controller starts the node afterwards
+            err = m_master->sendNmt(CanopenMaster::NMT_PREOPERATIONAL, m_node_id);
+            if (ERROR_NONE != err) {
+                ROS_ERROR("Failed sending NMT command to %s motor (node %u on %s), EZW_ERR: %d", name.c_str(), m_node_id, m_master->interface().c_str(), (int)err);
+                return err;
+            }
+
+            // Position encoder resolution, increments per motor revolution
+            uint32_t increments = 0, revolutions = 0;
+            err                 = m_master->sdoUpload(m_node_id, 0x608F, 1, increments);
+            if (ERROR_NONE == err) {
+                err = m_master->sdoUpload(m_node_id, 0x608F, 2, revolutions);
+            }
+            if ((ERROR_NONE != err) || (0 == increments) || (0 == revolutions)) {
+                ROS_ERROR("Failed reading the encoder resolution of %s motor (node %u on %s), EZW_ERR: %d", name.c_str(), m_node_id, m_master->interface().c_str(), (int)err);
+                return (ERROR_NONE != err) ? err : DRIVE_ERROR_NOT_SUPPORTED;
+            }
+
+            // Position units per motor revolution, the increments unless the drive's factor group scales
+            // them (feed constant per driving shaft revolution, divided by the gear ratio). The profiled
+            // velocities and accelerations are in position units per second and per second squared.
+            double   units_per_rev = static_cast<double>(increments) / revolutions;
+            uint32_t gear_motor = 0, gear_shaft = 0, feed = 0, feed_shaft = 0;
+            if ((ERROR_NONE == m_master->sdoUpload(m_node_id, 0x6091, 1, gear_motor)) && (ERROR_NONE == m_master->sdoUpload(m_node_id, 0x6091, 2, gear_shaft)) &&
+                (ERROR_NONE == m_master->sdoUpload(m_node_id, 0x6092, 1, feed)) && (ERROR_NONE == m_master->sdoUpload(m_node_id, 0x6092, 2, feed_shaft)) &&
+                (0 != gear_motor) && (0 != gear_shaft) && (0 != feed) && (0 != feed_shaft)) {
+                units_per_rev = (static_cast<double>(feed) / feed_shaft) * (static_cast<double>(gear_shaft) / gear_motor);
+            }
+
+            m_mm_per_increment = M_PI * m_diameter_mm * revolutions / (increments * m_reduction);
+            m_mm_per_unit      = M_PI * m_diameter_mm / (units_per_rev * m_reduction);
+            m_units_per_rpm    = units_per_rev / 60.0;
+
+            ROS_INFO("%s motor (node %u on %s): %u increments per %u motor revolutions, %f position units per motor revolution.",
+                     name.c_str(), m_node_id, m_master->interface().c_str(), increments, revolutions, units_per_rev);
+
+            const uint32_t rpdo1 = 0x200 + m_node_id, tpdo1 = 0x180 + m_node_id, tpdo2 = 0x280 + m_node_id;
+
+            // RPDO1: vl target velocity and target velocity, applied on reception.
+            // TPDO1: internal position, status word and vl velocity demand, sent at each SYNC.
+            // TPDO2: velocity demand value of the profiled modes, sent at each SYNC.
+            // A PDO is disabled (bit 31 of its COB-ID) while its mapping is changed.
+            const SdoWrite configuration[] = {{0x1017, 0, HEARTBEAT_PRODUCER_MS, 2},
+                                              {0x1400, 1, 0x80000000 | rpdo1, 4},
+                                              {0x1400, 2, 0xFF, 1},
+                                              {0x1600, 0, 0, 1},
+                                              {0x1600, 1, 0x60420010, 4},
+                                              {0x1600, 2, 0x60FF0020, 4},
+                                              {0x1600, 0, 2, 1},
+                                              {0x1400, 1, rpdo1, 4},
+                                              {0x1800, 1, 0x80000000 | tpdo1, 4},
+                                              {0x1800, 2, 1, 1},
+                                              {0x1A00, 0, 0, 1},
+                                              {0x1A00, 1, 0x60630020, 4},
+                                              {0x1A00, 2, 0x60410010, 4},
+                                              {0x1A00, 3, 0x60430010, 4},
+                                              {0x1A00, 0, 3, 1},
+                                              {0x1800, 1, tpdo1, 4},
+                                              {0x1801, 1, 0x80000000 | tpdo2, 4},
+                                              {0x1801, 2, 1, 1},
+                                              {0x1A01, 0, 0, 1},
+                                              {0x1A01, 1, 0x606B0020, 4},
+                                              {0x1A01, 0, 1, 1},
+                                              {0x1801, 1, tpdo2, 4},
+                                              {0x6060, 0, static_cast<uint32_t>(OperationMode::VELOCITY), 1}};
+
+            for (const SdoWrite &w : configuration) {
+                err = m_master->sdoDownload(m_node_id, w.index, w.subindex, w.value, w.size);
+                if (ERROR_NONE != err) {
+                    ROS_ERROR("Failed configuring %s motor (node %u on %s), writing 0x%04X:%u, EZW_ERR: %d", name.c_str(), m_node_id, m_master->interface().c_str(), w.index, w.subindex, (int)err);
+                    return err;
+                }
+            }
+
+            return ERROR_NONE;
+        }
+
+        double CanopenDrive::getDiameter() const
+        {
+            return m_diameter_mm;
+        }
+
+        double CanopenDrive::getReduction() const
+        {
+            return m_reduction;
+        }
+
+        ezw_error_t CanopenDrive::getOdometryValue(int32_t &dist_mm)
+        {
+            int64_t     increments;
+            ezw_error_t err = getPosition(increments);
+            if (ERROR_NONE != err) {
+                return err;
+            }
+
+            dist_mm = static_cast<int32_t>(std::llround(increments * m_mm_per_increment));
+            return ERROR_NONE;
+        }
+
+        ezw_error_t CanopenDrive::getNMTState(smccore::Controller::NMTState &state)
+        {
+            uint8_t nmt_state;
+            if (!m_master->nmtState(m_node_id, nmt_state, static_cast<int64_t>(HEARTBEAT_LOST_FACTOR * HEARTBEAT_PRODUCER_MS) * 1000000)) {
+                state = smccore::Controller::NMTState::UNKNOWN;
+                return DRIVE_ERROR_TIMEOUT;
+            }
+
+            switch (nmt_state) {
+                case CanopenMaster::NMT_STATE_OPERATIONAL:
+                    state = smccore::Controller::NMTState::OPER;
+                    break;
+                case CanopenMaster::NMT_STATE_PREOPERATIONAL:
+                    state = smccore::Controller::NMTState::PREOP;
+                    break;
+                case CanopenMaster::NMT_STATE_STOPPED:
+                    state = smccore::Controller::NMTState::STOP;
+                    break;
+                default:
+                    state = smccore::Controller::NMTState::UNKNOWN;
+                    break;
+            }
+            return ERROR_NONE;
+        }
+
+        ezw_error_t CanopenDrive::setNMTState(smccore::Controller::NMTCommand command)
+        {
+            switch (command) {
+                case smccore::Controller::NMTCommand::OPER:
+                    return m_master->sendNmt(CanopenMaster::NMT_START, m_node_id);
+                case smccore::Controller::NMTCommand::PREOP:
+                    return m_master->sendNmt(CanopenMaster::NMT_PREOPERATIONAL, m_node_id);
+                case smccore::Controller::NMTCommand::STOP:
+                    return m_master->sendNmt(CanopenMaster::NMT_STOP, m_node_id);
+                case smccore::Controller::NMTCommand::RESET_NODE:
+                    return m_master->sendNmt(CanopenMaster::NMT_RESET_NODE, m_node_id);
+                case smccore::Controller::NMTCommand::RESET_COMM:
+                    return m_master->sendNmt(CanopenMaster::NMT_RESET_COMM, m_node_id);
+            }
+            return DRIVE_ERROR_NOT_SUPPORTED;
+        }
+
+        ezw_error_t CanopenDrive::getPDSState(smccore::Controller::PDSState &state)
+        {
+            uint16_t    status_word;
+            ezw_error_t err = getStatusWord(status_word);
+            if (ERROR_NONE != err) {
+                return err;
+            }
+
+            state = decodeStatusWord(status_word);
+            return ERROR_NONE;
+        }
+
+        ezw_error_t CanopenDrive::enterInOperationEnabledState()
+        {
+            smccore::Controller::PDSState state;
+            ezw_error_t                   err = getPDSState(state);
+            if (ERROR_NONE != err) {
+                return err;
+            }
+
+            if (smccore::Controller::PDSState::FAULT == state) {
+                err = setControlWord(CW_FAULT_RESET);
+                if (ERROR_NONE != err) {
+                    return err;
+                }
+            }
+
+            for (uint16_t command : {CW_SHUTDOWN, CW_SWITCH_ON, CW_ENABLE_OPERATION}) {
+                err = setControlWord(command);
+                if (ERROR_NONE != err) {
+                    return err;
+                }
+            }
+
+            return ERROR_NONE;
+        }
+
+        ezw_error_t CanopenDrive::setHalt(bool halt)
+        {
+            m_halt = halt;
+            return setControlWord(m_control_word);
+        }
+
+        ezw_error_t CanopenDrive::setTargetVelocity(int32_t speed_rpm)
+        {
+            // Both mapped objects are set, the drive follows the one of its mode of operation:
+            // the vl target velocity in rpm, the target velocity in position units per second
+            int16_t vl_rpm = static_cast<int16_t>(std::max<int32_t>(INT16_MIN, std::min<int32_t>(INT16_MAX, speed_rpm)));
+            int32_t speed  = toUnits(speed_rpm);
+            uint8_t data[6];
+            data[0] = static_cast<uint8_t>(vl_rpm);
+            data[1] = static_cast<uint8_t>(vl_rpm >> 8);
+            for (int i = 0; i < 4; ++i) {
+                data[2 + i] = static_cast<uint8_t>(static_cast<uint32_t>(speed) >> (8 * i));
+            }
+
+            return m_master->sendPdo(0x200 + m_node_id, data, sizeof(data));
+        }
+
+        ezw_error_t CanopenDrive::getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value)
+        {
+            (void)id;
+
+            // The safety functions are manufacturer objects, only known to the SMC core
+            value = true;
+            return DRIVE_ERROR_NOT_SUPPORTED;
+        }
+
+        ezw_error_t CanopenDrive::getVelocityDemand(int32_t &speed_rpm)
+        {
+            uint32_t value;
+            uint8_t  data[8];
+
+            // vl velocity demand (INT16) in velocity mode, velocity demand value (INT32) in the profiled modes
+            if (OperationMode::VELOCITY == m_mode) {
+                if (m_master->tpdo(m_node_id, 1, data, m_pdo_max_age_ns)) {
+                    speed_rpm = static_cast<int16_t>(data[6] | (data[7] << 8));
+                    return ERROR_NONE;
+                }
+
+                ezw_error_t err = m_master->sdoUpload(m_node_id, 0x6043, 0, value);
+                speed_rpm       = static_cast<int16_t>(value);
+                return err;
+            }
+
+            ezw_error_t err = ERROR_NONE;
+            if (m_master->tpdo(m_node_id, 2, data, m_pdo_max_age_ns)) {
+                value = data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+            } else {
+                err = m_master->sdoUpload(m_node_id, 0x606B, 0, value);
+            }
+
+            speed_rpm = static_cast<int32_t>(std::lround(static_cast<int32_t>(value) / m_units_per_rpm));
+            return err;
+        }
+
+        ezw_error_t CanopenDrive::getStatusWord(uint16_t &status_word)
+        {
+            uint8_t data[8];
+            if (m_master->tpdo(m_node_id, 1, data, m_pdo_max_age_ns)) {
+                status_word = static_cast<uint16_t>(data[4] | (data[5] << 8));
+                return ERROR_NONE;
+            }
+
+            uint32_t    value;
+            ezw_error_t err = m_master->sdoUpload(m_node_id, 0x6041, 0, value);
+            status_word     = static_cast<uint16_t>(value);
+            return err;
+        }
+
+        ezw_error_t CanopenDrive::setOperationMode(OperationMode mode)
+        {
+            ezw_error_t err = m_master->sdoDownload(m_node_id, 0x6060, 0, static_cast<uint32_t>(mode), 1);
+            if (ERROR_NONE != err) {
+                return err;
+            }
+
+            // The operation mode specific bits of the control word follow
+            m_mode = mode;
+            return setControlWord(m_control_word & CW_ENABLE_OPERATION);
+        }
+
+        ezw_error_t CanopenDrive::setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s)
+        {
+            // Position units per second, and per second squared
+            ezw_error_t err = m_master->sdoDownload(m_node_id, 0x6081, 0, static_cast<uint32_t>(toUnits(velocity_rpm)), 4);
+            if (ERROR_NONE == err) {
+                err = m_master->sdoDownload(m_node_id, 0x6083, 0, static_cast<uint32_t>(toUnits(acceleration_rpm_s)), 4);
+            }
+            if (ERROR_NONE == err) {
+                err = m_master->sdoDownload(m_node_id, 0x6084, 0, static_cast<uint32_t>(toUnits(deceleration_rpm_s)), 4);
+            }
+            return err;
+        }
+
+        ezw_error_t CanopenDrive::startRelativeMove(int32_t distance_mm)
+        {
+            if (OperationMode::PROFILE_POSITION != m_mode) {
+                return DRIVE_ERROR_NOT_READY;
+            }
+
+            int32_t     units = static_cast<int32_t>(std::lround(distance_mm / m_mm_per_unit));
+            ezw_error_t err   = m_master->sdoDownload(m_node_id, 0x607A, 0, static_cast<uint32_t>(units), 4);
+            if (ERROR_NONE != err) {
+                return err;
+            }
+
+            // The move starts on the rising edge of the new set-point bit
+            err = setControlWord(CW_ENABLE_OPERATION);
+            if (ERROR_NONE != err) {
+                return err;
+            }
+            return setControlWord(CW_ENABLE_OPERATION | CW_NEW_SETPOINT);
+        }
+
+        ezw_error_t CanopenDrive::setCommunicationTimeout(uint16_t timeout_ms)
+        {
+            // Consumer heartbeat time of the master, and quick stop on its loss
+            ezw_error_t err = m_master->sdoDownload(m_node_id, 0x1016, 1, (static_cast<uint32_t>(m_master->nodeId()) << 16) | timeout_ms, 4);
+            if ((ERROR_NONE == err) && (timeout_ms > 0)) {
+                err = m_master->sdoDownload(m_node_id, 0x6007, 0, 3, 2);
+            }
+            return err;
+        }
+
+        ezw_error_t CanopenDrive::sendHeartbeat()
+        {
+            return m_master->sendHeartbeat();
+        }
+
+        ezw_error_t CanopenDrive::getPosition(int64_t &increments)
+        {
+            uint32_t raw;
+            uint8_t  data[8];
+            if (m_master->tpdo(m_node_id, 1, data, m_pdo_max_age_ns)) {
+                raw = data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+            } else {
+                ezw_error_t err = m_master->sdoUpload(m_node_id, 0x6063, 0, raw);
+                if (ERROR_NONE != err) {
+                    return err;
+                }
+            }
+
+            // The INT32 position wraps around after about 2^31 increments, the modular
+            // difference between two reads is the travel in between
+            if (m_position_known) {
+                m_increments += static_cast<int32_t>(raw - m_raw_position);
+            } else {
+                m_increments = static_cast<int32_t>(raw);
+            }
+            m_raw_position   = raw;
+            m_position_known = true;
+
+            increments = m_increments;
+            return ERROR_NONE;
+        }
+
+        int32_t CanopenDrive::toUnits(double rpm) const
+        {
+            double units = std::round(rpm * m_units_per_rpm);
+            return static_cast<int32_t>(std::max<double>(INT32_MIN, std::min<double>(INT32_MAX, units)));
+        }
+
+        ezw_error_t CanopenDrive::setControlWord(uint16_t control_word)
+        {
+            m_control_word = control_word & ~CW_HALT;
+
+            // Bits 4 to 6 are specific to the mode of operation, once the operation is enabled
+            if (CW_ENABLE_OPERATION == (control_word & CW_ENABLE_OPERATION)) {
+                if (OperationMode::VELOCITY == m_mode) {
+                    control_word |= 0x0070; // Ramp enabled, unlocked and following the target
+                } else if (OperationMode::PROFILE_POSITION == m_mode) {
+                    control_word |= 0x0040; // Relative moves
+                }
+            }
+
+            if (m_halt) {
+                control_word |= CW_HALT;
+            }
+
+            return m_master->sdoDownload(m_node_id, 0x6040, 0, control_word, 2);
+        }
+    } // namespace swd
+} // namespace ezw
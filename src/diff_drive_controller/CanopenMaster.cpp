@@ -0,0 +1,335 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file CanopenMaster.cpp
+ */
+
+#include "diff_drive_controller/CanopenMaster.hpp"
+#include "diff_drive_controller/StateStore.hpp"
+
+#include <ros/console.h>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+
+// Period of the stop flag checks
+#define RECEIVE_POLL_MS 200
+
+// COB-IDs of the predefined connection set (CiA 301)
+#define COB_NMT       0x000
+#define COB_SYNC      0x080
+#define COB_TPDO1     0x180
+#define COB_TPDO2     0x280
+#define COB_SDO_TX    0x580
+#define COB_SDO_RX    0x600
+#define COB_HEARTBEAT 0x700
+
+// SDO command specifiers
+#define SDO_DOWNLOAD_REQUEST  0x23 // Expedited, size indicated, 4 - n bytes in bits 2-3
+#define SDO_DOWNLOAD_RESPONSE 0x60
+#define SDO_UPLOAD_REQUEST    0x40
+#define SDO_UPLOAD_RESPONSE   0x43 // Expedited, size indicated, 4 - n bytes in bits 2-3
+#define SDO_ABORT             0x80
+
+namespace ezw
+{
+    namespace swd
+    {
+        CanopenMaster::CanopenMaster(uint8_t node_id, int sdo_timeout_ms) :
+            m_node_id(node_id), m_sdo_timeout_ns(static_cast<int64_t>(sdo_timeout_ms) * 1000000)
+        {
+        }
+
+        CanopenMaster::~CanopenMaster()
+        {
+            stop();
+        }
+
+        bool CanopenMaster::start(const std::string &interface, int sync_period_ms)
+        {
+            m_socket = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+            if (m_socket < 0) {
+                return false;
+            }
+
+            ifreq ifr = {};
+            std::strncpy(ifr.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+            if (0 != ioctl(m_socket, SIOCGIFINDEX, &ifr)) {
+                close(m_socket);
+                m_socket = -1;
+                return false;
+            }
+
+            sockaddr_can addr = {};
+            addr.can_family   = AF_CAN;
+            addr.can_ifindex  = ifr.ifr_ifindex;
+            if (0 != bind(m_socket, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))) {
+                close(m_socket);
+                m_socket = -1;
+                return false;
+            }
+
+            m_interface      = interface;
+            m_sync_period_ms = sync_period_ms;
+            m_stop           = false;
+            m_receive_thread = std::thread(&CanopenMaster::runReceive, this);
+            if (m_sync_period_ms > 0) {
+                m_sync_thread = std::thread(&CanopenMaster::runSync, this);
+            }
+
+            return true;
+        }
+
+        void CanopenMaster::stop()
+        {
+            m_stop = true;
+
+            if (m_sync_thread.joinable()) {
+                m_sync_thread.join();
+            }
+
+            if (m_receive_thread.joinable()) {
+                m_receive_thread.join();
+            }
+
+            if (m_socket >= 0) {
+                close(m_socket);
+                m_socket = -1;
+            }
+        }
+
+        uint8_t CanopenMaster::nodeId() const
+        {
+            return m_node_id;
+        }
+
+        const std::string &CanopenMaster::interface() const
+        {
+            return m_interface;
+        }
+
+        int CanopenMaster::syncPeriodMs() const
+        {
+            return m_sync_period_ms;
+        }
+
+        ezw_error_t CanopenMaster::sendNmt(uint8_t command, uint8_t node_id)
+        {
+            const uint8_t data[2] = {command, node_id};
+            return send(COB_NMT, data, sizeof(data));
+        }
+
+        ezw_error_t CanopenMaster::sdoDownload(uint8_t node_id, uint16_t index, uint8_t subindex, uint32_t value, uint8_t size)
+        {
+            if ((size < 1) || (size > 4)) {
+                return DRIVE_ERROR_NOT_SUPPORTED;
+            }
+
+            uint8_t request[8] = {static_cast<uint8_t>(SDO_DOWNLOAD_REQUEST | ((4 - size) << 2)),
+                                  static_cast<uint8_t>(index & 0xFF),
+                                  static_cast<uint8_t>(index >> 8),
+                                  subindex};
+            for (int i = 0; i < size; ++i) {
+                request[4 + i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+
+            uint8_t     response[8];
+            ezw_error_t err = sdoTransfer(node_id, request, response);
+            if (ERROR_NONE != err) {
+                return err;
+            }
+
+            return (SDO_DOWNLOAD_RESPONSE == response[0]) ? ERROR_NONE : DRIVE_ERROR_IO;
+        }
+
+        ezw_error_t CanopenMaster::sdoUpload(uint8_t node_id, uint16_t index, uint8_t subindex, uint32_t &value)
+        {
+            const uint8_t request[8] = {SDO_UPLOAD_REQUEST, static_cast<uint8_t>(index & 0xFF), static_cast<uint8_t>(index >> 8), subindex};
+
+            uint8_t     response[8];
+            ezw_error_t err = sdoTransfer(node_id, request, response);
+            if (ERROR_NONE != err) {
+                return err;
+            }
+
+            // Only the expedited transfers are supported, the objects used by the drives fit in 4 bytes
+            if (SDO_UPLOAD_RESPONSE != (response[0] & 0xF3)) {
+                return DRIVE_ERROR_NOT_SUPPORTED;
+            }
+
+            int size = 4 - ((response[0] >> 2) & 0x03);
+            value    = 0;
+            for (int i = 0; i < size; ++i) {
+                value |= static_cast<uint32_t>(response[4 + i]) << (8 * i);
+            }
+
+            return ERROR_NONE;
+        }
+
+        ezw_error_t CanopenMaster::sendPdo(uint16_t cob_id, const uint8_t *data, uint8_t size)
+        {
+            return send(cob_id, data, size);
+        }
+
+        ezw_error_t CanopenMaster::sendHeartbeat()
+        {
+            const uint8_t data[1] = {NMT_STATE_OPERATIONAL};
+            return send(COB_HEARTBEAT + m_node_id, data, sizeof(data));
+        }
+
+        bool CanopenMaster::nmtState(uint8_t node_id, uint8_t &state, int64_t max_age_ns)
+        {
+            Node                       &node = m_nodes[node_id & 0x7F];
+            std::lock_guard<std::mutex> lock(node.mtx);
+
+            if ((0 == node.heartbeat_ns) || ((StateStore::monotonicNs() - node.heartbeat_ns) > max_age_ns)) {
+                return false;
+            }
+
+            state = node.nmt_state;
+            return true;
+        }
+
+        bool CanopenMaster::tpdo(uint8_t node_id, unsigned number, uint8_t *data, int64_t max_age_ns)
+        {
+            if ((number < 1) || (number > TPDOS)) {
+                return false;
+            }
+
+            Node                       &node = m_nodes[node_id & 0x7F];
+            unsigned                    i    = number - 1;
+            std::lock_guard<std::mutex> lock(node.mtx);
+
+            if ((0 == node.tpdo_ns[i]) || ((StateStore::monotonicNs() - node.tpdo_ns[i]) > max_age_ns)) {
+                return false;
+            }
+
+            std::memcpy(data, node.tpdo[i], sizeof(node.tpdo[i]));
+            return true;
+        }
+
+        ezw_error_t CanopenMaster::send(uint32_t cob_id, const uint8_t *data, uint8_t size)
+        {
+            if (m_socket < 0) {
+                return DRIVE_ERROR_NOT_READY;
+            }
+
+            can_frame frame = {};
+            frame.can_id    = cob_id;
+            frame.can_dlc   = size;
+            if (size > 0) {
+                std::memcpy(frame.data, data, size);
+            }
+
+            return (static_cast<ssize_t>(sizeof(frame)) == write(m_socket, &frame, sizeof(frame))) ? ERROR_NONE : DRIVE_ERROR_IO;
+        }
+
+        ezw_error_t CanopenMaster::sdoTransfer(uint8_t node_id, const uint8_t *request, uint8_t *response)
+        {
+            Node                       &node = m_nodes[node_id & 0x7F];
+            std::lock_guard<std::mutex> transaction(node.sdo_mtx);
+
+            {
+                std::lock_guard<std::mutex> lock(node.mtx);
+                node.sdo_waiting  = true;
+                node.sdo_answered = false;
+            }
+
+            ezw_error_t err = send(COB_SDO_RX + node_id, request, 8);
+            if (ERROR_NONE != err) {
+                std::lock_guard<std::mutex> lock(node.mtx);
+                node.sdo_waiting = false;
+                return err;
+            }
+
+            std::unique_lock<std::mutex> lock(node.mtx);
+            node.sdo_cv.wait_for(lock, std::chrono::nanoseconds(m_sdo_timeout_ns), [&node]() { return node.sdo_answered; });
+            node.sdo_waiting = false;
+            if (!node.sdo_answered) {
+                return DRIVE_ERROR_TIMEOUT;
+            }
+
+            // The response has to be about the requested object
+            if (0 != std::memcmp(node.sdo_response + 1, request + 1, 3)) {
+                return DRIVE_ERROR_IO;
+            }
+
+            if (SDO_ABORT == node.sdo_response[0]) {
+                uint32_t code = 0;
+                for (int i = 0; i < 4; ++i) {
+                    code |= static_cast<uint32_t>(node.sdo_response[4 + i]) << (8 * i);
+                }
+                ROS_WARN_THROTTLE(1.0, "SDO transfer of 0x%04X:%u aborted by node %u, abort code 0x%08X", request[1] | (request[2] << 8), request[3], node_id, code);
+                return DRIVE_ERROR_IO;
+            }
+
+            std::memcpy(response, node.sdo_response, sizeof(node.sdo_response));
+            return ERROR_NONE;
+        }
+
+        void CanopenMaster::runReceive()
+        {
+            while (!m_stop) {
+                pollfd pfd = {m_socket, POLLIN, 0};
+                if (poll(&pfd, 1, RECEIVE_POLL_MS) <= 0) {
+                    continue;
+                }
+
+                can_frame frame;
+                if (static_cast<ssize_t>(sizeof(frame)) != read(m_socket, &frame, sizeof(frame))) {
+                    continue;
+                }
+
+                // The predefined connection set only uses standard frames
+                if (frame.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) {
+                    continue;
+                }
+
+                uint32_t function = frame.can_id & 0x780;
+                uint8_t  node_id  = frame.can_id & 0x7F;
+                Node    &node     = m_nodes[node_id];
+                int64_t  now_ns   = StateStore::monotonicNs();
+
+                std::lock_guard<std::mutex> lock(node.mtx);
+                if ((COB_SDO_TX == function) && (8 == frame.can_dlc) && node.sdo_waiting) {
+                    std::memcpy(node.sdo_response, frame.data, sizeof(node.sdo_response));
+                    node.sdo_answered = true;
+                    node.sdo_cv.notify_one();
+                } else if ((COB_TPDO1 == function) || (COB_TPDO2 == function)) {
+                    unsigned i = (COB_TPDO1 == function) ? 0 : 1;
+                    std::memset(node.tpdo[i], 0, sizeof(node.tpdo[i]));
+                    std::memcpy(node.tpdo[i], frame.data, frame.can_dlc);
+                    node.tpdo_ns[i] = now_ns;
+                } else if ((COB_HEARTBEAT == function) && (1 == frame.can_dlc)) {
+                    node.nmt_state    = frame.data[0] & 0x7F; // Bit 7 is the toggle bit of the node guarding
+                    node.heartbeat_ns = now_ns;
+                }
+            }
+        }
+
+        void CanopenMaster::runSync()
+        {
+            const auto period    = std::chrono::milliseconds(m_sync_period_ms);
+            auto       next_sync = std::chrono::steady_clock::now();
+
+            while (!m_stop) {
+                send(COB_SYNC, nullptr, 0);
+
+                next_sync += period;
+                auto now = std::chrono::steady_clock::now();
+                if (next_sync < now) {
+                    next_sync = now; // No burst of SYNCs after a stall
+                }
+                std::this_thread::sleep_until(next_sync);
+            }
+        }
+    } // namespace swd
+} // namespace ezw
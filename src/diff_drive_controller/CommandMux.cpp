@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file CommandMux.cpp
+ */
+
+#include "diff_drive_controller/CommandMux.hpp"
+
+#include <limits>
+
+namespace ezw
+{
+    namespace swd
+    {
+        CommandMux::Input::Input(const std::string &name, int priority, double timeout_s) :
+            name(name), priority(priority), timeout_ns(static_cast<int64_t>(timeout_s * 1e9))
+        {
+        }
+
+        bool CommandMux::Input::expired(int64_t now_ns) const
+        {
+            return (timeout_ns > 0) && (!received || ((now_ns - stamp_ns) > timeout_ns));
+        }
+
+        size_t CommandMux::addSource(const std::string &name, int priority, double timeout_s)
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_sources.emplace_back(name, priority, timeout_s);
+            return m_sources.size() - 1;
+        }
+
+        size_t CommandMux::addLock(const std::string &name, int priority, double timeout_s)
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_locks.emplace_back(name, priority, timeout_s);
+            return m_locks.size() - 1;
+        }
+
+        bool CommandMux::arbitrate(size_t source, int64_t now_ns)
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+
+            Input &input   = m_sources[source];
+            input.stamp_ns = now_ns;
+            input.received = true;
+
+            // The sources must be strictly above the highest engaged lock
+            int priority = std::numeric_limits<int>::min();
+            for (const Input &l : m_locks) {
+                if ((l.locked || l.expired(now_ns)) && (l.priority > priority)) {
+                    priority = l.priority;
+                }
+            }
+
+            const Input *selected = nullptr;
+            for (const Input &s : m_sources) {
+                if (s.received && !s.expired(now_ns) && (s.priority > priority)) {
+                    priority = s.priority;
+                    selected = &s;
+                }
+            }
+
+            if (&input != selected) {
+                input.overridden.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            input.executed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void CommandMux::setLock(size_t lock, bool locked, int64_t now_ns)
+        {
+            std::lock_guard<std::mutex> guard(m_mtx);
+
+            Input &input   = m_locks[lock];
+            input.stamp_ns = now_ns;
+            input.received = true;
+            input.locked   = locked;
+        }
+
+        size_t CommandMux::sources() const
+        {
+            return m_sources.size();
+        }
+
+        const std::string &CommandMux::sourceName(size_t source) const
+        {
+            return m_sources[source].name;
+        }
+
+        uint64_t CommandMux::executed(size_t source) const
+        {
+            return m_sources[source].executed.load(std::memory_order_relaxed);
+        }
+
+        uint64_t CommandMux::overridden(size_t source) const
+        {
+            return m_sources[source].overridden.load(std::memory_order_relaxed);
+        }
+    } // namespace swd
+} // namespace ezw
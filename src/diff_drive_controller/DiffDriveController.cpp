@@ -5,13 +5,16 @@
  */
 
 #include "diff_drive_controller/DiffDriveController.hpp"
+#include "diff_drive_controller/CanopenDrive.hpp"
+#include "diff_drive_controller/InstrumentedDrive.hpp"
+#include "diff_drive_controller/SimClock.hpp"
+#include "diff_drive_controller/SimDrive.hpp"
+#include "diff_drive_controller/SmcDrive.hpp"
 
-#include "ezw-smc-core/CANOpenDispatcher.hpp"
-
-#include "ezw-canopen-service/DBusClient.hpp"
-
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <geometry_msgs/TransformStamped.h>
 #include <nav_msgs/Odometry.h>
+#include <std_msgs/String.h>
 
 #include <ros/console.h>
 #include <ros/duration.h>
@@ -19,6 +22,11 @@
 
 #include <tf2/LinearMath/Quaternion.h>
 #include <limits>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <tuple>
+#include <unistd.h>
 
 using namespace std::chrono_literals;
 
@@ -33,11 +41,98 @@ using namespace std::chrono_literals;
 #define DEFAULT_MAX_WHEEL_SPEED_RPM     75.0 // 75 rpm Wheel => Motor (75 * 14 = 1050 rpm)
 #define DEFAULT_MAX_SLS_WHEEL_RPM       30.0 // 30 rpm Wheel => Motor (30 * 14 = 490 rpm)
 #define DEFAULT_PUB_FREQ_HZ             50
+#define DEFAULT_ODOM_INTEGRATION        std::string("Euler")
 #define DEFAULT_WATCHDOG_MS             1000
 #define DEFAULT_PUBLISH_ODOM            true
 #define DEFAULT_PUBLISH_TF              true
+#define DEFAULT_PRESERIALIZED_PUBLISH   true
 #define DEFAULT_PUBLISH_SAFETY_FCNS     true
+#define DEFAULT_PUBLISH_ROBOT_STATE     false
 #define DEFAULT_BACKWARD_SLS            false
+#define DEFAULT_DRIVE_BACKEND           std::string("SMC")
+#define DEFAULT_CAN_INTERFACE           std::string("can0")
+#define DEFAULT_CAN_SYNC_PERIOD_MS      10
+#define DEFAULT_CAN_SDO_TIMEOUT_MS      100
+#define DEFAULT_CAN_MASTER_NODE_ID      127
+#define DEFAULT_SIM_WHEEL_DIAMETER_MM   150.0
+#define DEFAULT_SIM_MOTOR_REDUCTION     14.0
+#define DEFAULT_SIM_TIME_CONSTANT_MS    50
+#define DEFAULT_HOT_STANDBY             false
+#define DEFAULT_HOT_STANDBY_TIMEOUT_MS  100
+#define DEFAULT_HOT_STANDBY_STALL_MS    1000
+#define DEFAULT_HOT_STANDBY_SHM_NAME    std::string("/swd_diff_drive_controller")
+#define DEFAULT_CHECKPOINT_MAX_GAP_MM   50
+#define DEFAULT_USE_IMU                 false
+#define DEFAULT_IMU_GYRO_WEIGHT         0.98
+#define DEFAULT_IMU_YAW_RATE_STDDEV     0.01 // rad/s
+#define DEFAULT_IMU_TIMEOUT_MS          100
+#define DEFAULT_CALIBRATION             false
+#define DEFAULT_CALIBRATION_APPLY       false
+#define DEFAULT_CALIBRATION_FORGETTING  0.999
+#define DEFAULT_CALIBRATION_TRAVEL_M    0.05
+#define DEFAULT_SLIP_DETECTION          true
+#define DEFAULT_SLIP_RESPONSE_TIME_MS   200
+#define DEFAULT_SLIP_SPEED_TOLERANCE    0.1 // m/s
+#define DEFAULT_SLIP_RELATIVE_TOLERANCE 0.2
+#define DEFAULT_SLIP_YAW_RATE_TOLERANCE 0.2 // rad/s
+#define DEFAULT_CHAR_REPORT_FILE        std::string("swd_drive_characterisation.yaml")
+#define DEFAULT_CHAR_SPEED_RPM          30.0 // Wheel speed
+#define DEFAULT_CHAR_SAMPLE_HZ          1000
+#define DEFAULT_CHAR_STEP_S             2.0
+#define DEFAULT_CHAR_CHIRP_S            20.0
+#define DEFAULT_CHAR_CHIRP_MIN_HZ       0.5
+#define DEFAULT_CHAR_CHIRP_MAX_HZ       10.0
+#define DEFAULT_PUBLISH_DIAGNOSTICS     true
+#define DEFAULT_METRICS_ADDRESS         std::string("127.0.0.1")
+#define DEFAULT_METRICS_PORT            0 // Disabled
+#define DEFAULT_OVERLOAD_SHEDDING       true
+#define DEFAULT_OVERLOAD_MISS_RATIO     0.2
+#define DEFAULT_OVERLOAD_RECOVER_S      5
+#define DEFAULT_ACTUATION_READBACK      false
+#define DEFAULT_ACTUATION_TIMEOUT_MS    200
+#define DEFAULT_ACTUATION_TOLERANCE_RPM 1
+#define DEFAULT_RELATIVE_MOVES          false
+#define DEFAULT_RELATIVE_MOVE_SPEED     0.2 // m/s
+#define DEFAULT_RELATIVE_MOVE_ACCEL     0.5 // m/s^2
+#define DEFAULT_DRIVE_RAMPING           false
+#define DEFAULT_DRIVE_ACCELERATION      0.5 // m/s^2, as in cfg/DriveRamp.cfg
+#define DEFAULT_DRIVE_DECELERATION      1.0 // m/s^2
+#define DEFAULT_DRIVE_TIMEOUT           false
+
+// Safety functions polling period. When shed by the overload policy, only the SLS limiting the
+// setpoints keeps being polled at this period, the other functions are read and published every
+// SAFETY_SHED_DECIMATION periods.
+#define SAFETY_PERIOD_S        (1.0 / 5.0)
+#define SAFETY_SHED_DECIMATION 5
+
+// The owner's heartbeat is refreshed this many times per hot_standby_timeout_ms
+#define HOT_STANDBY_HEARTBEATS 4
+
+// Health diagnostics period, and niceness of their thread
+#define DIAGNOSTICS_PERIOD_S 1.0
+#define DIAGNOSTICS_NICE     19
+
+// Gyro bias is only learnt while the robot stands still, with this low-pass gain per IMU sample
+#define GYRO_BIAS_GAIN 0.01
+
+// Calibrated values are only applied within these bounds around the nominal ones
+#define CALIBRATION_MAX_DEVIATION 0.2 // 20%
+
+// When shed by the overload policy, TF is only sent every OVERLOAD_TF_DECIMATION control cycles
+#define OVERLOAD_TF_DECIMATION 5
+
+// A relative move is aborted when it lasts longer than its planned duration times this factor, plus the margin
+#define MOVE_TIMEOUT_FACTOR   2.0
+#define MOVE_TIMEOUT_MARGIN_S 1.0
+
+// A wheel whose target reached bit is seen, but not the start of its move, is done within this distance of the target
+#define MOVE_POSITION_TOLERANCE_MM 1
+
+// Target reached bit of the CiA 402 status word
+#define STATUS_WORD_TARGET_REACHED 0x0400
+
+// With the SocketCAN backend, the TPDOs older than this number of SYNC periods are ignored
+#define CAN_PDO_MAX_AGE_SYNCS 3
 
 // Relative errors, used to calculate the covariance matrix in the odometry message
 // Used as follow:
@@ -45,10 +140,75 @@ using namespace std::chrono_literals;
 #define DEFAULT_LEFT_RELATIVE_ERROR  0.05 // 5% of error
 #define DEFAULT_RIGHT_RELATIVE_ERROR 0.05
 
+// Relative error added, for each consecutive missed sample, to a wheel whose
+// displacement is extrapolated from its last measured speed
+#define DEFAULT_EXTRAPOLATION_RELATIVE_ERROR 0.5 // 50% of error per missed sample
+
+// Acceleration a wheel may have had since its last measured speed, so that even a wheel
+// extrapolated from standstill grows in uncertainty with each missed sample
+#define DEFAULT_EXTRAPOLATION_MAX_ACCEL 1.0 // m/s^2
+
 namespace ezw
 {
     namespace swd
     {
+        namespace
+        {
+            struct CommandInput {
+                std::string name, topic;
+                int         priority;
+                double      timeout_s;
+            };
+
+            // twist_mux like list of {name, topic, priority, timeout (s)}
+            std::vector<CommandInput> readCommandInputs(const ros::NodeHandle &nh, const std::string &param)
+            {
+                std::vector<CommandInput> inputs;
+                XmlRpc::XmlRpcValue       list;
+
+                if (!nh.getParam(param, list)) {
+                    return inputs;
+                }
+
+                if (XmlRpc::XmlRpcValue::TypeArray != list.getType()) {
+                    ROS_ERROR("Parameter '%s' must be a list.", param.c_str());
+                    throw std::runtime_error("Invalid " + param + " parameter");
+                }
+
+                for (int i = 0; i < list.size(); i++) {
+                    XmlRpc::XmlRpcValue &item = list[i];
+
+                    if ((XmlRpc::XmlRpcValue::TypeStruct != item.getType()) || !item.hasMember("name") || !item.hasMember("topic") || !item.hasMember("priority") ||
+                        !item.hasMember("timeout") || (XmlRpc::XmlRpcValue::TypeString != item["name"].getType()) ||
+                        (XmlRpc::XmlRpcValue::TypeString != item["topic"].getType()) || (XmlRpc::XmlRpcValue::TypeInt != item["priority"].getType()) ||
+                        ((XmlRpc::XmlRpcValue::TypeInt != item["timeout"].getType()) && (XmlRpc::XmlRpcValue::TypeDouble != item["timeout"].getType()))) {
+                        ROS_ERROR("Entry %d of parameter '%s' must have a 'name', a 'topic', an integer 'priority' and a 'timeout' in seconds.", i, param.c_str());
+                        throw std::runtime_error("Invalid " + param + " parameter");
+                    }
+
+                    CommandInput input;
+                    input.name      = static_cast<std::string>(item["name"]);
+                    input.topic     = static_cast<std::string>(item["topic"]);
+                    input.priority  = static_cast<int>(item["priority"]);
+                    input.timeout_s = (XmlRpc::XmlRpcValue::TypeInt == item["timeout"].getType()) ? static_cast<int>(item["timeout"]) : static_cast<double>(item["timeout"]);
+                    inputs.push_back(input);
+                }
+
+                return inputs;
+            }
+
+            std::string checkDriveBackend(const std::string &param, const std::string &backend, const std::string &fallback)
+            {
+                if (("SMC" != backend) && ("Simulation" != backend) && ("SocketCAN" != backend)) {
+                    ROS_WARN("Invalid value '%s' for parameter '%s', accepted values: ['SMC', 'Simulation' or 'SocketCAN']."
+                             "Falling back to %s.",
+                             backend.c_str(), param.c_str(), fallback.c_str());
+                    return fallback;
+                }
+                return backend;
+            }
+        } // namespace
+
         DiffDriveController::DiffDriveController(const std::shared_ptr<ros::NodeHandle> nh) : m_nh(nh)
         {
             ROS_INFO("Initializing swd_diff_drive_controller, node name : %s", ros::this_node::getName().c_str());
@@ -58,19 +218,69 @@ namespace ezw
             m_left_config_file                  = m_nh->param("left_swd_config_file", std::string(""));
             m_right_config_file                 = m_nh->param("right_swd_config_file", std::string(""));
             m_pub_freq_hz                       = m_nh->param("pub_freq_hz", DEFAULT_PUB_FREQ_HZ);
-            m_watchdog_receive_ms               = m_nh->param("control_timeout_ms", DEFAULT_WATCHDOG_MS);
+            m_watchdog_receive_ms               = m_nh->param("command_timeout_ms", m_nh->param("control_timeout_ms", DEFAULT_WATCHDOG_MS)); // Former name
             m_base_frame                        = m_nh->param("base_frame", DEFAULT_BASE_FRAME);
             m_odom_frame                        = m_nh->param("odom_frame", DEFAULT_ODOM_FRAME);
             m_publish_odom                      = m_nh->param("publish_odom", DEFAULT_PUBLISH_ODOM);
             m_publish_tf                        = m_nh->param("publish_tf", DEFAULT_PUBLISH_TF);
+            bool        preserialized_publish   = m_nh->param("preserialized_publish", DEFAULT_PRESERIALIZED_PUBLISH);
             m_publish_safety                    = m_nh->param("publish_safety_functions", DEFAULT_PUBLISH_SAFETY_FCNS);
+            m_publish_robot_state               = m_nh->param("publish_robot_state", DEFAULT_PUBLISH_ROBOT_STATE);
             m_have_backward_sls                 = m_nh->param("have_backward_sls", DEFAULT_BACKWARD_SLS);
+            m_use_imu                           = m_nh->param("use_imu", DEFAULT_USE_IMU);
+            m_imu_gyro_weight                   = m_nh->param("imu_gyro_weight", DEFAULT_IMU_GYRO_WEIGHT);
+            m_imu_yaw_rate_stddev               = m_nh->param("imu_yaw_rate_stddev", DEFAULT_IMU_YAW_RATE_STDDEV);
+            int         imu_timeout_ms          = m_nh->param("imu_timeout_ms", DEFAULT_IMU_TIMEOUT_MS);
+            bool        calibration             = m_nh->param("calibration", DEFAULT_CALIBRATION);
+            m_calibration_apply                 = m_nh->param("calibration_apply", DEFAULT_CALIBRATION_APPLY);
+            double      calibration_forgetting  = m_nh->param("calibration_forgetting_factor", DEFAULT_CALIBRATION_FORGETTING);
+            double      calibration_travel_m    = m_nh->param("calibration_min_travel_m", DEFAULT_CALIBRATION_TRAVEL_M);
+            bool        slip_detection          = m_nh->param("slip_detection", DEFAULT_SLIP_DETECTION);
+            int         slip_response_time_ms   = m_nh->param("slip_response_time_ms", DEFAULT_SLIP_RESPONSE_TIME_MS);
+            double      slip_speed_tolerance    = m_nh->param("slip_speed_tolerance_mps", DEFAULT_SLIP_SPEED_TOLERANCE);
+            double      slip_relative_tolerance = m_nh->param("slip_relative_tolerance", DEFAULT_SLIP_RELATIVE_TOLERANCE);
+            double      slip_yaw_rate_tolerance = m_nh->param("slip_yaw_rate_tolerance", DEFAULT_SLIP_YAW_RATE_TOLERANCE);
+            bool        publish_diagnostics     = m_nh->param("publish_diagnostics", DEFAULT_PUBLISH_DIAGNOSTICS);
+            std::string metrics_address         = m_nh->param("metrics_address", DEFAULT_METRICS_ADDRESS);
+            int         metrics_port            = m_nh->param("metrics_port", DEFAULT_METRICS_PORT);
+            m_overload_shedding                 = m_nh->param("overload_shedding", DEFAULT_OVERLOAD_SHEDDING);
+            double      overload_miss_ratio     = m_nh->param("overload_miss_ratio", DEFAULT_OVERLOAD_MISS_RATIO);
+            int         overload_recover_s      = m_nh->param("overload_recover_s", DEFAULT_OVERLOAD_RECOVER_S);
+            bool        actuation_readback      = m_nh->param("actuation_readback", DEFAULT_ACTUATION_READBACK);
+            int         actuation_timeout_ms    = m_nh->param("actuation_timeout_ms", DEFAULT_ACTUATION_TIMEOUT_MS);
+            int         actuation_tolerance_rpm = m_nh->param("actuation_tolerance_rpm", DEFAULT_ACTUATION_TOLERANCE_RPM);
+            bool        relative_moves          = m_nh->param("relative_moves", DEFAULT_RELATIVE_MOVES);
+            m_move_speed_mps                    = m_nh->param("relative_move_speed_mps", DEFAULT_RELATIVE_MOVE_SPEED);
+            m_move_acceleration_mps2            = m_nh->param("relative_move_acceleration_mps2", DEFAULT_RELATIVE_MOVE_ACCEL);
+            bool        drive_ramping           = m_nh->param("drive_ramping", DEFAULT_DRIVE_RAMPING);
+            m_drive_acceleration_mps2           = m_nh->param("drive_acceleration_mps2", DEFAULT_DRIVE_ACCELERATION);
+            m_drive_deceleration_mps2           = m_nh->param("drive_deceleration_mps2", DEFAULT_DRIVE_DECELERATION);
+            bool        drive_timeout           = m_nh->param("drive_timeout", DEFAULT_DRIVE_TIMEOUT);
             m_left_encoder_relative_error       = m_nh->param("left_encoder_relative_error", DEFAULT_LEFT_RELATIVE_ERROR);
             m_right_encoder_relative_error      = m_nh->param("right_encoder_relative_error", DEFAULT_RIGHT_RELATIVE_ERROR);
+            m_extrapolation_relative_error      = m_nh->param("extrapolation_relative_error", DEFAULT_EXTRAPOLATION_RELATIVE_ERROR);
+            m_extrapolation_max_accel_mps2      = m_nh->param("extrapolation_max_acceleration_mps2", DEFAULT_EXTRAPOLATION_MAX_ACCEL);
+            std::string odom_integration        = m_nh->param("odom_integration", DEFAULT_ODOM_INTEGRATION);
             double      max_wheel_speed_rpm     = m_nh->param("wheel_max_speed_rpm", DEFAULT_MAX_WHEEL_SPEED_RPM);
             double      max_sls_wheel_speed_rpm = m_nh->param("wheel_safety_limited_speed_rpm", DEFAULT_MAX_SLS_WHEEL_RPM);
             std::string positive_polarity_wheel = m_nh->param("positive_polarity_wheel", DEFAULT_POSITIVE_POLARITY_WHEEL);
             std::string ctrl_mode               = m_nh->param("control_mode", DEFAULT_CTRL_MODE);
+            std::string drive_backend           = m_nh->param("drive_backend", DEFAULT_DRIVE_BACKEND);
+            double      sim_time_factor         = m_nh->param("sim_time_factor", DEFAULT_SIM_TIME_FACTOR);
+            m_hot_standby                       = m_nh->param("hot_standby", DEFAULT_HOT_STANDBY);
+            m_hot_standby_timeout_ms            = m_nh->param("hot_standby_timeout_ms", DEFAULT_HOT_STANDBY_TIMEOUT_MS);
+            m_hot_standby_stall_ms              = m_nh->param("hot_standby_stall_timeout_ms", DEFAULT_HOT_STANDBY_STALL_MS);
+            std::string hot_standby_shm_name    = m_nh->param("hot_standby_shm_name", DEFAULT_HOT_STANDBY_SHM_NAME);
+            std::string odom_checkpoint_file    = m_nh->param("odom_checkpoint_file", std::string(""));
+            int         checkpoint_max_gap_mm   = m_nh->param("odom_checkpoint_max_gap_mm", DEFAULT_CHECKPOINT_MAX_GAP_MM);
+            bool        characterisation        = m_nh->param("characterisation", false);
+            std::string char_report_file        = m_nh->param("characterisation_report", DEFAULT_CHAR_REPORT_FILE);
+            double      char_speed_rpm          = m_nh->param("characterisation_speed_rpm", DEFAULT_CHAR_SPEED_RPM);
+            int         char_sample_hz          = m_nh->param("characterisation_sample_hz", DEFAULT_CHAR_SAMPLE_HZ);
+            double      char_step_s             = m_nh->param("characterisation_step_s", DEFAULT_CHAR_STEP_S);
+            double      char_chirp_s            = m_nh->param("characterisation_chirp_s", DEFAULT_CHAR_CHIRP_S);
+            double      char_chirp_min_hz       = m_nh->param("characterisation_chirp_min_hz", DEFAULT_CHAR_CHIRP_MIN_HZ);
+            double      char_chirp_max_hz       = m_nh->param("characterisation_chirp_max_hz", DEFAULT_CHAR_CHIRP_MAX_HZ);
 
             if ("Left" == positive_polarity_wheel) {
                 m_left_wheel_polarity = 1;
@@ -95,6 +305,22 @@ namespace ezw
                          m_pub_freq_hz, DEFAULT_PUB_FREQ_HZ);
             }
 
+            if (m_watchdog_receive_ms <= 0) {
+                m_watchdog_receive_ms = DEFAULT_WATCHDOG_MS;
+                ROS_WARN("Invalid value for parameter 'command_timeout_ms', it must be greater than 0. "
+                         "Falling back to default (%d ms)",
+                         DEFAULT_WATCHDOG_MS);
+            }
+
+            OdometryIntegrator::Scheme odom_scheme;
+            if (!OdometryIntegrator::parseScheme(odom_integration, odom_scheme)) {
+                OdometryIntegrator::parseScheme(DEFAULT_ODOM_INTEGRATION, odom_scheme);
+                ROS_WARN("Invalid value '%s' for parameter 'odom_integration', accepted values: ['Euler', 'Midpoint' or 'Exact']. "
+                         "Falling back to default (%s).",
+                         odom_integration.c_str(), DEFAULT_ODOM_INTEGRATION.c_str());
+            }
+            m_integrator = OdometryIntegrator(odom_scheme);
+
             if (std::numeric_limits<double>::epsilon() >= m_left_encoder_relative_error) {
                 m_left_encoder_relative_error = 0.001;
                 ROS_WARN("'left_encoder_relative_error' set to 0, using 0.001 to prevent null uncertainties.");
@@ -105,29 +331,262 @@ namespace ezw
                 ROS_WARN("'right_encoder_relative_error' set to 0, using 0.001 to prevent null uncertainties.");
             }
 
+            if (m_extrapolation_relative_error < 0.) {
+                m_extrapolation_relative_error = DEFAULT_EXTRAPOLATION_RELATIVE_ERROR;
+                ROS_WARN("Invalid value for parameter 'extrapolation_relative_error', it should be a positive value. "
+                         "Falling back to default (%f)",
+                         DEFAULT_EXTRAPOLATION_RELATIVE_ERROR);
+            }
+
+            if (m_extrapolation_max_accel_mps2 < 0.) {
+                m_extrapolation_max_accel_mps2 = DEFAULT_EXTRAPOLATION_MAX_ACCEL;
+                ROS_WARN("Invalid value for parameter 'extrapolation_max_acceleration_mps2', it should be a positive value. "
+                         "Falling back to default (%f)",
+                         DEFAULT_EXTRAPOLATION_MAX_ACCEL);
+            }
+
+            if ((overload_miss_ratio < 0.) || (overload_miss_ratio > 1.)) {
+                overload_miss_ratio = DEFAULT_OVERLOAD_MISS_RATIO;
+                ROS_WARN("Invalid value for parameter 'overload_miss_ratio', it must be in [0, 1]. "
+                         "Falling back to default (%f)",
+                         DEFAULT_OVERLOAD_MISS_RATIO);
+            }
+
+            if (overload_recover_s <= 0) {
+                overload_recover_s = DEFAULT_OVERLOAD_RECOVER_S;
+                ROS_WARN("Invalid value for parameter 'overload_recover_s', it must be greater than 0. "
+                         "Falling back to default (%d s)",
+                         DEFAULT_OVERLOAD_RECOVER_S);
+            }
+
+            if ((m_imu_gyro_weight < 0.) || (m_imu_gyro_weight > 1.)) {
+                m_imu_gyro_weight = DEFAULT_IMU_GYRO_WEIGHT;
+                ROS_WARN("Invalid value for parameter 'imu_gyro_weight', it must be in [0, 1]. "
+                         "Falling back to default (%f)",
+                         DEFAULT_IMU_GYRO_WEIGHT);
+            }
+
+            if (m_imu_yaw_rate_stddev < 0.) {
+                m_imu_yaw_rate_stddev = DEFAULT_IMU_YAW_RATE_STDDEV;
+                ROS_WARN("Invalid value for parameter 'imu_yaw_rate_stddev', it should be a positive value. "
+                         "Falling back to default (%f)",
+                         DEFAULT_IMU_YAW_RATE_STDDEV);
+            }
+
+            if (imu_timeout_ms <= 0) {
+                imu_timeout_ms = DEFAULT_IMU_TIMEOUT_MS;
+                ROS_WARN("Invalid value for parameter 'imu_timeout_ms', it must be greater than 0. "
+                         "Falling back to default (%d ms)",
+                         DEFAULT_IMU_TIMEOUT_MS);
+            }
+
+            m_imu_timeout_s = imu_timeout_ms / 1000.0;
+
+            m_nominal_baseline_m = m_baseline_m;
+
+            if (calibration) {
+                if (!m_use_imu) {
+                    ROS_WARN("The online calibration needs the IMU, set 'use_imu' to enable it.");
+                } else {
+                    if ((calibration_forgetting <= 0.) || (calibration_forgetting > 1.)) {
+                        calibration_forgetting = DEFAULT_CALIBRATION_FORGETTING;
+                        ROS_WARN("Invalid value for parameter 'calibration_forgetting_factor', it must be in ]0, 1]. "
+                                 "Falling back to default (%f)",
+                                 DEFAULT_CALIBRATION_FORGETTING);
+                    }
+
+                    if (calibration_travel_m <= 0.) {
+                        calibration_travel_m = DEFAULT_CALIBRATION_TRAVEL_M;
+                        ROS_WARN("Invalid value for parameter 'calibration_min_travel_m', it must be greater than 0. "
+                                 "Falling back to default (%f m)",
+                                 DEFAULT_CALIBRATION_TRAVEL_M);
+                    }
+
+                    m_calibrator      = std::make_unique<KinematicCalibrator>(m_baseline_m, calibration_forgetting, calibration_travel_m);
+                    m_pub_calibration = m_nh->advertise<swd_ros_controllers::KinematicCalibration>("calibration", 5);
+                }
+            }
+
+            if (slip_detection) {
+                if (slip_response_time_ms < 0) {
+                    slip_response_time_ms = DEFAULT_SLIP_RESPONSE_TIME_MS;
+                    ROS_WARN("Invalid value for parameter 'slip_response_time_ms', it must be positive. "
+                             "Falling back to default (%d ms)",
+                             DEFAULT_SLIP_RESPONSE_TIME_MS);
+                }
+
+                if ((slip_speed_tolerance <= 0.) || (slip_relative_tolerance < 0.) || (slip_yaw_rate_tolerance <= 0.)) {
+                    slip_speed_tolerance    = DEFAULT_SLIP_SPEED_TOLERANCE;
+                    slip_relative_tolerance = DEFAULT_SLIP_RELATIVE_TOLERANCE;
+                    slip_yaw_rate_tolerance = DEFAULT_SLIP_YAW_RATE_TOLERANCE;
+                    ROS_WARN("Invalid values for the slip tolerances, they must be greater than 0. "
+                             "Falling back to defaults (%f m/s, %f, %f rad/s)",
+                             DEFAULT_SLIP_SPEED_TOLERANCE, DEFAULT_SLIP_RELATIVE_TOLERANCE, DEFAULT_SLIP_YAW_RATE_TOLERANCE);
+                }
+
+                m_slip_detector  = std::make_unique<SlipDetector>(slip_response_time_ms / 1000.0, slip_speed_tolerance, slip_relative_tolerance, slip_yaw_rate_tolerance);
+                m_pub_wheel_slip = m_nh->advertise<swd_ros_controllers::WheelSlip>("wheel_slip", 5);
+            }
+
+            if (characterisation) {
+                // The test drives the wheels on its own
+                if (m_hot_standby) {
+                    throw std::runtime_error("The characterisation mode can't run with the hot standby");
+                }
+
+                if (char_speed_rpm <= 0.) {
+                    char_speed_rpm = DEFAULT_CHAR_SPEED_RPM;
+                    ROS_WARN("Invalid value for parameter 'characterisation_speed_rpm', it must be greater than 0. "
+                             "Falling back to default (%f rpm)",
+                             DEFAULT_CHAR_SPEED_RPM);
+                }
+
+                if (char_sample_hz < 0) {
+                    char_sample_hz = DEFAULT_CHAR_SAMPLE_HZ;
+                    ROS_WARN("Invalid value for parameter 'characterisation_sample_hz', it must be positive. "
+                             "Falling back to default (%d Hz)",
+                             DEFAULT_CHAR_SAMPLE_HZ);
+                }
+
+                if ((char_step_s <= 0.) || (char_chirp_s <= 0.) || (char_chirp_min_hz <= 0.) || (char_chirp_max_hz <= char_chirp_min_hz)) {
+                    char_step_s       = DEFAULT_CHAR_STEP_S;
+                    char_chirp_s      = DEFAULT_CHAR_CHIRP_S;
+                    char_chirp_min_hz = DEFAULT_CHAR_CHIRP_MIN_HZ;
+                    char_chirp_max_hz = DEFAULT_CHAR_CHIRP_MAX_HZ;
+                    ROS_WARN("Invalid characterisation sequence. "
+                             "Falling back to defaults (step %f s, chirp %f s from %f Hz to %f Hz)",
+                             DEFAULT_CHAR_STEP_S, DEFAULT_CHAR_CHIRP_S, DEFAULT_CHAR_CHIRP_MIN_HZ, DEFAULT_CHAR_CHIRP_MAX_HZ);
+                }
+
+                m_characterisation = std::make_unique<DriveCharacterisation>(char_step_s, char_chirp_s, char_chirp_min_hz, char_chirp_max_hz);
+            }
+
+            if (m_hot_standby_timeout_ms <= 0) {
+                m_hot_standby_timeout_ms = DEFAULT_HOT_STANDBY_TIMEOUT_MS;
+                ROS_WARN("Invalid value for parameter 'hot_standby_timeout_ms', it must be greater than 0. "
+                         "Falling back to default (%d ms)",
+                         DEFAULT_HOT_STANDBY_TIMEOUT_MS);
+            }
+
+            if (m_hot_standby_stall_ms <= 0) {
+                m_hot_standby_stall_ms = DEFAULT_HOT_STANDBY_STALL_MS;
+                ROS_WARN("Invalid value for parameter 'hot_standby_stall_timeout_ms', it must be greater than 0. "
+                         "Falling back to default (%d ms)",
+                         DEFAULT_HOT_STANDBY_STALL_MS);
+            }
+
+            // Each wheel can use its own backend, the common one by default
+            drive_backend                   = checkDriveBackend("drive_backend", drive_backend, DEFAULT_DRIVE_BACKEND);
+            std::string left_drive_backend  = checkDriveBackend("left_drive_backend", m_nh->param("left_drive_backend", drive_backend), drive_backend);
+            std::string right_drive_backend = checkDriveBackend("right_drive_backend", m_nh->param("right_drive_backend", drive_backend), drive_backend);
+
+            if (("SocketCAN" == left_drive_backend) || ("SocketCAN" == right_drive_backend)) {
+                // A standby controller would be a second SYNC producer and SDO client on the bus
+                if (m_hot_standby) {
+                    ROS_ERROR("The 'SocketCAN' drive backend can't run with the hot standby.");
+                    throw std::runtime_error("SocketCAN drives with hot standby");
+                }
+
+                // The safety functions are manufacturer objects, only read through the SMC core. They are
+                // taken from the other wheel when it uses another backend.
+                m_left_safety  = ("SocketCAN" != left_drive_backend);
+                m_right_safety = ("SocketCAN" != right_drive_backend);
+                if (!m_left_safety && !m_right_safety) {
+                    if (m_publish_safety) {
+                        ROS_WARN("The safety functions can't be read with the 'SocketCAN' drive backend, 'publish_safety_functions' is disabled.");
+                        m_publish_safety = false;
+                    }
+                } else if (m_publish_safety) {
+                    ROS_WARN("The safety functions of the %s wheel can't be read with the 'SocketCAN' drive backend, the %s wheel's ones apply to both.",
+                             m_left_safety ? "right" : "left", m_left_safety ? "left" : "right");
+                }
+            }
+
+            // The simulated clock is published by this process (see main), only the simulated drives follow it
+            if (sim_time_factor > 0.) {
+                if (("Simulation" != left_drive_backend) || ("Simulation" != right_drive_backend)) {
+                    ROS_ERROR("The simulated clock (sim_time_factor > 0) requires the 'Simulation' drive backend.");
+                    throw std::runtime_error("Simulated clock with real drives");
+                }
+
+                // Wall clock overruns are meaningless against the simulated periods, keep the outputs deterministic
+                m_overload_shedding = false;
+            }
+
+            // Observation windows of 1 second of control cycles
+            m_load_shedder = std::make_unique<LoadShedder>(m_pub_freq_hz, overload_miss_ratio, overload_recover_s);
+
             // Publishers
+            m_pub_diagnostics = m_nh->advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 5);
+
             if (m_publish_odom) {
-                m_pub_odom = m_nh->advertise<nav_msgs::Odometry>("odom", 5);
+                m_pub_odom        = m_nh->advertise<nav_msgs::Odometry>("odom", 5);
+                m_pub_odom_status = m_nh->advertise<swd_ros_controllers::OdometryStatus>("odom_status", 5);
+            }
+
+            // The frames never change, the odometry and TF messages are serialised once and patched at each cycle
+            if (preserialized_publish) {
+                m_serialized_odom = std::make_unique<SerializedOdometry>(m_odom_frame, m_base_frame);
+                if (m_publish_tf) {
+                    m_serialized_tf = std::make_unique<SerializedTransform>(m_odom_frame, m_base_frame);
+                    m_pub_tf        = m_nh->advertise<tf2_msgs::TFMessage>("/tf", 100);
+                }
             }
 
             if (m_publish_safety) {
                 m_pub_safety = m_nh->advertise<swd_ros_controllers::SafetyFunctions>("safety", 5);
             }
 
+            if (m_publish_robot_state) {
+                m_pub_robot_state = m_nh->advertise<swd_ros_controllers::RobotState>("robot_state", 5);
+            }
+
             // Subscribers
             m_sub_brake = m_nh->subscribe("soft_brake", 5, &DiffDriveController::cbSoftBrake, this);
 
-            if ("LeftRightSpeeds" == ctrl_mode) {
-                m_sub_command = m_nh->subscribe("set_speed", 5, &DiffDriveController::cbSetSpeed, this);
-            } else {
-                m_sub_command = m_nh->subscribe("cmd_vel", 5, &DiffDriveController::cbCmdVel, this);
-                if ("Twist" != ctrl_mode) {
-                    ROS_WARN("Invalid value '%s' for parameter 'control_mode', accepted values: ['Twist' or 'LeftRightSpeeds']."
-                             "Falling back to default (%s).",
-                             ctrl_mode.c_str(), DEFAULT_CTRL_MODE.c_str());
+            if (m_use_imu) {
+                m_sub_imu = m_nh->subscribe("imu", 50, &DiffDriveController::cbImu, this, ros::TransportHints().tcpNoDelay());
+            }
+
+            // Services
+            m_srv_set_odometry = m_nh->advertiseService("set_odometry", &DiffDriveController::cbSetOdometry, this);
+
+            if (("LeftRightSpeeds" != ctrl_mode) && ("Twist" != ctrl_mode)) {
+                ROS_WARN("Invalid value '%s' for parameter 'control_mode', accepted values: ['Twist' or 'LeftRightSpeeds']."
+                         "Falling back to default (%s).",
+                         ctrl_mode.c_str(), DEFAULT_CTRL_MODE.c_str());
+                ctrl_mode = DEFAULT_CTRL_MODE;
+            }
+
+            // Command sources, the single set_speed or cmd_vel topic when none is configured
+            std::vector<CommandInput> command_sources = readCommandInputs(*m_nh, "command_sources");
+            std::vector<CommandInput> command_locks   = readCommandInputs(*m_nh, "command_locks");
+
+            if (command_sources.empty()) {
+                std::string topic = ("LeftRightSpeeds" == ctrl_mode) ? "set_speed" : "cmd_vel";
+                command_sources.push_back({topic, topic, 0, 0.0});
+            }
+
+            for (const CommandInput &input : command_sources) {
+                size_t source = m_command_mux.addSource(input.name, input.priority, input.timeout_s);
+                if ("LeftRightSpeeds" == ctrl_mode) {
+                    m_sub_command_sources.push_back(m_nh->subscribe<geometry_msgs::Point>(input.topic, 5, boost::bind(&DiffDriveController::cbSetSpeed, this, _1, source)));
+                } else {
+                    m_sub_command_sources.push_back(m_nh->subscribe<geometry_msgs::Twist>(input.topic, 5, boost::bind(&DiffDriveController::cbCmdVel, this, _1, source)));
                 }
             }
 
+            for (const CommandInput &input : command_locks) {
+                size_t lock = m_command_mux.addLock(input.name, input.priority, input.timeout_s);
+                m_sub_command_locks.push_back(m_nh->subscribe<std_msgs::Bool>(input.topic, 5, boost::bind(&DiffDriveController::cbCommandLock, this, _1, lock)));
+            }
+
+            if (m_command_mux.sources() > 1 || !command_locks.empty()) {
+                ROS_INFO("Arbitrating %zu command sources with %zu locks.", m_command_mux.sources(), command_locks.size());
+            }
+
+            m_pub_command_source = m_nh->advertise<std_msgs::String>("command_source", 1, true);
+
             if (max_wheel_speed_rpm < 0.) {
                 max_wheel_speed_rpm = DEFAULT_MAX_WHEEL_SPEED_RPM;
                 ROS_ERROR("Invalid value %f for parameter 'wheel_max_speed_rpm', it should be a positive value. "
@@ -142,112 +601,65 @@ namespace ezw
                           max_sls_wheel_speed_rpm, DEFAULT_MAX_SLS_WHEEL_RPM);
             }
 
+            // The SLS has to be read from a wheel to limit the setpoints
+            if (!m_left_safety && !m_right_safety && (max_sls_wheel_speed_rpm < max_wheel_speed_rpm)) {
+                ROS_ERROR("The safety limited speed can't be read with the 'SocketCAN' drive backend on both wheels, so it can't limit the setpoints. "
+                          "Set 'wheel_safety_limited_speed_rpm' to 'wheel_max_speed_rpm' (or above) to run without it.");
+                throw std::runtime_error("Safety limited speed with SocketCAN drives");
+            }
+
             // Initialize motors
             ROS_INFO("Motors config files, right : %s, left : %s", m_right_config_file.c_str(), m_left_config_file.c_str());
 
-            ezw_error_t err;
-
-            if ("" != m_right_config_file) {
-                /* Config init */
-                auto lConfig = std::make_shared<ezw::smccore::Config>();
-                err          = lConfig->load(m_right_config_file);
-                if (err != ERROR_NONE) {
-                    ROS_ERROR("Failed loading right motor's config file <%s>, CONTEXT_ID: %d, EZW_ERR: SMCService : "
-                              "Config.init() return error code : %d",
-                              m_right_config_file.c_str(), CON_APP, (int)err);
-                    throw std::runtime_error("Failed loading right motor's config file");
-                }
-
-                m_right_wheel_diameter_m = lConfig->getDiameter() * 1e-3;
-                m_r_motor_reduction      = lConfig->getReduction();
-
-                /* CANOpenService client init */
-                auto lCOSClient = std::make_shared<ezw::canopenservice::DBusClient>();
-                err             = lCOSClient->init();
-                if (err != ERROR_NONE) {
-                    ROS_ERROR("Failed initializing right motor, CONTEXT_ID: %d, EZW_ERR: SMCService : "
-                              "COSDBusClient::init() return error code : %d",
-                              lConfig->getContextId(), (int)err);
-                    throw std::runtime_error("Failed initializing right motor");
-                }
-
-                /* CANOpenDispatcher */
-                auto lCANOpenDispatcher = std::make_shared<ezw::smccore::CANOpenDispatcher>(lConfig, lCOSClient);
-                err                     = lCANOpenDispatcher->init();
-                if (err != ERROR_NONE) {
-                    ROS_ERROR("Failed initializing right motor, CONTEXT_ID: %d, EZW_ERR: SMCService : "
-                              "CANOpenDispatcher::init() return error code : %d",
-                              lConfig->getContextId(), (int)err);
-                    throw std::runtime_error("Failed initializing right motor");
-                }
-
-                err = m_right_controller.init(lConfig, lCANOpenDispatcher);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Failed initializing right motor, EZW_ERR: SMCService : "
-                              "Controller::init() return error code : %d",
-                              (int)err);
-                    throw std::runtime_error("Failed initializing right motor");
-                }
-            } else {
-                ROS_ERROR("Please specify the 'right_swd_config_file' parameter");
-                throw std::runtime_error("Please specify the 'right_swd_config_file' parameter");
-            }
-
-            if ("" != m_left_config_file) {
-                /* Config init */
-                auto lConfig = std::make_shared<ezw::smccore::Config>();
-                err          = lConfig->load(m_left_config_file);
-                if (err != ERROR_NONE) {
-                    ROS_ERROR("Failed loading left motor's config file <%s>, CONTEXT_ID: %d, EZW_ERR: SMCService : "
-                              "Config.init() return error code : %d",
-                              m_right_config_file.c_str(), CON_APP, (int)err);
-                    throw std::runtime_error("Failed initializing left motor");
-                }
+            m_right_controller = std::make_unique<InstrumentedDrive>(makeDrive("right", m_right_config_file, right_drive_backend), m_right_stats);
+            m_left_controller  = std::make_unique<InstrumentedDrive>(makeDrive("left", m_left_config_file, left_drive_backend), m_left_stats);
 
-                m_left_wheel_diameter_m = lConfig->getDiameter() * 1e-3;
-                m_l_motor_reduction     = lConfig->getReduction();
+            m_right_wheel_diameter_m = m_right_controller->getDiameter() * 1e-3;
+            m_r_motor_reduction      = m_right_controller->getReduction();
+            m_left_wheel_diameter_m  = m_left_controller->getDiameter() * 1e-3;
+            m_l_motor_reduction      = m_left_controller->getReduction();
 
-                /* CANOpenService client init */
-                auto lCOSClient = std::make_shared<ezw::canopenservice::DBusClient>();
-                err             = lCOSClient->init();
-                if (err != ERROR_NONE) {
-                    ROS_ERROR("Failed initializing left motor, EZW_ERR: SMCService : "
-                              "COSDBusClient::init() return error code : %d",
-                              (int)err);
-                    throw std::runtime_error("Failed initializing left motor");
+            if (actuation_readback) {
+                if (actuation_timeout_ms <= 0) {
+                    actuation_timeout_ms = DEFAULT_ACTUATION_TIMEOUT_MS;
+                    ROS_WARN("Invalid value for parameter 'actuation_timeout_ms', it must be greater than 0. "
+                             "Falling back to default (%d ms)",
+                             DEFAULT_ACTUATION_TIMEOUT_MS);
                 }
 
-                /* CANOpenDispatcher */
-                auto lCANOpenDispatcher = std::make_shared<ezw::smccore::CANOpenDispatcher>(lConfig, lCOSClient);
-                err                     = lCANOpenDispatcher->init();
-                if (err != ERROR_NONE) {
-                    ROS_ERROR("Failed initializing left motor, EZW_ERR: SMCService : "
-                              "CANOpenDispatcher::init() return error code : %d",
-                              (int)err);
-                    throw std::runtime_error("Failed initializing left motor");
+                if (actuation_tolerance_rpm < 0) {
+                    actuation_tolerance_rpm = DEFAULT_ACTUATION_TOLERANCE_RPM;
+                    ROS_WARN("Invalid value for parameter 'actuation_tolerance_rpm', it must be positive. "
+                             "Falling back to default (%d rpm)",
+                             DEFAULT_ACTUATION_TOLERANCE_RPM);
                 }
 
-                err = m_left_controller.init(lConfig, lCANOpenDispatcher);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Failed initializing left motor, EZW_ERR: SMCService : "
-                              "Controller::init() return error code : %d",
-                              (int)err);
-                    throw std::runtime_error("Failed initializing left motor");
+                m_actuation_timeout_ms = actuation_timeout_ms;
+
+                // Only the backends able to read the drive back are monitored
+                for (const auto &wheel : {std::make_tuple("left", m_left_controller.get(), &m_left_stats, &m_left_actuation),
+                                          std::make_tuple("right", m_right_controller.get(), &m_right_stats, &m_right_actuation)}) {
+                    uint16_t    status_word;
+                    ezw_error_t err = std::get<1>(wheel)->getStatusWord(status_word);
+                    if (DRIVE_ERROR_NOT_SUPPORTED == err) {
+                        ROS_WARN("The %s drive backend can't read the velocity demand back, its actuation isn't confirmed.", std::get<0>(wheel));
+                    } else {
+                        *std::get<3>(wheel) = std::make_unique<ActuationMonitor>(*std::get<2>(wheel), actuation_tolerance_rpm, actuation_timeout_ms * 1000000LL);
+                    }
                 }
-            } else {
-                ROS_ERROR("Please specify the 'left_swd_config_file' parameter");
-                throw std::runtime_error("Please specify the 'left_swd_config_file' parameter");
             }
 
+            ezw_error_t err;
+
             // Read initial encoders values
-            err = m_left_controller.getOdometryValue(m_dist_left_prev_mm);
+            err = m_left_controller->getOdometryValue(m_dist_left_prev_mm);
             if (ERROR_NONE != err) {
                 ROS_ERROR("Failed initial reading from left motor, EZW_ERR: SMCService : "
                           "Controller::getOdometryValue() return error code : %d",
                           (int)err);
             }
 
-            err = m_right_controller.getOdometryValue(m_dist_right_prev_mm);
+            err = m_right_controller->getOdometryValue(m_dist_right_prev_mm);
             if (ERROR_NONE != err) {
                 ROS_ERROR("Failed initial reading from right motor, EZW_ERR: SMCService : "
                           "Controller::getOdometryValue() return error code : %d",
@@ -266,253 +678,1828 @@ namespace ezw
                      "Setting maximum motor safety limited speed to %d rpm",
                      max_sls_wheel_speed_rpm, m_motor_sls_rpm);
 
-            m_timer_watchdog = m_nh->createTimer(ros::Duration(m_watchdog_receive_ms / 1000.0), boost::bind(&DiffDriveController::cbWatchdog, this));
-            m_timer_pds      = m_nh->createTimer(ros::Duration(1.0), boost::bind(&DiffDriveController::cbTimerStateMachine, this));
+            // Hot standby, the drives are initialized but only the owner of the shared state drives them
+            if (m_hot_standby) {
+                if (!m_state_store.openShared(hot_standby_shm_name)) {
+                    throw std::runtime_error("Failed opening the hot standby shared state");
+                }
+
+                m_active = m_state_store.tryAcquire(static_cast<int64_t>(m_hot_standby_timeout_ms) * 1000000);
+                ROS_INFO("Hot standby enabled, starting as the %s controller.", m_active ? "active" : "standby");
+
+                // The heartbeat doesn't depend on the spinner, a slow callback doesn't trigger a failover
+                m_loop_alive_ns    = StateStore::monotonicNs();
+                m_heartbeat_thread = std::thread(&DiffDriveController::runHeartbeat, this);
+            }
+
+            // Odometry checkpoint, restored by the active controller only, the standby one takes the active's state over
+            if ("" != odom_checkpoint_file) {
+                if (!m_checkpoint.openFile(odom_checkpoint_file)) {
+                    ROS_ERROR("Failed opening the odometry checkpoint file '%s', odometry won't be persisted.", odom_checkpoint_file.c_str());
+                } else if (m_active) {
+                    restoreCheckpoint(checkpoint_max_gap_mm);
+                }
+            }
+
+            // Drive-side ramps, the setpoints are still limited by setSpeeds()
+            if (drive_ramping) {
+                if ((m_drive_acceleration_mps2 <= 0.) || (m_drive_deceleration_mps2 <= 0.)) {
+                    m_drive_acceleration_mps2 = DEFAULT_DRIVE_ACCELERATION;
+                    m_drive_deceleration_mps2 = DEFAULT_DRIVE_DECELERATION;
+                    ROS_WARN("Invalid values for the drive ramps, they must be greater than 0. "
+                             "Falling back to defaults (%f m/s^2, %f m/s^2)",
+                             DEFAULT_DRIVE_ACCELERATION, DEFAULT_DRIVE_DECELERATION);
+                }
+
+                m_velocity_mode = DriveInterface::OperationMode::PROFILE_VELOCITY;
+
+                // The standby controller configures the drives when taking them over
+                if (m_active) {
+                    applyVelocityMode();
+                }
+
+                // Changed at runtime from the control thread, the characterisation thread owns the drives
+                if ((DriveInterface::OperationMode::PROFILE_VELOCITY == m_velocity_mode) && !m_characterisation) {
+                    swd_ros_controllers::DriveRampConfig config;
+                    config.drive_acceleration_mps2 = m_drive_acceleration_mps2;
+                    config.drive_deceleration_mps2 = m_drive_deceleration_mps2;
+
+                    m_reconfigure_server = std::make_unique<dynamic_reconfigure::Server<swd_ros_controllers::DriveRampConfig>>(*m_nh);
+                    m_reconfigure_server->updateConfig(config);
+                    m_reconfigure_server->setCallback(boost::bind(&DiffDriveController::cbReconfigure, this, _1, _2));
+                }
+            }
+
+            // Drive-side command timeout, the heartbeats are sent by the control loop. The characterisation thread doesn't send them.
+            if (drive_timeout && !m_characterisation) {
+                uint16_t timeout_ms = static_cast<uint16_t>(M_MIN(m_watchdog_receive_ms, 65535));
+
+                if (timeout_ms < 2000 / m_pub_freq_hz) {
+                    ROS_WARN("'command_timeout_ms' (%d ms) is shorter than two control periods, the drives may stop between two heartbeats.", m_watchdog_receive_ms);
+                }
+
+                m_drive_timeout = true;
+                for (DriveInterface *drive : {m_left_controller.get(), m_right_controller.get()}) {
+                    // The standby controller only sends the heartbeats once active, the configuration is the same
+                    ezw_error_t err = m_active ? drive->setCommunicationTimeout(timeout_ms) : drive->sendHeartbeat();
+                    if (DRIVE_ERROR_NOT_SUPPORTED == err) {
+                        ROS_WARN("The drive backend doesn't support the communication timeout, only the controller's watchdog stops the wheels.");
+                        m_drive_timeout = false;
+                        break;
+                    }
+
+                    if (ERROR_NONE != err) {
+                        ROS_ERROR("Failed setting the drive communication timeout, EZW_ERR: %d", (int)err);
+                    }
+                }
+
+                if (m_drive_timeout) {
+                    ROS_INFO("The drives stop on their own without a heartbeat within %u ms.", timeout_ms);
+                }
+            }
+
+            m_timer_watchdog = m_nh->createTimer(ros::Duration(m_watchdog_receive_ms / 1000.0), boost::bind(&DiffDriveController::cbWatchdog, this), false, m_active);
+            m_timer_pds      = m_nh->createTimer(ros::Duration(1.0), boost::bind(&DiffDriveController::cbTimerStateMachine, this), false, m_active);
 
-            if (m_publish_odom || m_publish_tf) {
-                m_timer_odom = m_nh->createTimer(ros::Duration(1.0 / m_pub_freq_hz), boost::bind(&DiffDriveController::cbTimerOdom, this));
+            // With hot standby, the control loop also refreshes the shared state, and the drive heartbeats
+            if (m_publish_odom || m_publish_tf || m_publish_robot_state || m_hot_standby || m_drive_timeout) {
+                m_timer_odom = m_nh->createTimer(ros::Duration(1.0 / m_pub_freq_hz), boost::bind(&DiffDriveController::cbTimerOdom, this, _1), false, m_active);
             }
 
             if (m_publish_safety) {
-                m_timer_safety = m_nh->createTimer(ros::Duration(1.0 / 5.0), boost::bind(&DiffDriveController::cbTimerSafety, this));
+                m_timer_safety = m_nh->createTimer(ros::Duration(SAFETY_PERIOD_S), boost::bind(&DiffDriveController::cbTimerSafety, this), false, m_active);
+            }
+
+            if (m_hot_standby) {
+                m_timer_standby = m_nh->createTimer(ros::Duration(1.0 / m_pub_freq_hz), boost::bind(&DiffDriveController::cbTimerStandby, this), false, !m_active);
+            }
+
+            if (m_publish_odom || m_publish_tf || m_publish_robot_state) {
+                m_publication_thread = std::thread(&DiffDriveController::runPublication, this);
+            }
+
+            if (publish_diagnostics) {
+                m_diagnostics_thread = std::thread(&DiffDriveController::runDiagnostics, this);
+            }
+
+            if ((metrics_port < 0) || (metrics_port > 65535)) {
+                ROS_ERROR("Invalid value %d for parameter 'metrics_port', the metrics won't be served.", metrics_port);
+            } else if (0 != metrics_port) {
+                m_metrics_server = std::make_unique<MetricsServer>([this]() { return renderMetrics(); });
+                if (m_metrics_server->start(metrics_address, static_cast<uint16_t>(metrics_port))) {
+                    ROS_INFO("Serving the metrics on http://%s:%d/metrics", metrics_address.c_str(), metrics_port);
+                } else {
+                    ROS_ERROR("Failed listening on %s:%d, the metrics won't be served.", metrics_address.c_str(), metrics_port);
+                    m_metrics_server.reset();
+                }
+            }
+
+            // Relative moves, supervised at the control rate while one runs
+            if (relative_moves && !m_characterisation) {
+                if ((m_move_speed_mps <= 0.) || (m_move_acceleration_mps2 <= 0.)) {
+                    m_move_speed_mps         = DEFAULT_RELATIVE_MOVE_SPEED;
+                    m_move_acceleration_mps2 = DEFAULT_RELATIVE_MOVE_ACCEL;
+                    ROS_WARN("Invalid values for the relative move profile, they must be greater than 0. "
+                             "Falling back to defaults (%f m/s, %f m/s^2)",
+                             DEFAULT_RELATIVE_MOVE_SPEED, DEFAULT_RELATIVE_MOVE_ACCEL);
+                }
+
+                m_timer_move  = m_nh->createTimer(ros::Duration(1.0 / m_pub_freq_hz), boost::bind(&DiffDriveController::cbTimerMove, this), false, false);
+                m_move_server = std::make_unique<actionlib::SimpleActionServer<swd_ros_controllers::RelativeMoveAction>>(*m_nh, "relative_move", false);
+                m_move_server->registerGoalCallback(boost::bind(&DiffDriveController::cbMoveGoal, this));
+                m_move_server->registerPreemptCallback(boost::bind(&DiffDriveController::cbMovePreempt, this));
+                m_move_server->start();
+            }
+
+            // All the drive accesses are then made from the characterisation thread
+            if (m_characterisation) {
+                startTimers(false);
+                for (ros::Subscriber &sub : m_sub_command_sources) {
+                    sub.shutdown();
+                }
+                m_sub_brake.shutdown();
+                m_srv_set_odometry.shutdown();
+
+                m_characterisation_thread = std::thread(&DiffDriveController::runCharacterisation, this, char_speed_rpm, char_sample_hz, char_report_file);
             }
 
             ROS_INFO("ez-Wheel's swd_diff_drive_controller initialized successfully!");
         }
 
-        void DiffDriveController::cbTimerStateMachine()
+        DiffDriveController::~DiffDriveController()
         {
-            // NMT state machine
-            smccore::Controller::NMTState nmt_state_l, nmt_state_r;
-            smccore::Controller::PDSState pds_state_l, pds_state_r;
-            ezw_error_t                   err_l, err_r;
+            // Stopped first, scrapes read most members
+            m_metrics_server.reset();
 
-            nmt_state_l = nmt_state_r = smccore::Controller::NMTState::UNKNOWN;
-            pds_state_l = pds_state_r = smccore::Controller::PDSState::SWITCH_ON_DISABLED;
+            if (m_heartbeat_thread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(m_heartbeat_mtx);
+                    m_heartbeat_stop = true;
+                }
+                m_heartbeat_cv.notify_all();
+                m_heartbeat_thread.join();
+            }
+
+            if (m_diagnostics_thread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(m_diagnostics_mtx);
+                    m_diagnostics_stop = true;
+                }
+                m_diagnostics_cv.notify_all();
+                m_diagnostics_thread.join();
+            }
 
-            err_l = m_left_controller.getNMTState(nmt_state_l);
-            err_r = m_right_controller.getNMTState(nmt_state_r);
+            if (m_publication_thread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(m_publication_mtx);
+                    m_publication_stop = true;
+                }
+                m_publication_cv.notify_all();
+                m_publication_thread.join();
+            }
 
-            if (ERROR_NONE != err_l) {
-                ROS_ERROR("Failed to get the NMT state for left motor, EZW_ERR: SMCService : "
-                          "Controller::getPDSState() return error code : %d",
-                          (int)err_l);
+            if (m_characterisation_thread.joinable()) {
+                m_characterisation_thread.join();
             }
+        }
 
-            if (ERROR_NONE != err_r) {
-                ROS_ERROR("Failed to get the NMT state for right motor, EZW_ERR: SMCService : "
-                          "Controller::getPDSState() return error code : %d",
-                          (int)err_r);
+        std::unique_ptr<DriveInterface> DiffDriveController::makeDrive(const std::string &name, const std::string &config_file, const std::string &backend)
+        {
+            if ("Simulation" == backend) {
+                double      diameter_mm  = m_nh->param("sim_wheel_diameter_mm", DEFAULT_SIM_WHEEL_DIAMETER_MM);
+                double      reduction    = m_nh->param("sim_motor_reduction", DEFAULT_SIM_MOTOR_REDUCTION);
+                int         tau_ms       = m_nh->param("sim_time_constant_ms", DEFAULT_SIM_TIME_CONSTANT_MS);
+                std::string sim_shm_name = m_nh->param("sim_shm_name", std::string(""));
+
+                if ((diameter_mm <= 0.) || (reduction <= 0.)) {
+                    ROS_ERROR("sim_wheel_diameter_mm and sim_motor_reduction parameters must be greater than 0");
+                    throw std::runtime_error("Invalid simulated " + name + " motor parameters");
+                }
+
+                auto drive = std::make_unique<SimDrive>(diameter_mm, reduction, tau_ms / 1000.0);
+
+                // Controllers sharing the simulated wheels, e.g. in hot standby, see the same motion
+                if (("" != sim_shm_name) && !drive->share(sim_shm_name + "_" + name)) {
+                    throw std::runtime_error("Failed sharing simulated " + name + " motor");
+                }
+
+                ROS_INFO("Using a simulated %s motor (diameter %f mm, reduction %f).", name.c_str(), diameter_mm, reduction);
+                return drive;
             }
 
-            if (smccore::Controller::NMTState::OPER != nmt_state_l) {
-                err_l = m_left_controller.setNMTState(smccore::Controller::NMTCommand::OPER);
+            if ("" == config_file) {
+                ROS_ERROR("Please specify the '%s_swd_config_file' parameter", name.c_str());
+                throw std::runtime_error("Please specify the '" + name + "_swd_config_file' parameter");
             }
 
-            if (smccore::Controller::NMTState::OPER != nmt_state_r) {
-                err_r = m_right_controller.setNMTState(smccore::Controller::NMTCommand::OPER);
+            if ("SocketCAN" == backend) {
+                return makeCanopenDrive(name, config_file);
             }
 
-            if (ERROR_NONE != err_l && smccore::Controller::NMTState::OPER != nmt_state_l) {
-                ROS_ERROR("Failed to set NMT state for left motor, EZW_ERR: SMCService : "
-                          "Controller::setNMTState() return error code : %d",
-                          (int)err_l);
+            auto drive = std::make_unique<SmcDrive>();
+            if (ERROR_NONE != drive->init(name, config_file)) {
+                throw std::runtime_error("Failed initializing " + name + " motor");
+            }
+
+            return drive;
+        }
+
+        std::unique_ptr<DriveInterface> DiffDriveController::makeCanopenDrive(const std::string &name, const std::string &config_file)
+        {
+            std::string interface = m_nh->param(name + "_can_interface", m_nh->param("can_interface", DEFAULT_CAN_INTERFACE));
+            int         node_id   = m_nh->param(name + "_can_node_id", 0);
+
+            if ((node_id < 1) || (node_id > 127)) {
+                ROS_ERROR("Parameter '%s_can_node_id' is mandatory with the 'SocketCAN' drive backend, and must be between 1 and 127", name.c_str());
+                throw std::runtime_error("Invalid " + name + "_can_node_id parameter");
+            }
+
+            // The wheels on the same interface share its master
+            std::shared_ptr<CanopenMaster> &master = m_can_masters[interface];
+            if (!master) {
+                int sync_period_ms = m_nh->param("can_sync_period_ms", DEFAULT_CAN_SYNC_PERIOD_MS);
+                int sdo_timeout_ms = m_nh->param("can_sdo_timeout_ms", DEFAULT_CAN_SDO_TIMEOUT_MS);
+                int master_node_id = m_nh->param("can_master_node_id", DEFAULT_CAN_MASTER_NODE_ID);
+
+                if (sync_period_ms < 0) {
+                    sync_period_ms = DEFAULT_CAN_SYNC_PERIOD_MS;
+                    ROS_WARN("Invalid value for parameter 'can_sync_period_ms', it must be positive. "
+                             "Falling back to default (%d ms)",
+                             DEFAULT_CAN_SYNC_PERIOD_MS);
+                }
+
+                if (sdo_timeout_ms <= 0) {
+                    sdo_timeout_ms = DEFAULT_CAN_SDO_TIMEOUT_MS;
+                    ROS_WARN("Invalid value for parameter 'can_sdo_timeout_ms', it must be greater than 0. "
+                             "Falling back to default (%d ms)",
+                             DEFAULT_CAN_SDO_TIMEOUT_MS);
+                }
+
+                if ((master_node_id < 1) || (master_node_id > 127)) {
+                    master_node_id = DEFAULT_CAN_MASTER_NODE_ID;
+                    ROS_WARN("Invalid value for parameter 'can_master_node_id', it must be between 1 and 127. "
+                             "Falling back to default (%d)",
+                             DEFAULT_CAN_MASTER_NODE_ID);
+                }
+
+                master = std::make_shared<CanopenMaster>(static_cast<uint8_t>(master_node_id), sdo_timeout_ms);
+                if (!master->start(interface, sync_period_ms)) {
+                    ROS_ERROR("Failed opening the CAN interface %s.", interface.c_str());
+                    throw std::runtime_error("Failed opening CAN interface " + interface);
+                }
+
+                ROS_INFO("CANopen master on %s (node %d), SYNC every %d ms.", interface.c_str(), master_node_id, sync_period_ms);
+            }
+
+            // Without SYNC, there are no TPDOs and everything is read by SDO
+            int64_t pdo_max_age_ns = static_cast<int64_t>(CAN_PDO_MAX_AGE_SYNCS) * master->syncPeriodMs() * 1000000;
+
+            auto drive = std::make_unique<CanopenDrive>(master, static_cast<uint8_t>(node_id), pdo_max_age_ns);
+            if (ERROR_NONE != drive->init(name, config_file)) {
+                throw std::runtime_error("Failed initializing " + name + " motor");
+            }
+
+            ROS_INFO("Using the %s motor at node %d on %s.", name.c_str(), node_id, interface.c_str());
+            return drive;
+        }
+
+        void DiffDriveController::publishDiagnostic(const diagnostic_msgs::DiagnosticStatus &status)
+        {
+            diagnostic_msgs::DiagnosticArray msg_diag;
+
+            msg_diag.header.stamp = ros::Time::now();
+            msg_diag.status.push_back(status);
+            m_pub_diagnostics.publish(msg_diag);
+        }
+
+        void DiffDriveController::runHeartbeat()
+        {
+            auto                         period   = std::chrono::microseconds(M_MAX(1000, m_hot_standby_timeout_ms * 1000 / HOT_STANDBY_HEARTBEATS));
+            int64_t                      stall_ns = static_cast<int64_t>(m_hot_standby_stall_ms) * 1000000;
+            std::unique_lock<std::mutex> lock(m_heartbeat_mtx);
+
+            // Refreshed while this process owns the drives and its control loop keeps completing cycles,
+            // a control loop stalled for longer than hot_standby_stall_timeout_ms lets the standby take over
+            while (!m_heartbeat_cv.wait_for(lock, period, [this]() { return m_heartbeat_stop; })) {
+                if (m_state_store.isOwner() && ((StateStore::monotonicNs() - m_loop_alive_ns.load(std::memory_order_relaxed)) <= stall_ns)) {
+                    m_state_store.heartbeat();
+                }
+            }
+        }
+
+        void DiffDriveController::runDiagnostics()
+        {
+            // Lowest priority, the control loop and the drives always come first
+            if (0 != setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), DIAGNOSTICS_NICE)) {
+                ROS_WARN("Failed lowering the priority of the diagnostics thread.");
+            }
+
+            std::unique_lock<std::mutex> lock(m_diagnostics_mtx);
+            while (!m_diagnostics_cv.wait_for(lock, std::chrono::duration<double>(DIAGNOSTICS_PERIOD_S), [this]() { return m_diagnostics_stop; })) {
+                lock.unlock();
+                publishHealth();
+                lock.lock();
+            }
+        }
+
+        void DiffDriveController::publishHealth()
+        {
+            diagnostic_msgs::DiagnosticArray msg_diag;
+
+            auto add_value = [](diagnostic_msgs::DiagnosticStatus &status, const std::string &key, const std::string &value) {
+                diagnostic_msgs::KeyValue kv;
+                kv.key   = key;
+                kv.value = value;
+                status.values.push_back(kv);
+            };
+
+            auto add_latency = [&](diagnostic_msgs::DiagnosticStatus &status, const std::string &prefix, const LatencyHistogram::Summary &summary) {
+                add_value(status, prefix + "_count", std::to_string(summary.count));
+                add_value(status, prefix + "_p50_us", std::to_string(summary.p50_us));
+                add_value(status, prefix + "_p90_us", std::to_string(summary.p90_us));
+                add_value(status, prefix + "_p99_us", std::to_string(summary.p99_us));
+                add_value(status, prefix + "_max_us", std::to_string(summary.max_us));
+            };
+
+            // Drives
+            for (const auto &drive : {std::make_tuple("Left drive", &m_left_stats, &m_left_reported_unconfirmed, m_left_actuation != nullptr),
+                                      std::make_tuple("Right drive", &m_right_stats, &m_right_reported_unconfirmed, m_right_actuation != nullptr)}) {
+                diagnostic_msgs::DiagnosticStatus status;
+                DriveStats &                      stats = *std::get<1>(drive);
+
+                int  nmt_state = stats.nmt_state.load(std::memory_order_relaxed);
+                int  pds_state = stats.pds_state.load(std::memory_order_relaxed);
+                bool nmt_ok    = (static_cast<int>(smccore::Controller::NMTState::OPER) == nmt_state);
+                bool pds_ok    = (static_cast<int>(smccore::Controller::PDSState::OPERATION_ENABLED) == pds_state);
+
+                std::pair<int32_t, uint64_t> errors[ErrorCounters::SLOTS];
+                size_t                       n_errors = stats.errors.snapshot(errors, ErrorCounters::SLOTS);
+
+                status.name        = ros::this_node::getName() + ": " + std::get<0>(drive);
+                status.hardware_id = m_base_frame;
+
+                // Setpoints not applied since the previous report
+                uint64_t unconfirmed = stats.actuation_unconfirmed.load(std::memory_order_relaxed);
+                bool     confirmed   = (unconfirmed == *std::get<2>(drive));
+                *std::get<2>(drive)  = unconfirmed;
+
+                if (!m_active) {
+                    status.level   = diagnostic_msgs::DiagnosticStatus::OK;
+                    status.message = "Standby";
+                } else if (!nmt_ok || !pds_ok) {
+                    status.level   = diagnostic_msgs::DiagnosticStatus::ERROR;
+                    status.message = !nmt_ok ? "NMT not operational" : "PDS not operation enabled";
+                } else if (!confirmed) {
+                    status.level   = diagnostic_msgs::DiagnosticStatus::WARN;
+                    status.message = "Setpoints not applied within " + std::to_string(m_actuation_timeout_ms) + " ms";
+                } else {
+                    status.level   = diagnostic_msgs::DiagnosticStatus::OK;
+                    status.message = "Operational";
+                }
+
+                add_value(status, "nmt_state", std::to_string(nmt_state));
+                add_value(status, "pds_state", std::to_string(pds_state));
+                add_value(status, "calls", std::to_string(stats.calls.load(std::memory_order_relaxed)));
+                add_value(status, "errors", std::to_string(stats.errors.total()));
+                for (size_t i = 0; i < n_errors; i++) {
+                    add_value(status, "errors_code_" + std::to_string(errors[i].first), std::to_string(errors[i].second));
+                }
+                add_value(status, "errors_other_codes", std::to_string(stats.errors.others()));
+                add_latency(status, "latency", stats.latency.summarize());
+                if (std::get<3>(drive)) {
+                    add_value(status, "velocity_demand_rpm", std::to_string(stats.velocity_demand_rpm.load(std::memory_order_relaxed)));
+                    add_value(status, "status_word", std::to_string(stats.status_word.load(std::memory_order_relaxed)));
+                    add_value(status, "actuation_confirmed", std::to_string(stats.actuation_confirmed.load(std::memory_order_relaxed)));
+                    add_value(status, "actuation_unconfirmed", std::to_string(unconfirmed));
+                    add_latency(status, "actuation_latency", stats.actuation.summarize());
+                }
+
+                msg_diag.status.push_back(status);
+            }
+
+            // Control loop
+            {
+                diagnostic_msgs::DiagnosticStatus status;
+                int                               shed_level = m_loop_stats.shed_level.load(std::memory_order_relaxed);
+
+                status.name        = ros::this_node::getName() + ": Control loop";
+                status.hardware_id = m_base_frame;
+                status.level       = (0 == shed_level) ? diagnostic_msgs::DiagnosticStatus::OK : diagnostic_msgs::DiagnosticStatus::WARN;
+                status.message     = m_active ? LoadShedder::levelName(static_cast<LoadShedder::Level>(shed_level)) : "Standby";
+
+                add_value(status, "period_ms", std::to_string(1000.0 / m_pub_freq_hz));
+                add_value(status, "cycles", std::to_string(m_loop_stats.cycles.load(std::memory_order_relaxed)));
+                add_value(status, "missed_deadlines", std::to_string(m_loop_stats.missed_deadlines.load(std::memory_order_relaxed)));
+                add_value(status, "publication_drops", std::to_string(m_loop_stats.publication_drops.load(std::memory_order_relaxed)));
+                add_value(status, "shedding_level", std::to_string(shed_level));
+                add_latency(status, "lateness", m_loop_stats.lateness.summarize());
+                add_latency(status, "duration", m_loop_stats.duration.summarize());
+
+                msg_diag.status.push_back(status);
+            }
+
+            // Safety functions
+            if (m_publish_safety) {
+                diagnostic_msgs::DiagnosticStatus    status;
+                swd_ros_controllers::SafetyFunctions safety;
+
+                m_safety_msg_mtx.lock();
+                safety = m_safety_msg;
+                m_safety_msg_mtx.unlock();
+
+                uint64_t sbc_inconsistencies = m_safety_stats.sbc_inconsistencies.load(std::memory_order_relaxed);
+                uint64_t sto_inconsistencies = m_safety_stats.sto_inconsistencies.load(std::memory_order_relaxed);
+
+                status.name        = ros::this_node::getName() + ": Safety functions";
+                status.hardware_id = m_base_frame;
+
+                // Warn for the inconsistencies of the last period, the counters keep the history
+                if (sbc_inconsistencies + sto_inconsistencies != m_reported_inconsistencies) {
+                    m_reported_inconsistencies = sbc_inconsistencies + sto_inconsistencies;
+                    status.level               = diagnostic_msgs::DiagnosticStatus::WARN;
+                    status.message             = "Left and right drives reported inconsistent safety functions";
+                } else if (safety.safe_torque_off) {
+                    status.level   = diagnostic_msgs::DiagnosticStatus::WARN;
+                    status.message = "Safe torque off";
+                } else {
+                    status.level   = diagnostic_msgs::DiagnosticStatus::OK;
+                    status.message = safety.safety_limited_speed ? "Safety limited speed" : "OK";
+                }
+
+                add_value(status, "safe_torque_off", safety.safe_torque_off ? "true" : "false");
+                add_value(status, "safe_brake_control", safety.safe_brake_control ? "true" : "false");
+                add_value(status, "safety_limited_speed", safety.safety_limited_speed ? "true" : "false");
+                add_value(status, "safe_direction_indication_forward", safety.safe_direction_indication_forward ? "true" : "false");
+                add_value(status, "safe_direction_indication_backward", safety.safe_direction_indication_backward ? "true" : "false");
+                add_value(status, "sbc_inconsistencies", std::to_string(sbc_inconsistencies));
+                add_value(status, "sto_inconsistencies", std::to_string(sto_inconsistencies));
+
+                msg_diag.status.push_back(status);
+            }
+
+            msg_diag.header.stamp = ros::Time::now();
+            m_pub_diagnostics.publish(msg_diag);
+        }
+
+        std::string DiffDriveController::renderMetrics()
+        {
+            std::ostringstream out;
+
+            auto header = [&](const char *name, const char *type, const char *help) {
+                out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+            };
+
+            auto histogram = [&](const char *name, const std::string &labels, const LatencyHistogram &latency) {
+                uint64_t counts[LatencyHistogram::BUCKETS], cumulative = 0;
+                int64_t  sum_ns;
+                latency.cumulative(counts, sum_ns);
+
+                std::string prefix = labels.empty() ? "" : labels + ",";
+                for (int i = 0; i < LatencyHistogram::BUCKETS; i++) {
+                    cumulative += counts[i];
+                    out << name << "_bucket{" << prefix << "le=\"" << LatencyHistogram::upperBoundUs(i) * 1e-6 << "\"} " << cumulative << "\n";
+                }
+                out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << cumulative << "\n";
+                out << name << "_sum" << (labels.empty() ? "" : "{" + labels + "}") << " " << static_cast<double>(sum_ns) * 1e-9 << "\n";
+                out << name << "_count" << (labels.empty() ? "" : "{" + labels + "}") << " " << cumulative << "\n";
+            };
+
+            auto load = [](const std::atomic<uint64_t> &counter) { return counter.load(std::memory_order_relaxed); };
+
+            header("swd_active", "gauge", "Whether this controller drives the wheels, 0 in hot standby");
+            out << "swd_active " << (m_active ? 1 : 0) << "\n";
+
+            // Commands
+            header("swd_commands_total", "counter", "Velocity commands received");
+            out << "swd_commands_total " << load(m_command_stats.received) << "\n";
+            header("swd_commands_suppressed_total", "counter", "Velocity commands ignored by a standby controller");
+            out << "swd_commands_suppressed_total " << load(m_command_stats.suppressed) << "\n";
+            header("swd_commands_overridden_total", "counter", "Velocity commands blocked by a higher priority source or a lock");
+            out << "swd_commands_overridden_total " << load(m_command_stats.overridden) << "\n";
+            header("swd_commands_executed_total", "counter", "Velocity commands executed, by source");
+            for (size_t source = 0; source < m_command_mux.sources(); source++) {
+                out << "swd_commands_executed_total{source=\"" << m_command_mux.sourceName(source) << "\"} " << m_command_mux.executed(source) << "\n";
+            }
+            header("swd_commands_limited_total", "counter", "Setpoints scaled down by a speed limit");
+            out << "swd_commands_limited_total " << load(m_command_stats.limited) << "\n";
+            header("swd_commands_failed_total", "counter", "Setpoints not accepted by a drive");
+            out << "swd_commands_failed_total " << load(m_command_stats.failed) << "\n";
+            header("swd_command_timeouts_total", "counter", "Stale commands, the moving wheels were stopped by the watchdog");
+            out << "swd_command_timeouts_total " << load(m_command_stats.timeouts) << "\n";
+
+            // Drives
+            header("swd_drive_calls_total", "counter", "Calls to the drive backend");
+            out << "swd_drive_calls_total{wheel=\"left\"} " << load(m_left_stats.calls) << "\n";
+            out << "swd_drive_calls_total{wheel=\"right\"} " << load(m_right_stats.calls) << "\n";
+
+            header("swd_drive_errors_total", "counter", "Failed calls to the drive backend by error code");
+            for (const auto &drive : {std::make_pair("left", &m_left_stats), std::make_pair("right", &m_right_stats)}) {
+                std::pair<int32_t, uint64_t> errors[ErrorCounters::SLOTS];
+                size_t                       n_errors = drive.second->errors.snapshot(errors, ErrorCounters::SLOTS);
+                for (size_t i = 0; i < n_errors; i++) {
+                    out << "swd_drive_errors_total{wheel=\"" << drive.first << "\",code=\"" << errors[i].first << "\"} " << errors[i].second << "\n";
+                }
+                out << "swd_drive_errors_total{wheel=\"" << drive.first << "\",code=\"other\"} " << drive.second->errors.others() << "\n";
+            }
+
+            header("swd_drive_call_duration_seconds", "histogram", "Latency of the calls to the drive backend");
+            histogram("swd_drive_call_duration_seconds", "wheel=\"left\"", m_left_stats.latency);
+            histogram("swd_drive_call_duration_seconds", "wheel=\"right\"", m_right_stats.latency);
+
+            header("swd_drive_nmt_state", "gauge", "Last NMT state read, -1 when the read failed");
+            out << "swd_drive_nmt_state{wheel=\"left\"} " << m_left_stats.nmt_state.load(std::memory_order_relaxed) << "\n";
+            out << "swd_drive_nmt_state{wheel=\"right\"} " << m_right_stats.nmt_state.load(std::memory_order_relaxed) << "\n";
+            header("swd_drive_pds_state", "gauge", "Last PDS state read, -1 when the read failed");
+            out << "swd_drive_pds_state{wheel=\"left\"} " << m_left_stats.pds_state.load(std::memory_order_relaxed) << "\n";
+            out << "swd_drive_pds_state{wheel=\"right\"} " << m_right_stats.pds_state.load(std::memory_order_relaxed) << "\n";
+
+            if (m_left_actuation || m_right_actuation) {
+                header("swd_actuation_confirmed_total", "counter", "Setpoints read back applied by the drive");
+                out << "swd_actuation_confirmed_total{wheel=\"left\"} " << load(m_left_stats.actuation_confirmed) << "\n";
+                out << "swd_actuation_confirmed_total{wheel=\"right\"} " << load(m_right_stats.actuation_confirmed) << "\n";
+                header("swd_actuation_unconfirmed_total", "counter", "Setpoints not applied by the drive within actuation_timeout_ms");
+                out << "swd_actuation_unconfirmed_total{wheel=\"left\"} " << load(m_left_stats.actuation_unconfirmed) << "\n";
+                out << "swd_actuation_unconfirmed_total{wheel=\"right\"} " << load(m_right_stats.actuation_unconfirmed) << "\n";
+                header("swd_actuation_latency_seconds", "histogram", "Time from a setpoint being sent to its readback from the drive");
+                histogram("swd_actuation_latency_seconds", "wheel=\"left\"", m_left_stats.actuation);
+                histogram("swd_actuation_latency_seconds", "wheel=\"right\"", m_right_stats.actuation);
+            }
+
+            // Control loop and odometry
+            header("swd_control_cycles_total", "counter", "Control cycles");
+            out << "swd_control_cycles_total " << load(m_loop_stats.cycles) << "\n";
+            header("swd_control_missed_deadlines_total", "counter", "Control cycles started or run later than a period");
+            out << "swd_control_missed_deadlines_total " << load(m_loop_stats.missed_deadlines) << "\n";
+            header("swd_publication_drops_total", "counter", "Odometry samples dropped, the publication thread lagged a full queue behind");
+            out << "swd_publication_drops_total " << load(m_loop_stats.publication_drops) << "\n";
+            header("swd_control_lateness_seconds", "histogram", "Delay of the control cycles after their scheduled time, the odometry jitter");
+            histogram("swd_control_lateness_seconds", "", m_loop_stats.lateness);
+            header("swd_control_duration_seconds", "histogram", "Duration of the control cycles");
+            histogram("swd_control_duration_seconds", "", m_loop_stats.duration);
+            header("swd_shedding_level", "gauge", "Load shedding level of the overload policy");
+            out << "swd_shedding_level " << m_loop_stats.shed_level.load(std::memory_order_relaxed) << "\n";
+            header("swd_odometry_degraded_samples_total", "counter", "Odometry samples computed with an extrapolated wheel");
+            out << "swd_odometry_degraded_samples_total " << load(m_degraded_samples) << "\n";
+            header("swd_odometry_slip_samples_total", "counter", "Odometry samples computed while a wheel slips");
+            out << "swd_odometry_slip_samples_total " << load(m_slip_samples) << "\n";
+
+            // Safety functions
+            header("swd_safety_edges_total", "counter", "Changes of the safety functions");
+            out << "swd_safety_edges_total " << load(m_safety_stats.edges) << "\n";
+            header("swd_safety_inconsistencies_total", "counter", "Safety functions read differently from the left and right drives");
+            out << "swd_safety_inconsistencies_total{function=\"sbc\"} " << load(m_safety_stats.sbc_inconsistencies) << "\n";
+            out << "swd_safety_inconsistencies_total{function=\"sto\"} " << load(m_safety_stats.sto_inconsistencies) << "\n";
+            header("swd_safety_reaction_seconds", "histogram", "Time from a safety function edge being read to the next setpoint sent to the drives");
+            histogram("swd_safety_reaction_seconds", "", m_safety_stats.reaction);
+
+            // Recovery events
+            header("swd_recovery_events_total", "counter", "Recovery actions taken by the controller");
+            out << "swd_recovery_events_total{kind=\"failover\"} " << load(m_recovery_stats.failovers) << "\n";
+            out << "swd_recovery_events_total{kind=\"nmt_restart\"} " << load(m_recovery_stats.nmt_restarts) << "\n";
+            out << "swd_recovery_events_total{kind=\"pds_restart\"} " << load(m_recovery_stats.pds_restarts) << "\n";
+            out << "swd_recovery_events_total{kind=\"shedding_change\"} " << load(m_recovery_stats.shedding_changes) << "\n";
+
+            return out.str();
+        }
+
+        ControllerState DiffDriveController::currentState(const ros::Time &timestamp)
+        {
+            ControllerState state;
+
+            state.stamp_ns           = static_cast<int64_t>(timestamp.toNSec());
+            state.x                  = m_x_prev;
+            state.y                  = m_y_prev;
+            state.theta              = m_theta_prev;
+            state.x_err              = m_x_prev_err;
+            state.y_err              = m_y_prev_err;
+            state.theta_err          = m_theta_prev_err;
+            state.dist_left_mm       = m_dist_left_prev_mm;
+            state.dist_right_mm      = m_dist_right_prev_mm;
+            state.left_speed_mps     = m_left_speed_mps;
+            state.right_speed_mps    = m_right_speed_mps;
+            state.left_setpoint_rpm  = m_left_setpoint_rpm;
+            state.right_setpoint_rpm = m_right_setpoint_rpm;
+            state.nmt_ok             = m_nmt_ok;
+            state.pds_ok             = m_pds_ok;
+
+            m_safety_msg_mtx.lock();
+            state.safety_limited_speed = m_safety_msg.safety_limited_speed;
+            m_safety_msg_mtx.unlock();
+
+            return state;
+        }
+
+        void DiffDriveController::restorePose(const ControllerState &state)
+        {
+            m_x_prev         = state.x;
+            m_y_prev         = state.y;
+            m_theta_prev     = state.theta;
+            m_x_prev_err     = state.x_err;
+            m_y_prev_err     = state.y_err;
+            m_theta_prev_err = state.theta_err;
+
+            m_wheels_heading_offset = 0.0;
+        }
+
+        void DiffDriveController::publishState(const ros::Time &timestamp)
+        {
+            if (!m_hot_standby && !m_checkpoint.isOpen()) {
+                return;
+            }
+
+            ControllerState state = currentState(timestamp);
+
+            if (m_hot_standby) {
+                m_state_store.write(state);
+                m_loop_alive_ns.store(StateStore::monotonicNs(), std::memory_order_relaxed);
+            }
+
+            if (m_checkpoint.isOpen()) {
+                m_checkpoint.write(state);
+            }
+        }
+
+        void DiffDriveController::restoreCheckpoint(int max_gap_mm)
+        {
+            ControllerState state;
+
+            if (!m_checkpoint.read(state)) {
+                ROS_INFO("No odometry checkpoint to restore, starting from the origin.");
+                return;
+            }
+
+            restorePose(state);
+
+            // The drives keep counting while the node is down, unless they have been restarted too
+            if ((std::abs(m_dist_left_prev_mm - state.dist_left_mm) <= max_gap_mm) && (std::abs(m_dist_right_prev_mm - state.dist_right_mm) <= max_gap_mm)) {
+                m_dist_left_prev_mm  = state.dist_left_mm;
+                m_dist_right_prev_mm = state.dist_right_mm;
+
+                // The first twist is then averaged over the downtime
+                ros::Time checkpoint_stamp;
+                checkpoint_stamp.fromNSec(static_cast<uint64_t>(state.stamp_ns));
+                if (checkpoint_stamp < ros::Time::now()) {
+                    m_odom_prev_stamp = checkpoint_stamp;
+                }
+
+                ROS_INFO("Odometry restored from checkpoint: (x, y, theta) = (%f, %f, %f), integrating from encoders (left, right) = (%d, %d) mm.",
+                         m_x_prev, m_y_prev, m_theta_prev, m_dist_left_prev_mm, m_dist_right_prev_mm);
+            } else {
+                ROS_WARN("Odometry restored from checkpoint: (x, y, theta) = (%f, %f, %f), but the encoders (left, right) = (%d, %d) mm "
+                         "are inconsistent with the checkpoint (%d, %d) mm, the motion since the checkpoint is lost.",
+                         m_x_prev, m_y_prev, m_theta_prev, m_dist_left_prev_mm, m_dist_right_prev_mm, state.dist_left_mm, state.dist_right_mm);
+            }
+        }
+
+        void DiffDriveController::startTimers(bool start)
+        {
+            for (ros::Timer *timer : {&m_timer_odom, &m_timer_watchdog, &m_timer_pds, &m_timer_safety}) {
+                if (start) {
+                    timer->start();
+                } else {
+                    timer->stop();
+                }
+            }
+        }
+
+        ///
+        /// \brief Put the drives in the mode of the velocity setpoints, with the ramps in profile velocity mode
+        ///
+        void DiffDriveController::applyVelocityMode()
+        {
+            if (DriveInterface::OperationMode::PROFILE_VELOCITY == m_velocity_mode) {
+                bool ok = (ERROR_NONE == m_left_controller->setOperationMode(DriveInterface::OperationMode::PROFILE_VELOCITY)) &&
+                          (ERROR_NONE == m_right_controller->setOperationMode(DriveInterface::OperationMode::PROFILE_VELOCITY)) && applyDriveRamps();
+                if (ok) {
+                    return;
+                }
+
+                ROS_WARN("The drives don't support the profile velocity mode, the setpoints won't be ramped.");
+                m_velocity_mode = DriveInterface::OperationMode::VELOCITY;
+
+                for (ActuationMonitor *monitor : {m_left_actuation.get(), m_right_actuation.get()}) {
+                    if (monitor) {
+                        monitor->setRamps(0.0, 0.0);
+                    }
+                }
+
+                if (m_slip_detector) {
+                    m_slip_detector->setRamps(0.0, 0.0);
+                }
+            }
+
+            for (DriveInterface *drive : {m_left_controller.get(), m_right_controller.get()}) {
+                ezw_error_t err = drive->setOperationMode(DriveInterface::OperationMode::VELOCITY);
+                if (ERROR_NONE != err) {
+                    ROS_ERROR("Failed setting the velocity mode, EZW_ERR: %d", (int)err);
+                }
+            }
+        }
+
+        bool DiffDriveController::applyDriveRamps()
+        {
+            bool ok = true;
+            for (const auto &wheel : {std::make_tuple(m_left_controller.get(), m_l_motor_reduction, m_left_wheel_diameter_m * m_left_scale, m_left_actuation.get()),
+                                      std::make_tuple(m_right_controller.get(), m_r_motor_reduction, m_right_wheel_diameter_m * m_right_scale, m_right_actuation.get())}) {
+                DriveInterface *drive        = std::get<0>(wheel);
+                double          rpm_per_mps  = 60.0 * std::get<1>(wheel) / (M_PI * std::get<2>(wheel));
+                uint32_t        acceleration = static_cast<uint32_t>(M_MAX(1.0, std::round(m_drive_acceleration_mps2 * rpm_per_mps)));
+                uint32_t        deceleration = static_cast<uint32_t>(M_MAX(1.0, std::round(m_drive_deceleration_mps2 * rpm_per_mps)));
+
+                ok = ok && (ERROR_NONE == drive->setProfile(static_cast<uint32_t>(m_max_motor_speed_rpm), acceleration, deceleration));
+
+                // The velocity demand reaches a new setpoint at the end of the ramp
+                if (std::get<3>(wheel)) {
+                    std::get<3>(wheel)->setRamps(acceleration, deceleration);
+                }
+            }
+
+            // The wheels follow the ramps, they don't slip meanwhile
+            if (m_slip_detector) {
+                m_slip_detector->setRamps(m_drive_acceleration_mps2, m_drive_deceleration_mps2);
+            }
+
+            return ok;
+        }
+
+        void DiffDriveController::sendHeartbeats()
+        {
+            for (const auto &wheel : {std::make_pair("left", m_left_controller.get()), std::make_pair("right", m_right_controller.get())}) {
+                ezw_error_t err = wheel.second->sendHeartbeat();
+                if (ERROR_NONE != err) {
+                    ROS_ERROR_THROTTLE(1.0, "Failed sending the heartbeat to the %s drive, EZW_ERR: %d", wheel.first, (int)err);
+                }
+            }
+        }
+
+        void DiffDriveController::cbReconfigure(swd_ros_controllers::DriveRampConfig &config, uint32_t level)
+        {
+            (void)level;
+
+            if (DriveInterface::OperationMode::PROFILE_VELOCITY != m_velocity_mode) {
+                ROS_WARN("The drives don't ramp the setpoints, the new ramps are ignored.");
+                return;
+            }
+
+            m_drive_acceleration_mps2 = config.drive_acceleration_mps2;
+            m_drive_deceleration_mps2 = config.drive_deceleration_mps2;
+
+            // Only the profile is rewritten, changing the mode would drop the setpoints of the moving wheels.
+            // Otherwise applied when the drives come back to velocity mode, or are taken over
+            if (m_active && !m_move_active && !applyDriveRamps()) {
+                ROS_ERROR("Failed setting the drive ramps, the previous ones may still apply.");
+            }
+
+            ROS_INFO("Drive ramps set to %f m/s^2 (acceleration), %f m/s^2 (deceleration).", m_drive_acceleration_mps2, m_drive_deceleration_mps2);
+        }
+
+        void DiffDriveController::cbTimerStandby()
+        {
+            if (m_state_store.ownerAlive(static_cast<int64_t>(m_hot_standby_timeout_ms) * 1000000)) {
+                return;
+            }
+
+            int64_t heartbeat_age_ns = m_state_store.heartbeatAgeNs();
+
+            if (m_state_store.tryAcquire(static_cast<int64_t>(m_hot_standby_timeout_ms) * 1000000)) {
+                takeOver(heartbeat_age_ns);
+            }
+        }
+
+        void DiffDriveController::takeOver(int64_t heartbeat_age_ns)
+        {
+            int64_t         last_heartbeat_ns = StateStore::monotonicNs() - heartbeat_age_ns;
+            ControllerState state;
+
+            m_recovery_stats.failovers.fetch_add(1, std::memory_order_relaxed);
+
+            if (m_state_store.read(state)) {
+                // Continue integrating from the last sample of the failed controller, the motion
+                // during the failover is accounted for by the next control cycle
+                restorePose(state);
+                m_dist_left_prev_mm  = state.dist_left_mm;
+                m_dist_right_prev_mm = state.dist_right_mm;
+                m_left_speed_mps     = state.left_speed_mps;
+                m_right_speed_mps    = state.right_speed_mps;
+                m_odom_prev_stamp.fromNSec(static_cast<uint64_t>(state.stamp_ns));
+                m_nmt_ok = state.nmt_ok;
+                m_pds_ok = state.pds_ok;
+
+                m_safety_msg_mtx.lock();
+                m_safety_msg.safety_limited_speed = state.safety_limited_speed;
+                m_safety_msg_mtx.unlock();
+            } else {
+                ROS_WARN("Hot standby: no state published by the failed controller, starting odometry from the origin.");
+                m_left_controller->getOdometryValue(m_dist_left_prev_mm);
+                m_right_controller->getOdometryValue(m_dist_right_prev_mm);
+                state.left_setpoint_rpm = state.right_setpoint_rpm = 0;
+            }
+
+            // The failed controller may have left the drives in the middle of a relative move
+            if (m_move_server || (DriveInterface::OperationMode::VELOCITY != m_velocity_mode)) {
+                applyVelocityMode();
+            }
+
+            // Before the drives' timeout expires, if the failover was fast enough
+            if (m_drive_timeout) {
+                sendHeartbeats();
+            }
+
+            m_active = true;
+            m_loop_alive_ns.store(StateStore::monotonicNs(), std::memory_order_relaxed);
+            m_timer_standby.stop();
+            startTimers(true);
+
+            // Keep the wheels at the failed controller's setpoints, the watchdog stops them if no command follows
+            setSpeeds(state.left_setpoint_rpm, state.right_setpoint_rpm);
+
+            double failover_ms = static_cast<double>(StateStore::monotonicNs() - last_heartbeat_ns) * 1e-6;
+            ROS_WARN("Hot standby: active controller lost, took over the drives %.3f ms after its last heartbeat.", failover_ms);
+
+            diagnostic_msgs::DiagnosticStatus status;
+            diagnostic_msgs::KeyValue         kv;
+
+            status.name        = ros::this_node::getName() + ": Hot standby";
+            status.hardware_id = m_base_frame;
+            status.level       = diagnostic_msgs::DiagnosticStatus::WARN;
+            status.message     = "Took over the drives";
+
+            kv.key   = "failover_time_ms";
+            kv.value = std::to_string(failover_ms);
+            status.values.push_back(kv);
+
+            publishDiagnostic(status);
+        }
+
+        void DiffDriveController::stepDown()
+        {
+            ROS_ERROR("Hot standby: another controller took over the drives, switching to standby.");
+
+            // The drives belong to the new owner, the move is left to it
+            if (m_move_active) {
+                m_move_active = false;
+                m_timer_move.stop();
+                m_move_server->setAborted(moveResult("Another controller took over the drives"));
+            }
+
+            m_active = false;
+            startTimers(false);
+            m_timer_standby.start();
+        }
+
+        void DiffDriveController::cbTimerStateMachine()
+        {
+            // NMT state machine
+            smccore::Controller::NMTState nmt_state_l, nmt_state_r;
+            smccore::Controller::PDSState pds_state_l, pds_state_r;
+            ezw_error_t                   err_l, err_r;
+
+            nmt_state_l = nmt_state_r = smccore::Controller::NMTState::UNKNOWN;
+            pds_state_l = pds_state_r = smccore::Controller::PDSState::SWITCH_ON_DISABLED;
+
+            err_l = m_left_controller->getNMTState(nmt_state_l);
+            err_r = m_right_controller->getNMTState(nmt_state_r);
+
+            if (ERROR_NONE != err_l) {
+                ROS_ERROR("Failed to get the NMT state for left motor, EZW_ERR: SMCService : "
+                          "Controller::getPDSState() return error code : %d",
+                          (int)err_l);
+            }
+
+            if (ERROR_NONE != err_r) {
+                ROS_ERROR("Failed to get the NMT state for right motor, EZW_ERR: SMCService : "
+                          "Controller::getPDSState() return error code : %d",
+                          (int)err_r);
+            }
+
+            if (smccore::Controller::NMTState::OPER != nmt_state_l) {
+                err_l = m_left_controller->setNMTState(smccore::Controller::NMTCommand::OPER);
+                m_recovery_stats.nmt_restarts.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (smccore::Controller::NMTState::OPER != nmt_state_r) {
+                err_r = m_right_controller->setNMTState(smccore::Controller::NMTCommand::OPER);
+                m_recovery_stats.nmt_restarts.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (ERROR_NONE != err_l && smccore::Controller::NMTState::OPER != nmt_state_l) {
+                ROS_ERROR("Failed to set NMT state for left motor, EZW_ERR: SMCService : "
+                          "Controller::setNMTState() return error code : %d",
+                          (int)err_l);
+            }
+
+            if (ERROR_NONE != err_r && smccore::Controller::NMTState::OPER != nmt_state_r) {
+                ROS_ERROR("Failed to set NMT state for right motor, EZW_ERR: SMCService : "
+                          "Controller::setNMTState() return error code : %d",
+                          (int)err_r);
+            }
+
+            m_nmt_ok = (smccore::Controller::NMTState::OPER == nmt_state_l) && (smccore::Controller::NMTState::OPER == nmt_state_r);
+
+            // If NMT is operational, check the PDS state
+            if (m_nmt_ok) {
+                // PDS state machine
+                err_l = m_left_controller->getPDSState(pds_state_l);
+                err_r = m_right_controller->getPDSState(pds_state_r);
+
+                if (ERROR_NONE != err_l) {
+                    ROS_ERROR("Failed to get the PDS state for left motor, EZW_ERR: SMCService : "
+                              "Controller::getPDSState() return error code : %d",
+                              (int)err_l);
+                }
+
+                if (ERROR_NONE != err_r) {
+                    ROS_ERROR("Failed to get the PDS state for right motor, EZW_ERR: SMCService : "
+                              "Controller::getPDSState() return error code : %d",
+                              (int)err_r);
+                }
+
+                if (smccore::Controller::PDSState::OPERATION_ENABLED != pds_state_l) {
+                    err_l = m_left_controller->enterInOperationEnabledState();
+                    m_recovery_stats.pds_restarts.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                if (smccore::Controller::PDSState::OPERATION_ENABLED != pds_state_r) {
+                    err_r = m_right_controller->enterInOperationEnabledState();
+                    m_recovery_stats.pds_restarts.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                if (ERROR_NONE != err_l && smccore::Controller::PDSState::OPERATION_ENABLED != pds_state_l) {
+                    ROS_ERROR("Failed to set PDS state for left motor, EZW_ERR: SMCService : "
+                              "Controller::enterInOperationEnabledState() return error code : %d",
+                              (int)err_l);
+                }
+
+                if (ERROR_NONE != err_r && smccore::Controller::PDSState::OPERATION_ENABLED != pds_state_r) {
+                    ROS_ERROR("Failed to set PDS state for right motor, EZW_ERR: SMCService : "
+                              "Controller::enterInOperationEnabledState() return error code : %d",
+                              (int)err_r);
+                }
+            }
+
+            m_pds_ok = (smccore::Controller::PDSState::OPERATION_ENABLED == pds_state_l) && (smccore::Controller::PDSState::OPERATION_ENABLED == pds_state_r);
+
+            if (!m_nmt_ok) {
+                ROS_WARN("NMT state machine is not OK.");
+            }
+
+            if (!m_pds_ok) {
+                ROS_WARN("PDS state machine is not OK.");
+            }
+        }
+
+        void DiffDriveController::cbSoftBrake(const std_msgs::Bool::ConstPtr &msg)
+        {
+            // The standby controller never drives the wheels
+            if (!m_active) {
+                return;
+            }
+
+            // The halted drives report their target as reached, the move can't complete
+            if (msg->data && m_move_active) {
+                swd_ros_controllers::RelativeMoveResult result = moveResult("Soft brake engaged");
+                stopMove();
+                m_move_server->setAborted(result, result.message);
+            }
+
+            // Requested state, a wheel failing to halt is reported below
+            m_soft_brake = msg->data;
+
+            // true => Enable brake
+            // false => Release brake
+            ezw_error_t err = m_left_controller->setHalt(msg->data);
+            if (ERROR_NONE != err) {
+                ROS_ERROR("SoftBrake: Failed %s left wheel, EZW_ERR: %d", msg->data ? "braking" : "releasing", (int)err);
+            } else {
+                ROS_INFO("SoftBrake: Left motor's soft brake %s", msg->data ? "activated" : "disabled");
+                if (m_left_actuation) {
+                    m_left_actuation->setHalted(msg->data);
+                }
+            }
+
+            err = m_right_controller->setHalt(msg->data);
+            if (ERROR_NONE != err) {
+                ROS_ERROR("SoftBrake: Failed %s right wheel, EZW_ERR: %d", msg->data ? "braking" : "releasing", (int)err);
+            } else {
+                ROS_INFO("SoftBrake: Right motor's soft brake %s", msg->data ? "activated" : "disabled");
+                if (m_right_actuation) {
+                    m_right_actuation->setHalted(msg->data);
+                }
+            }
+        }
+
+        void DiffDriveController::updateLoadShedding(bool deadline_missed)
+        {
+            if (!m_load_shedder->update(deadline_missed)) {
+                return;
+            }
+
+            m_recovery_stats.shedding_changes.fetch_add(1, std::memory_order_relaxed);
+
+            // Command execution and odometry integration are never shed, only the outputs are
+            LoadShedder::Level level = m_load_shedder->level();
+
+            if (LoadShedder::Level::NOMINAL != level) {
+                ROS_WARN("Control loop overloaded (%.0f%% of missed deadlines), load shedding level %d: %s.",
+                         100.0 * m_load_shedder->lastMissRatio(), static_cast<int>(level), LoadShedder::levelName(level));
+            } else {
+                ROS_INFO("Control loop load back to normal, all outputs restored.");
+            }
+
+            // Report every degradation step
+            diagnostic_msgs::DiagnosticStatus status;
+            diagnostic_msgs::KeyValue         kv;
+
+            status.name        = ros::this_node::getName() + ": Overload";
+            status.hardware_id = m_base_frame;
+            status.level       = (LoadShedder::Level::NOMINAL == level) ? diagnostic_msgs::DiagnosticStatus::OK : diagnostic_msgs::DiagnosticStatus::WARN;
+            status.message     = LoadShedder::levelName(level);
+
+            kv.key   = "shedding_level";
+            kv.value = std::to_string(static_cast<int>(level));
+            status.values.push_back(kv);
+
+            kv.key   = "missed_deadlines_ratio";
+            kv.value = std::to_string(m_load_shedder->lastMissRatio());
+            status.values.push_back(kv);
+
+            publishDiagnostic(status);
+        }
+
+        void DiffDriveController::calibrate(double d_left, double d_right, double d_theta, const ros::Time &timestamp)
+        {
+            if (!m_calibrator->update(d_left, d_right, d_theta)) {
+                return;
+            }
+
+            double baseline_m  = m_calibrator->baseline();
+            double left_scale  = m_calibrator->leftScale();
+            double right_scale = m_calibrator->rightScale();
+
+            // Apply settled and plausible estimates only
+            bool applied = m_calibration_apply && m_calibrator->converged() &&
+                           (std::abs(baseline_m / m_nominal_baseline_m - 1.0) < CALIBRATION_MAX_DEVIATION) &&
+                           (std::abs(left_scale - 1.0) < CALIBRATION_MAX_DEVIATION) && (std::abs(right_scale - 1.0) < CALIBRATION_MAX_DEVIATION);
+
+            if (applied) {
+                m_baseline_m  = baseline_m;
+                m_left_scale  = left_scale;
+                m_right_scale = right_scale;
+            }
+
+            swd_ros_controllers::KinematicCalibration msg;
+            msg.header.stamp    = timestamp;
+            msg.header.frame_id = m_base_frame;
+            msg.baseline_m      = baseline_m;
+            msg.left_scale      = left_scale;
+            msg.right_scale     = right_scale;
+            msg.samples         = m_calibrator->samples();
+            msg.converged       = m_calibrator->converged();
+            msg.applied         = applied;
+            m_pub_calibration.publish(msg);
+        }
+
+        void DiffDriveController::publishWheelSlip(const ros::Time &timestamp, bool yaw_slip, double yaw_rate_error)
+        {
+            uint8_t left_state  = static_cast<uint8_t>(m_slip_detector->leftState());
+            uint8_t right_state = static_cast<uint8_t>(m_slip_detector->rightState());
+
+            // Only the changes are published, in the cycle they are detected
+            if ((left_state == m_slip_event.left_state) && (right_state == m_slip_event.right_state) && (yaw_slip == m_slip_event.yaw_slip)) {
+                return;
+            }
+
+            if ((swd_ros_controllers::WheelSlip::OK != left_state) || (swd_ros_controllers::WheelSlip::OK != right_state) || yaw_slip) {
+                ROS_WARN("Wheel slip detected (left: %s, right: %s, base skid: %s).", SlipDetector::stateName(m_slip_detector->leftState()),
+                         SlipDetector::stateName(m_slip_detector->rightState()), yaw_slip ? "yes" : "no");
+            } else {
+                ROS_INFO("Wheel slip cleared.");
+            }
+
+            m_slip_event.header.stamp    = timestamp;
+            m_slip_event.header.frame_id = m_base_frame;
+            m_slip_event.left_state      = left_state;
+            m_slip_event.right_state     = right_state;
+            m_slip_event.yaw_slip        = yaw_slip;
+            m_slip_event.left_error_mps  = m_slip_detector->leftError();
+            m_slip_event.right_error_mps = m_slip_detector->rightError();
+            m_slip_event.yaw_rate_error  = yaw_rate_error;
+            m_pub_wheel_slip.publish(m_slip_event);
+        }
+
+        void DiffDriveController::runCharacterisation(double speed_rpm, int sample_hz, std::string report_file)
+        {
+            // Enable the drives, as the state machine timer would
+            while (ros::ok() && !(m_nmt_ok && m_pds_ok)) {
+                cbTimerStateMachine();
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+
+            if (!ros::ok()) {
+                return;
+            }
+
+            ROS_INFO("Characterisation: running the step and chirp sequence for %f s at %f rpm, the wheels must be free to turn.", m_characterisation->duration(), speed_rpm);
+
+            const int32_t left_max_rpm  = static_cast<int32_t>(std::round(speed_rpm * m_l_motor_reduction));
+            const int32_t right_max_rpm = static_cast<int32_t>(std::round(speed_rpm * m_r_motor_reduction));
+            const auto    period        = std::chrono::nanoseconds((sample_hz > 0) ? (1000000000 / sample_hz) : 0);
+            const auto    start         = std::chrono::steady_clock::now();
+            auto          next_sample   = start;
+            auto          next_safety   = start;
+            int32_t       left_sent = 0, right_sent = 0;
+            int32_t       left_mm, right_mm;
+
+            setSpeeds(0, 0);
+
+            while (ros::ok()) {
+                auto   now = std::chrono::steady_clock::now();
+                double t   = std::chrono::duration<double>(now - start).count();
+
+                if (t >= m_characterisation->duration()) {
+                    break;
+                }
+
+                // Setpoints go through the normal path, with its speed limits, and only when they change
+                double  setpoint = m_characterisation->setpoint(t);
+                int32_t left     = static_cast<int32_t>(std::round(setpoint * left_max_rpm));
+                int32_t right    = static_cast<int32_t>(std::round(setpoint * right_max_rpm));
+
+                if ((left != left_sent) || (right != right_sent)) {
+                    setSpeeds(left, right);
+                    left_sent  = left;
+                    right_sent = right;
+                }
+
+                if ((ERROR_NONE == m_left_controller->getOdometryValue(left_mm)) && (ERROR_NONE == m_right_controller->getOdometryValue(right_mm))) {
+                    double left_cmd_mps  = m_left_setpoint_rpm / m_l_motor_reduction * M_PI * m_left_wheel_diameter_m / 60.0;
+                    double right_cmd_mps = m_right_setpoint_rpm / m_r_motor_reduction * M_PI * m_right_wheel_diameter_m / 60.0;
+
+                    m_characterisation->record(t, left_cmd_mps, right_cmd_mps, left_mm / 1000.0, right_mm / 1000.0);
+                }
+
+                // Keep the safety functions, and the SLS limit, supervised at their nominal rate
+                if (m_publish_safety && (now >= next_safety)) {
+                    cbTimerSafety();
+                    next_safety += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(SAFETY_PERIOD_S));
+                }
+
+                // Sample as fast as the drives answer without sampling rate, don't burst to catch up after a late sample
+                if (sample_hz > 0) {
+                    next_sample = std::max(next_sample + period, now);
+                    std::this_thread::sleep_until(next_sample);
+                }
+            }
+
+            setSpeeds(0, 0);
+
+            if (!ros::ok()) {
+                ROS_WARN("Characterisation: interrupted, no report written.");
+                return;
+            }
+
+            ROS_INFO("Characterisation: %zu samples at %f Hz, analysing...", m_characterisation->samples(), m_characterisation->sampleRate());
+
+            DriveCharacterisation::Result left_result  = m_characterisation->analyse(DriveCharacterisation::Wheel::LEFT);
+            DriveCharacterisation::Result right_result = m_characterisation->analyse(DriveCharacterisation::Wheel::RIGHT);
+
+            for (const auto &wheel : {std::make_pair("left", &left_result), std::make_pair("right", &right_result)}) {
+                ROS_INFO("Characterisation: %s wheel, dead time %.1f ms, time constant %.1f ms, gain %.3f, bandwidth %.2f Hz (model %.2f Hz).", wheel.first,
+                         wheel.second->dead_time_s * 1000.0, wheel.second->time_constant_s * 1000.0, wheel.second->gain, wheel.second->bandwidth_hz, wheel.second->model_bandwidth_hz);
+            }
+
+            if (m_characterisation->writeReport(report_file, left_result, right_result)) {
+                ROS_INFO("Characterisation: report written to '%s'.", report_file.c_str());
+            } else {
+                ROS_ERROR("Characterisation: failed writing the report to '%s'.", report_file.c_str());
+            }
+
+            ros::requestShutdown();
+        }
+
+        void DiffDriveController::cbImu(const sensor_msgs::ImuConstPtr &msg)
+        {
+            // The IMU's z axis is expected to be parallel to the base frame's one
+            double yaw_rate = msg->angular_velocity.z;
+
+            std::lock_guard<std::mutex> lock(m_imu_mtx);
+
+            if (m_robot_still) {
+                m_gyro_bias += GYRO_BIAS_GAIN * (yaw_rate - m_gyro_bias);
+            }
+
+            yaw_rate -= m_gyro_bias;
+
+            double dt = (msg->header.stamp - m_imu_prev_stamp).toSec();
+
+            // Integrate the yaw increment at the IMU rate (trapezoidal rule), skip the gaps
+            if (!m_imu_prev_stamp.isZero() && (dt > 0.0) && (dt < m_imu_timeout_s)) {
+                m_imu_d_theta += 0.5 * (yaw_rate + m_imu_yaw_rate) * dt;
+                m_imu_dt += dt;
+            }
+
+            m_imu_yaw_rate   = yaw_rate;
+            m_imu_prev_stamp = msg->header.stamp;
+        }
+
+        bool DiffDriveController::cbSetOdometry(swd_ros_controllers::SetOdometry::Request &req, swd_ros_controllers::SetOdometry::Response &res)
+        {
+            res.success = false;
+
+            if (!m_active) {
+                res.message = "Standby controller, the odometry is owned by the active controller";
+                return true;
+            }
+
+            if (!req.reset && (!std::isfinite(req.pose.x) || !std::isfinite(req.pose.y) || !std::isfinite(req.pose.theta) ||
+                               !(req.x_variance >= 0.) || !(req.y_variance >= 0.) || !(req.theta_variance >= 0.))) {
+                res.message = "Invalid pose or variances";
+                return true;
+            }
+
+            std::lock_guard<std::mutex> lock(m_odom_mtx);
+
+            // Rebase on the current encoder values, the motion since the last integration step
+            // must not be applied on top of the requested pose
+            int32_t left_dist_now_mm, right_dist_now_mm;
+
+            if (ERROR_NONE == m_left_controller->getOdometryValue(left_dist_now_mm)) {
+                m_dist_left_prev_mm   = left_dist_now_mm;
+                m_left_missed_samples = 0;
+            }
+
+            if (ERROR_NONE == m_right_controller->getOdometryValue(right_dist_now_mm)) {
+                m_dist_right_prev_mm   = right_dist_now_mm;
+                m_right_missed_samples = 0;
+            }
+
+            ros::Time stamp = ros::Time::now();
+
+            if (req.reset) {
+                m_x_prev = m_y_prev = m_theta_prev = 0.0;
+                m_x_prev_err = m_y_prev_err = m_theta_prev_err = 0.0;
+            } else {
+                m_x_prev         = req.pose.x;
+                m_y_prev         = req.pose.y;
+                m_theta_prev     = M_BOUND_ANGLE(std::remainder(req.pose.theta, 2. * M_PI));
+                m_x_prev_err     = std::sqrt(req.x_variance);
+                m_y_prev_err     = std::sqrt(req.y_variance);
+                m_theta_prev_err = std::sqrt(req.theta_variance);
+            }
+
+            m_wheels_heading_offset = 0.0;
+
+            m_odom_prev_stamp = stamp;
+            publishState(stamp);
+
+            ROS_INFO("Odometry set to (x, y, theta) = (%f, %f, %f) at t = %f.", m_x_prev, m_y_prev, m_theta_prev, stamp.toSec());
+
+            res.success = true;
+            res.stamp   = stamp;
+            res.message = req.reset ? "Odometry reset" : "Odometry set";
+            return true;
+        }
+
+        void DiffDriveController::runPublication()
+        {
+            PoseSample                   sample;
+            std::unique_lock<std::mutex> lock(m_publication_mtx);
+
+            while (!m_publication_stop) {
+                if (!m_pose_samples.pop(sample)) {
+                    m_publication_cv.wait(lock);
+                    continue;
+                }
+
+                // Serialisation and socket writes run unlocked
+                lock.unlock();
+                publishPose(sample);
+                lock.lock();
+            }
+        }
+
+        void DiffDriveController::publishPose(const PoseSample &sample)
+        {
+            // Outputs are only computed when they have subscribers. The TF broadcaster doesn't tell, the TF is then always sent.
+            bool publish_odom   = m_publish_odom && (m_pub_odom.getNumSubscribers() > 0);
+            bool publish_status = m_publish_odom && sample.status_due && (m_pub_odom_status.getNumSubscribers() > 0);
+            bool publish_tf     = m_publish_tf && sample.tf_due && (!m_serialized_tf || (m_pub_tf.getNumSubscribers() > 0));
+
+            tf2::Quaternion quat_orientation;
+            if (publish_odom || publish_tf) {
+                quat_orientation.setRPY(0.0, 0.0, sample.theta);
+            }
+
+            if (publish_odom) {
+                // Set uncertainties for linear and angular velocities (6 * 6) matrix (x y z Rx Ry Rz)
+                double var_linear_speed  = std::pow(sample.linear_err, 2);
+                double var_angular_speed = std::pow(sample.angular_err, 2);
+
+                // Set uncertainties for x, y, and theta (Rz)
+                double var_x     = std::pow(sample.x_err, 2);
+                double var_y     = std::pow(sample.y_err, 2);
+                double var_theta = std::pow(sample.theta_err, 2);
+
+                if (m_serialized_odom) {
+                    m_serialized_odom->setHeader(sample.seq, sample.stamp);
+                    m_serialized_odom->setPose(sample.x, sample.y, quat_orientation.getZ(), quat_orientation.getW(), var_x, var_y, var_theta);
+                    m_serialized_odom->setTwist(sample.linear, sample.angular, var_linear_speed, var_angular_speed);
+                    m_pub_odom.publish(m_serialized_odom->message());
+                } else {
+                    nav_msgs::Odometry msg_odom;
+                    msg_odom.header.seq      = sample.seq;
+                    msg_odom.header.stamp    = sample.stamp;
+                    msg_odom.header.frame_id = m_odom_frame;
+                    msg_odom.child_frame_id  = m_base_frame;
+
+                    msg_odom.twist.twist.linear.x  = sample.linear;
+                    msg_odom.twist.twist.angular.z = sample.angular;
+                    msg_odom.twist.covariance[0]   = var_linear_speed;
+                    msg_odom.twist.covariance[35]  = var_angular_speed;
+
+                    msg_odom.pose.pose.position.x    = sample.x;
+                    msg_odom.pose.pose.position.y    = sample.y;
+                    msg_odom.pose.pose.position.z    = 0.0;
+                    msg_odom.pose.pose.orientation.x = quat_orientation.getX();
+                    msg_odom.pose.pose.orientation.y = quat_orientation.getY();
+                    msg_odom.pose.pose.orientation.z = quat_orientation.getZ();
+                    msg_odom.pose.pose.orientation.w = quat_orientation.getW();
+                    msg_odom.pose.covariance[0]      = var_x;
+                    msg_odom.pose.covariance[7]      = var_y;
+                    msg_odom.pose.covariance[35]     = var_theta;
+
+                    m_pub_odom.publish(msg_odom);
+                }
+            }
+
+            // Telemetry is shed under overload, degraded and slipping samples are still reported
+            if (publish_status) {
+                swd_ros_controllers::OdometryStatus msg_status;
+                msg_status.header.seq         = sample.seq;
+                msg_status.header.stamp       = sample.stamp;
+                msg_status.header.frame_id    = m_odom_frame;
+                msg_status.degraded           = sample.degraded;
+                msg_status.left_extrapolated  = sample.left_extrapolated;
+                msg_status.right_extrapolated = sample.right_extrapolated;
+                msg_status.degraded_samples   = sample.degraded_samples;
+                msg_status.slip               = sample.slip;
+                msg_status.slip_samples       = sample.slip_samples;
+
+                m_pub_odom_status.publish(msg_status);
             }
 
-            if (ERROR_NONE != err_r && smccore::Controller::NMTState::OPER != nmt_state_r) {
-                ROS_ERROR("Failed to set NMT state for right motor, EZW_ERR: SMCService : "
-                          "Controller::setNMTState() return error code : %d",
-                          (int)err_r);
+            if (publish_tf) {
+                if (m_serialized_tf) {
+                    m_serialized_tf->setHeader(sample.seq, sample.stamp);
+                    m_serialized_tf->setTransform(sample.x, sample.y, quat_orientation.getZ(), quat_orientation.getW());
+                    m_pub_tf.publish(m_serialized_tf->message());
+                } else {
+                    geometry_msgs::TransformStamped tf_odom_baselink;
+                    tf_odom_baselink.header.stamp    = sample.stamp;
+                    tf_odom_baselink.header.frame_id = m_odom_frame;
+                    tf_odom_baselink.child_frame_id  = m_base_frame;
+
+                    tf_odom_baselink.transform.translation.x = sample.x;
+                    tf_odom_baselink.transform.translation.y = sample.y;
+                    tf_odom_baselink.transform.translation.z = 0.0;
+                    tf_odom_baselink.transform.rotation.x    = quat_orientation.getX();
+                    tf_odom_baselink.transform.rotation.y    = quat_orientation.getY();
+                    tf_odom_baselink.transform.rotation.z    = quat_orientation.getZ();
+                    tf_odom_baselink.transform.rotation.w    = quat_orientation.getW();
+
+                    // Send TF
+                    m_tf2_br.sendTransform(tf_odom_baselink);
+                }
             }
 
-            m_nmt_ok = (smccore::Controller::NMTState::OPER == nmt_state_l) && (smccore::Controller::NMTState::OPER == nmt_state_r);
+            if (sample.state_due && (m_pub_robot_state.getNumSubscribers() > 0)) {
+                publishRobotState(sample);
+            }
+        }
 
-            // If NMT is operational, check the PDS state
-            if (m_nmt_ok) {
-                // PDS state machine
-                err_l = m_left_controller.getPDSState(pds_state_l);
-                err_r = m_right_controller.getPDSState(pds_state_r);
+        void DiffDriveController::publishRobotState(const PoseSample &sample)
+        {
+            swd_ros_controllers::RobotState msg;
+            tf2::Quaternion                 quat_orientation;
+            quat_orientation.setRPY(0.0, 0.0, sample.theta);
+
+            msg.header.seq      = sample.seq;
+            msg.header.stamp    = sample.stamp;
+            msg.header.frame_id = m_odom_frame;
+            msg.child_frame_id  = m_base_frame;
+
+            // Same pose, twist and covariances as the odometry
+            msg.pose.pose.position.x    = sample.x;
+            msg.pose.pose.position.y    = sample.y;
+            msg.pose.pose.orientation.z = quat_orientation.getZ();
+            msg.pose.pose.orientation.w = quat_orientation.getW();
+            msg.pose.covariance[0]      = std::pow(sample.x_err, 2);
+            msg.pose.covariance[7]      = std::pow(sample.y_err, 2);
+            msg.pose.covariance[35]     = std::pow(sample.theta_err, 2);
+            msg.twist.twist.linear.x    = sample.linear;
+            msg.twist.twist.angular.z   = sample.angular;
+            msg.twist.covariance[0]     = std::pow(sample.linear_err, 2);
+            msg.twist.covariance[35]    = std::pow(sample.angular_err, 2);
+
+            msg.left_position      = sample.left_position;
+            msg.right_position     = sample.right_position;
+            msg.left_velocity      = sample.left_velocity;
+            msg.right_velocity     = sample.right_velocity;
+            msg.left_extrapolated  = sample.left_extrapolated;
+            msg.right_extrapolated = sample.right_extrapolated;
+            msg.left_setpoint_rpm  = sample.left_setpoint_rpm;
+            msg.right_setpoint_rpm = sample.right_setpoint_rpm;
+
+            // Sampled at their own rate, their age tells how old they are at the stamp of the cycle
+            msg.safety.header.stamp                       = sample.safety_stamp;
+            msg.safety.header.frame_id                    = m_base_frame;
+            msg.safety.safe_torque_off                    = sample.safe_torque_off;
+            msg.safety.safe_brake_control                 = sample.safe_brake_control;
+            msg.safety.safety_limited_speed               = sample.safety_limited_speed;
+            msg.safety.safe_direction_indication_forward  = sample.sdi_forward;
+            msg.safety.safe_direction_indication_backward = sample.sdi_backward;
+            msg.safety_age                                = sample.safety_stamp.isZero() ? -1.0 : (sample.stamp - sample.safety_stamp).toSec();
+
+            msg.left_nmt_state  = sample.left_nmt_state;
+            msg.right_nmt_state = sample.right_nmt_state;
+            msg.left_pds_state  = sample.left_pds_state;
+            msg.right_pds_state = sample.right_pds_state;
+
+            m_pub_robot_state.publish(msg);
+        }
 
-                if (ERROR_NONE != err_l) {
-                    ROS_ERROR("Failed to get the PDS state for left motor, EZW_ERR: SMCService : "
-                              "Controller::getPDSState() return error code : %d",
-                              (int)err_l);
+        ///
+        /// \brief Read the drives back, to confirm the setpoints sent are applied
+        ///
+        void DiffDriveController::checkActuation(LoadShedder::Level shed_level)
+        {
+            for (const auto &wheel : {std::make_tuple("left", m_left_controller.get(), m_left_actuation.get()),
+                                      std::make_tuple("right", m_right_controller.get(), m_right_actuation.get())}) {
+                ActuationMonitor *monitor = std::get<2>(wheel);
+                if (!monitor) {
+                    continue;
                 }
 
-                if (ERROR_NONE != err_r) {
-                    ROS_ERROR("Failed to get the PDS state for right motor, EZW_ERR: SMCService : "
-                              "Controller::getPDSState() return error code : %d",
-                              (int)err_r);
+                // Telemetry, shed under overload. The setpoints sent meanwhile are not timed, nor
+                // the velocity demand of a relative move, which follows the drive's position profile.
+                if ((shed_level >= LoadShedder::Level::SHED_TELEMETRY) || m_move_active) {
+                    monitor->reset();
+                    continue;
                 }
 
-                if (smccore::Controller::PDSState::OPERATION_ENABLED != pds_state_l) {
-                    err_l = m_left_controller.enterInOperationEnabledState();
+                int32_t     demand_rpm;
+                uint16_t    status_word;
+                ezw_error_t err = std::get<1>(wheel)->getVelocityDemand(demand_rpm);
+                if (ERROR_NONE == err) {
+                    err = std::get<1>(wheel)->getStatusWord(status_word);
                 }
 
-                if (smccore::Controller::PDSState::OPERATION_ENABLED != pds_state_r) {
-                    err_r = m_right_controller.enterInOperationEnabledState();
+                if (ERROR_NONE != err) {
+                    ROS_ERROR_THROTTLE(1.0, "Failed reading back the %s drive, EZW_ERR: %d", std::get<0>(wheel), (int)err);
+                    continue;
                 }
 
-                if (ERROR_NONE != err_l && smccore::Controller::PDSState::OPERATION_ENABLED != pds_state_l) {
-                    ROS_ERROR("Failed to set PDS state for left motor, EZW_ERR: SMCService : "
-                              "Controller::enterInOperationEnabledState() return error code : %d",
-                              (int)err_l);
+                if (monitor->readback(demand_rpm, status_word, StateStore::monotonicNs())) {
+                    ROS_WARN_THROTTLE(1.0, "The %s drive didn't apply the setpoint %d rpm within %d ms (velocity demand %d rpm, status word 0x%04X).",
+                                      std::get<0>(wheel), monitor->unconfirmedSetpoint(), m_actuation_timeout_ms, demand_rpm, status_word);
                 }
+            }
+        }
 
-                if (ERROR_NONE != err_r && smccore::Controller::PDSState::OPERATION_ENABLED != pds_state_r) {
-                    ROS_ERROR("Failed to set PDS state for right motor, EZW_ERR: SMCService : "
-                              "Controller::enterInOperationEnabledState() return error code : %d",
-                              (int)err_r);
-                }
+        void DiffDriveController::cbTimerOdom(const ros::TimerEvent &event)
+        {
+            // Another controller took over while this one was stalled
+            if (m_hot_standby && !m_state_store.isOwner()) {
+                stepDown();
+                return;
             }
 
-            m_pds_ok = (smccore::Controller::PDSState::OPERATION_ENABLED == pds_state_l) && (smccore::Controller::PDSState::OPERATION_ENABLED == pds_state_r);
+            // A set_odometry request is applied between two integration steps, never in the middle of one
+            std::lock_guard<std::mutex> lock(m_odom_mtx);
+            ScopedLatency               cycle_duration(m_loop_stats.duration);
 
-            if (!m_nmt_ok) {
-                ROS_WARN("NMT state machine is not OK.");
-            }
+            m_odom_cycles++;
 
-            if (!m_pds_ok) {
-                ROS_WARN("PDS state machine is not OK.");
-            }
-        }
+            // A control cycle misses its deadline when it starts, or when the previous one ran, later than a period
+            double period          = 1.0 / m_pub_freq_hz;
+            bool   deadline_missed = ((event.current_real - event.current_expected).toSec() > period) || (event.profile.last_duration.toSec() > period);
 
-        void DiffDriveController::cbSoftBrake(const std_msgs::Bool::ConstPtr &msg)
-        {
-            // true => Enable brake
-            // false => Release brake
-            ezw_error_t err = m_left_controller.setHalt(msg->data);
-            if (ERROR_NONE != err) {
-                ROS_ERROR("SoftBrake: Failed %s left wheel, EZW_ERR: %d", msg->data ? "braking" : "releasing", (int)err);
-            } else {
-                ROS_INFO("SoftBrake: Left motor's soft brake %s", msg->data ? "activated" : "disabled");
+            m_loop_stats.cycles.fetch_add(1, std::memory_order_relaxed);
+            m_loop_stats.lateness.record((event.current_real - event.current_expected).toNSec());
+            if (deadline_missed) {
+                m_loop_stats.missed_deadlines.fetch_add(1, std::memory_order_relaxed);
             }
 
-            err = m_right_controller.setHalt(msg->data);
-            if (ERROR_NONE != err) {
-                ROS_ERROR("SoftBrake: Failed %s right wheel, EZW_ERR: %d", msg->data ? "braking" : "releasing", (int)err);
-            } else {
-                ROS_INFO("SoftBrake: Right motor's soft brake %s", msg->data ? "activated" : "disabled");
+            if (m_overload_shedding) {
+                updateLoadShedding(deadline_missed);
             }
-        }
 
-        void DiffDriveController::cbTimerOdom()
-        {
-            nav_msgs::Odometry msg_odom;
+            LoadShedder::Level shed_level = m_load_shedder->level();
+            m_loop_stats.shed_level.store(static_cast<int>(shed_level), std::memory_order_relaxed);
+
+            if (m_drive_timeout) {
+                sendHeartbeats();
+            }
 
             int32_t     left_dist_now_mm = 0, right_dist_now_mm = 0;
             ezw_error_t err_l, err_r;
 
-            err_l = m_left_controller.getOdometryValue(left_dist_now_mm);   // In mm
-            err_r = m_right_controller.getOdometryValue(right_dist_now_mm); // In mm
+            err_l = m_left_controller->getOdometryValue(left_dist_now_mm);   // In mm
+            err_r = m_right_controller->getOdometryValue(right_dist_now_mm); // In mm
+
+            if (m_left_actuation || m_right_actuation) {
+                checkActuation(shed_level);
+            }
+
+            ros::Time timestamp = ros::Time::now();
+
+            // Use the actual elapsed time, a late tick must not be divided by the nominal period
+            double dt = (timestamp - m_odom_prev_stamp).toSec();
+            if (m_odom_prev_stamp.isZero() || dt <= 0.0) {
+                dt = 1.0 / m_pub_freq_hz;
+            }
 
+            // When a wheel can't be read, extrapolate it from its last measured speed, so the odometry
+            // keeps being published at a steady rate. The extrapolated count becomes the new reference,
+            // the next successful reading then corrects the extrapolation error.
             if (ERROR_NONE != err_l) {
                 ROS_ERROR("Failed reading from left motor, EZW_ERR: SMCService : "
                           "Controller::getOdometryValue() return error code : %d",
                           (int)err_l);
-                return;
+                left_dist_now_mm = m_dist_left_prev_mm + static_cast<int32_t>(std::round(m_left_speed_mps * dt * 1000.0));
+                m_left_missed_samples++;
             }
 
             if (ERROR_NONE != err_r) {
                 ROS_ERROR("Failed reading from right motor, EZW_ERR: SMCService : "
                           "Controller::getOdometryValue() return error code : %d",
                           (int)err_r);
-                return;
+                right_dist_now_mm = m_dist_right_prev_mm + static_cast<int32_t>(std::round(m_right_speed_mps * dt * 1000.0));
+                m_right_missed_samples++;
+            }
+
+            bool left_extrapolated  = (ERROR_NONE != err_l);
+            bool right_extrapolated = (ERROR_NONE != err_r);
+            bool degraded           = left_extrapolated || right_extrapolated;
+
+            if (degraded) {
+                m_degraded_samples++;
             }
 
             // Encoder difference between t and t-1
             double d_dist_left  = static_cast<double>(left_dist_now_mm - m_dist_left_prev_mm) / 1000.0;
             double d_dist_right = static_cast<double>(right_dist_now_mm - m_dist_right_prev_mm) / 1000.0;
 
-            // Error calculation (standard deviation)
-            double d_dist_left_err  = m_left_encoder_relative_error * std::abs(d_dist_left);
-            double d_dist_right_err = m_right_encoder_relative_error * std::abs(d_dist_right);
+            // Error calculation (standard deviation), inflated for each consecutive extrapolated sample, relatively to
+            // the displacement and by the speed change the wheel may have had since its last measured speed
+            double d_dist_left_err  = (m_left_encoder_relative_error + m_extrapolation_relative_error * m_left_missed_samples) * std::abs(d_dist_left) +
+                                      m_extrapolation_max_accel_mps2 * m_left_missed_samples * dt * dt;
+            double d_dist_right_err = (m_right_encoder_relative_error + m_extrapolation_relative_error * m_right_missed_samples) * std::abs(d_dist_right) +
+                                      m_extrapolation_max_accel_mps2 * m_right_missed_samples * dt * dt;
+
+            // Compare the achieved wheel speeds with the setpoints, an encoder read after a failure
+            // also carries the extrapolation correction and doesn't measure the speed. Halted or
+            // disabled drives don't follow their setpoints, the detection restarts from rest after. Neither do
+            // the drives running a relative move, on their own profile.
+            bool   left_slip = false, right_slip = false, yaw_slip = false;
+            double yaw_rate_error = 0.0;
+            if (m_slip_detector && (m_soft_brake || m_move_active || !m_nmt_ok || !m_pds_ok)) {
+                m_slip_detector->reset();
+            } else if (m_slip_detector) {
+                double left_cmd_mps  = m_left_setpoint_rpm / m_l_motor_reduction * M_PI * m_left_wheel_diameter_m / 60.0;
+                double right_cmd_mps = m_right_setpoint_rpm / m_r_motor_reduction * M_PI * m_right_wheel_diameter_m / 60.0;
+
+                m_slip_detector->update(left_cmd_mps, right_cmd_mps, d_dist_left / dt, d_dist_right / dt, !left_extrapolated && (0 == m_left_missed_samples),
+                                        !right_extrapolated && (0 == m_right_missed_samples), dt);
+
+                left_slip  = (SlipDetector::WheelState::OK != m_slip_detector->leftState());
+                right_slip = (SlipDetector::WheelState::OK != m_slip_detector->rightState());
+
+                // The displacement of a slipping wheel is uncertain by its speed discrepancy
+                if (left_slip) {
+                    d_dist_left_err = std::hypot(d_dist_left_err, m_slip_detector->leftError() * dt);
+                }
 
-            ros::Time timestamp = ros::Time::now();
+                if (right_slip) {
+                    d_dist_right_err = std::hypot(d_dist_right_err, m_slip_detector->rightError() * dt);
+                }
+            }
+
+            // Update the speed estimates only from two consecutive measurements,
+            // the first reading after a failure also carries the extrapolation correction
+            if (!left_extrapolated) {
+                if (0 == m_left_missed_samples) {
+                    m_left_speed_mps = d_dist_left / dt;
+                }
+                m_left_missed_samples = 0;
+            }
+
+            if (!right_extrapolated) {
+                if (0 == m_right_missed_samples) {
+                    m_right_speed_mps = d_dist_right / dt;
+                }
+                m_right_missed_samples = 0;
+            }
+
+            // Correct the wheel diameters with the calibration
+            double d_dist_left_raw  = d_dist_left;
+            double d_dist_right_raw = d_dist_right;
+            d_dist_left *= m_left_scale;
+            d_dist_right *= m_right_scale;
 
             // Kinematic model
-            double d_dist_center = (d_dist_left + d_dist_right) / 2.0;
-            double d_theta       = (d_dist_right - d_dist_left) / m_baseline_m;
+            double d_dist_center, d_theta, d_dist_center_err, d_theta_err;
+            OdometryIntegrator::kinematics(d_dist_left, d_dist_right, d_dist_left_err, d_dist_right_err, m_baseline_m, d_dist_center, d_theta, d_dist_center_err,
+                                           d_theta_err);
+
+            if (m_use_imu) {
+                double imu_d_theta, imu_dt;
+                bool   imu_fresh;
+
+                m_imu_mtx.lock();
+                imu_d_theta   = m_imu_d_theta;
+                imu_dt        = m_imu_dt;
+                imu_fresh     = !m_imu_prev_stamp.isZero() && ((timestamp - m_imu_prev_stamp).toSec() < m_imu_timeout_s);
+                m_imu_d_theta = 0.0;
+                m_imu_dt      = 0.0;
+                m_imu_mtx.unlock();
+
+                // Complementary filter on the heading, theta = a * (theta + gyro increment) + (1 - a) * wheels heading:
+                // the gyro follows the fast rotations and the wheel slips, the heading integrated from the wheels alone
+                // is the low frequency reference, which bounds the drift due to the gyro bias left after the standstill
+                // estimation. The wheels heading is kept as its offset from the fused one, a new pose restarts it.
+                // Without IMU data, the heading follows the wheels only and the offset is kept.
+                if (imu_fresh && (imu_dt > 0.0)) {
+                    double imu_d_theta_err = m_imu_yaw_rate_stddev * imu_dt;
+
+                    // The base skids when the wheels and the gyro disagree, the travelled distance is then uncertain too
+                    if (m_slip_detector && m_slip_detector->checkYawRate(d_theta / dt, imu_d_theta / imu_dt)) {
+                        yaw_slip          = true;
+                        yaw_rate_error    = d_theta / dt - imu_d_theta / imu_dt;
+                        d_dist_center_err = std::hypot(d_dist_center_err, yaw_rate_error * dt * m_baseline_m / 2.0);
+                    }
+
+                    double wheels_d_theta = d_theta;
+                    d_theta               = m_imu_gyro_weight * imu_d_theta + (1.0 - m_imu_gyro_weight) * (m_wheels_heading_offset + wheels_d_theta);
+                    d_theta_err           = std::sqrt(std::pow(m_imu_gyro_weight * imu_d_theta_err, 2) + std::pow((1.0 - m_imu_gyro_weight) * d_theta_err, 2));
+                    m_wheels_heading_offset += wheels_d_theta - d_theta;
+
+                    // Extrapolated or slipping wheels would bias the calibration
+                    if (m_calibrator && !degraded && !left_slip && !right_slip && !yaw_slip) {
+                        calibrate(d_dist_left_raw, d_dist_right_raw, imu_d_theta, timestamp);
+                    }
+                } else {
+                    ROS_WARN_THROTTLE(1.0, "No IMU data for %f s, heading computed from the wheels only.", m_imu_timeout_s);
+
+                    if (m_calibrator) {
+                        m_calibrator->discard();
+                    }
+                }
+
+                m_robot_still = (0 == left_dist_now_mm - m_dist_left_prev_mm) && (0 == right_dist_now_mm - m_dist_right_prev_mm) && (0 == m_left_setpoint_rpm) && (0 == m_right_setpoint_rpm);
+            }
 
-            // Error propagation (See https://en.wikipedia.org/wiki/Propagation_of_uncertainty#Non-linear_combinations)
-            double d_dist_center_err = std::sqrt(std::pow(d_dist_left_err / 2.0, 2) + std::pow(d_dist_right_err / 2.0, 2));
-            double d_theta_err       = std::sqrt(std::pow(d_dist_left_err / m_baseline_m, 2) + std::pow(d_dist_right_err / m_baseline_m, 2));
+            bool slip = left_slip || right_slip || yaw_slip;
 
-            // Odometry model, integration of the diff drive kinematic model
-            double x_now     = m_x_prev + d_dist_center * std::cos(m_theta_prev);
-            double y_now     = m_y_prev + d_dist_center * std::sin(m_theta_prev);
-            double theta_now = M_BOUND_ANGLE(m_theta_prev + d_theta);
+            if (slip) {
+                m_slip_samples++;
+            }
 
-            // Error propagation
-            double x_now_err     = std::sqrt(std::pow(m_x_prev_err, 2) + std::pow(std::cos(m_theta_prev) * d_dist_center_err, 2) + std::pow(-std::sin(m_theta_prev) * d_dist_center * m_theta_prev_err, 2));
-            double y_now_err     = std::sqrt(std::pow(m_y_prev_err, 2) + std::pow(std::sin(m_theta_prev) * d_dist_center_err, 2) + std::pow(std::cos(m_theta_prev) * d_dist_center * m_theta_prev_err, 2));
-            double theta_now_err = std::sqrt(std::pow(m_theta_prev_err, 2) + std::pow(d_theta_err, 2));
+            if (m_slip_detector) {
+                publishWheelSlip(timestamp, yaw_slip, yaw_rate_error);
+            }
 
-            msg_odom.header.stamp    = timestamp;
-            msg_odom.header.frame_id = m_odom_frame;
-            msg_odom.child_frame_id  = m_base_frame;
+            // Odometry model, integration of the diff drive kinematic model. The error propagation is part of the
+            // integrated state, so it is kept up to date even when nothing consumes it
+            OdometryPose prev;
+            prev.x         = m_x_prev;
+            prev.y         = m_y_prev;
+            prev.theta     = m_theta_prev;
+            prev.x_err     = m_x_prev_err;
+            prev.y_err     = m_y_prev_err;
+            prev.theta_err = m_theta_prev_err;
+
+            OdometryPose now = m_integrator.step(prev, d_dist_center, d_theta, d_dist_center_err, d_theta_err);
+
+            // Handed over to the publication thread, the control loop never waits for the subscribers
+            if (m_publish_odom || m_publish_tf || m_publish_robot_state) {
+                PoseSample sample;
+                sample.stamp              = timestamp;
+                sample.seq                = m_odom_seq;
+                sample.x                  = now.x;
+                sample.y                  = now.y;
+                sample.theta              = now.theta;
+                sample.x_err              = now.x_err;
+                sample.y_err              = now.y_err;
+                sample.theta_err          = now.theta_err;
+                sample.linear             = d_dist_center / dt;
+                sample.angular            = d_theta / dt;
+                sample.linear_err         = d_dist_center_err / dt;
+                sample.angular_err        = d_theta_err / dt;
+                sample.tf_due             = (shed_level < LoadShedder::Level::SHED_TF) || (0 == m_odom_cycles % OVERLOAD_TF_DECIMATION);
+                sample.status_due         = (shed_level < LoadShedder::Level::SHED_TELEMETRY) || degraded || slip;
+                sample.degraded           = degraded;
+                sample.left_extrapolated  = left_extrapolated;
+                sample.right_extrapolated = right_extrapolated;
+                sample.slip               = slip;
+                sample.degraded_samples   = m_degraded_samples;
+                sample.slip_samples       = m_slip_samples;
+                sample.state_due          = m_publish_robot_state;
+
+                if (m_publish_robot_state) {
+                    sample.left_position      = left_dist_now_mm / 1000.0;
+                    sample.right_position     = right_dist_now_mm / 1000.0;
+                    sample.left_velocity      = d_dist_left_raw / dt;
+                    sample.right_velocity     = d_dist_right_raw / dt;
+                    sample.left_setpoint_rpm  = m_left_setpoint_rpm;
+                    sample.right_setpoint_rpm = m_right_setpoint_rpm;
+                    sample.left_nmt_state     = static_cast<int8_t>(m_left_stats.nmt_state.load(std::memory_order_relaxed));
+                    sample.right_nmt_state    = static_cast<int8_t>(m_right_stats.nmt_state.load(std::memory_order_relaxed));
+                    sample.left_pds_state     = static_cast<int8_t>(m_left_stats.pds_state.load(std::memory_order_relaxed));
+                    sample.right_pds_state    = static_cast<int8_t>(m_right_stats.pds_state.load(std::memory_order_relaxed));
+
+                    std::lock_guard<std::mutex> safety_lock(m_safety_msg_mtx);
+                    sample.safe_torque_off      = m_safety_msg.safe_torque_off;
+                    sample.safe_brake_control   = m_safety_msg.safe_brake_control;
+                    sample.safety_limited_speed = m_safety_msg.safety_limited_speed;
+                    sample.sdi_forward          = m_safety_msg.safe_direction_indication_forward;
+                    sample.sdi_backward         = m_safety_msg.safe_direction_indication_backward;
+                    sample.safety_stamp         = m_safety_msg.header.stamp;
+                }
 
-            msg_odom.twist                 = geometry_msgs::TwistWithCovariance();
-            msg_odom.twist.twist.linear.x  = d_dist_center * m_pub_freq_hz;
-            msg_odom.twist.twist.angular.z = d_theta * m_pub_freq_hz;
+                if (m_pose_samples.push(sample)) {
+                    // Only taken to not miss the wake up of the publication thread about to wait
+                    { std::lock_guard<std::mutex> lock(m_publication_mtx); }
+                    m_publication_cv.notify_one();
+                } else {
+                    m_loop_stats.publication_drops.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
 
-            // Set uncertainties for linear and angular velocities (6 * 6) matrix (x y z Rx Ry Rz)
-            msg_odom.twist.covariance[0]  = std::pow(d_dist_center_err * m_pub_freq_hz, 2);
-            msg_odom.twist.covariance[35] = std::pow(d_theta_err * m_pub_freq_hz, 2);
+            m_odom_seq++;
 
-            msg_odom.pose.pose.position.x = x_now;
-            msg_odom.pose.pose.position.y = y_now;
-            msg_odom.pose.pose.position.z = 0.0;
+            m_x_prev             = now.x;
+            m_y_prev             = now.y;
+            m_theta_prev         = now.theta;
+            m_x_prev_err         = now.x_err;
+            m_y_prev_err         = now.y_err;
+            m_theta_prev_err     = now.theta_err;
+            m_dist_left_prev_mm  = left_dist_now_mm;
+            m_dist_right_prev_mm = right_dist_now_mm;
+            m_odom_prev_stamp    = timestamp;
 
-            tf2::Quaternion quat_orientation;
-            quat_orientation.setRPY(0.0, 0.0, theta_now);
-            msg_odom.pose.pose.orientation.x = quat_orientation.getX();
-            msg_odom.pose.pose.orientation.y = quat_orientation.getY();
-            msg_odom.pose.pose.orientation.z = quat_orientation.getZ();
-            msg_odom.pose.pose.orientation.w = quat_orientation.getW();
+            publishState(timestamp);
+        }
 
-            // Set uncertainties for x, y, and theta (Rz)
-            msg_odom.pose.covariance[0]  = std::pow(x_now_err, 2);
-            msg_odom.pose.covariance[7]  = std::pow(y_now_err, 2);
-            msg_odom.pose.covariance[35] = std::pow(theta_now_err, 2);
+        ///
+        /// \brief Arbitrate a command, and record its source when it is executed
+        ///
+        bool DiffDriveController::acceptCommand(size_t source)
+        {
+            m_command_stats.received.fetch_add(1, std::memory_order_relaxed);
 
-            if (m_publish_odom) {
-                m_pub_odom.publish(msg_odom);
+            // The standby controller never drives the wheels
+            if (!m_active) {
+                m_command_stats.suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
             }
 
-            if (m_publish_tf) {
-                geometry_msgs::TransformStamped tf_odom_baselink;
-                tf_odom_baselink.header.stamp    = timestamp;
-                tf_odom_baselink.header.frame_id = m_odom_frame;
-                tf_odom_baselink.child_frame_id  = m_base_frame;
+            // The drives execute a relative move, it has to be canceled first
+            if (m_move_active) {
+                m_command_stats.overridden.fetch_add(1, std::memory_order_relaxed);
+                ROS_WARN_THROTTLE(1.0, "Velocity command ignored during a relative move.");
+                return false;
+            }
 
-                tf_odom_baselink.transform.translation.x = msg_odom.pose.pose.position.x;
-                tf_odom_baselink.transform.translation.y = msg_odom.pose.pose.position.y;
-                tf_odom_baselink.transform.translation.z = msg_odom.pose.pose.position.z;
-                tf_odom_baselink.transform.rotation.x    = msg_odom.pose.pose.orientation.x;
-                tf_odom_baselink.transform.rotation.y    = msg_odom.pose.pose.orientation.y;
-                tf_odom_baselink.transform.rotation.z    = msg_odom.pose.pose.orientation.z;
-                tf_odom_baselink.transform.rotation.w    = msg_odom.pose.pose.orientation.w;
+            // Another source has the priority, or a lock is engaged
+            if (!m_command_mux.arbitrate(source, static_cast<int64_t>(ros::Time::now().toNSec()))) {
+                m_command_stats.overridden.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
 
-                // Send TF
-                m_tf2_br.sendTransform(tf_odom_baselink);
+            if (static_cast<int>(source) != m_command_source.exchange(static_cast<int>(source))) {
+                std_msgs::String msg;
+                msg.data = m_command_mux.sourceName(source);
+                m_pub_command_source.publish(msg);
             }
 
-            m_x_prev             = x_now;
-            m_y_prev             = y_now;
-            m_theta_prev         = theta_now;
-            m_x_prev_err         = x_now_err;
-            m_y_prev_err         = y_now_err;
-            m_theta_prev_err     = theta_now_err;
-            m_dist_left_prev_mm  = left_dist_now_mm;
-            m_dist_right_prev_mm = right_dist_now_mm;
+            return true;
+        }
+
+        void DiffDriveController::cbCommandLock(const std_msgs::Bool::ConstPtr &msg, size_t lock)
+        {
+            m_command_mux.setLock(lock, msg->data, static_cast<int64_t>(ros::Time::now().toNSec()));
         }
 
         ///
         /// \brief Change wheel speed (msg.x = left wheel, msg.y = right wheel) [rad/s]
         ///
-        void DiffDriveController::cbSetSpeed(const geometry_msgs::PointConstPtr &speed)
+        void DiffDriveController::cbSetSpeed(const geometry_msgs::PointConstPtr &speed, size_t source)
         {
+            if (!acceptCommand(source)) {
+                return;
+            }
+
             m_timer_watchdog.stop();
             m_timer_watchdog.start();
 
@@ -532,16 +2519,20 @@ namespace ezw
         ///
         /// \brief Change robot velocity (linear [m/s], angular [rad/s])
         ///
-        void DiffDriveController::cbCmdVel(const geometry_msgs::TwistPtr &cmd_vel)
+        void DiffDriveController::cbCmdVel(const geometry_msgs::TwistConstPtr &cmd_vel, size_t source)
         {
+            if (!acceptCommand(source)) {
+                return;
+            }
+
             m_timer_watchdog.stop();
             m_timer_watchdog.start();
 
             double left_vel, right_vel;
 
             // Control model (diff drive)
-            left_vel  = (2. * cmd_vel->linear.x - cmd_vel->angular.z * m_baseline_m) / m_left_wheel_diameter_m;
-            right_vel = (2. * cmd_vel->linear.x + cmd_vel->angular.z * m_baseline_m) / m_right_wheel_diameter_m;
+            left_vel  = (2. * cmd_vel->linear.x - cmd_vel->angular.z * m_baseline_m) / (m_left_wheel_diameter_m * m_left_scale);
+            right_vel = (2. * cmd_vel->linear.x + cmd_vel->angular.z * m_baseline_m) / (m_right_wheel_diameter_m * m_right_scale);
 
             // Convert rad/s wheel speed to rpm motor speed
             int32_t left  = static_cast<int32_t>(left_vel * m_l_motor_reduction * 60.0 / (2.0 * M_PI));
@@ -610,29 +2601,50 @@ namespace ezw
                     right_speed = M_SIGN(right_speed) * speed_limit;
                 }
 
+                m_command_stats.limited.fetch_add(1, std::memory_order_relaxed);
+
                 ROS_WARN("The target speed exceeds the maximum speed limit (%d rpm). "
                          "Speed set to (left, right) (%d, %d) rpm",
                          speed_limit, left_speed, right_speed);
             }
 
             // Send the actual speed (in RPM) to left motor
-            ezw_error_t err = m_left_controller.setTargetVelocity(left_speed);
+            ezw_error_t err = m_left_controller->setTargetVelocity(left_speed);
             if (ERROR_NONE != err) {
                 ROS_ERROR("Failed setting velocity of right motor, EZW_ERR: SMCService : "
                           "Controller::setTargetVelocity() return error code : %d",
                           (int)err);
+                m_command_stats.failed.fetch_add(1, std::memory_order_relaxed);
                 return;
             }
 
             // Send the actual speed (in RPM) to left motor
-            err = m_right_controller.setTargetVelocity(right_speed);
+            err = m_right_controller->setTargetVelocity(right_speed);
             if (ERROR_NONE != err) {
                 ROS_ERROR("Failed setting velocity of right motor, EZW_ERR: SMCService : "
                           "Controller::setTargetVelocity() return error code : %d",
                           (int)err);
+                m_command_stats.failed.fetch_add(1, std::memory_order_relaxed);
                 return;
             }
 
+            m_left_setpoint_rpm  = left_speed;
+            m_right_setpoint_rpm = right_speed;
+
+            if (m_left_actuation) {
+                m_left_actuation->command(left_speed, StateStore::monotonicNs());
+            }
+
+            if (m_right_actuation) {
+                m_right_actuation->command(right_speed, StateStore::monotonicNs());
+            }
+
+            // First setpoint sent under the limits of a new safety state
+            int64_t edge_ns = m_safety_stats.pending_edge_ns.exchange(0, std::memory_order_relaxed);
+            if (0 != edge_ns) {
+                m_safety_stats.reaction.record(StateStore::monotonicNs() - edge_ns);
+            }
+
 #if VERBOSE_OUTPUT
             ROS_INFO("Speed sent to motors (left, right) = (%d, %d) rpm", left_speed, right_speed);
 #endif
@@ -641,13 +2653,12 @@ namespace ezw
         void DiffDriveController::cbTimerSafety()
         {
             swd_ros_controllers::SafetyFunctions msg;
-            ezw_error_t                          err;
             bool                                 res_l, res_r;
 
 #if USE_SAFETY_CONTROL_WORD
             ezw::smccore::Controller::SafetyWordType res;
 
-            err = m_left_controller.getSafetyControlWord(ezw::smccore::Controller::SafetyControlWordId::SAFEIN_1, res);
+            ezw_error_t err = m_left_controller->getSafetyControlWord(ezw::smccore::Controller::SafetyControlWordId::SAFEIN_1, res);
 
             msg.safe_torque_off                   = res.safety_function_2 && res.safety_function_3;
             msg.safe_direction_indication_forward = res.safety_function_2 && res.safety_function_3;
@@ -663,104 +2674,74 @@ namespace ezw
                 msg.header.stamp    = ros::Time::now();
                 msg.header.frame_id = m_base_frame;
 
-                // Reading SBC
-                err = m_left_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::SBC_1, res_l);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading SBC from left motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
-
-                err = m_right_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::SBC_1, res_r);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading SBC from right motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
+                // Nothing consumes the safety functions, only the SLS signal that limits the setpoints is needed,
+                // and not even that one when the SLS isn't below the maximum speed
+                bool consumed = (m_pub_safety.getNumSubscribers() > 0) || (m_pub_robot_state.getNumSubscribers() > 0) || (m_pub_diagnostics.getNumSubscribers() > 0) || m_metrics_server;
+                if (!consumed && (m_motor_sls_rpm >= m_max_motor_speed_rpm)) {
+                    return;
                 }
 
-                msg.safe_brake_control = !(res_l || res_r);
+                // Under overload, the SLS is still polled at the nominal rate, the rest is decimated
+                bool shed = (m_loop_stats.shed_level.load(std::memory_order_relaxed) >= static_cast<int>(LoadShedder::Level::SHED_SAFETY_RATE));
+                consumed  = consumed && (!shed || (0 == m_safety_cycles++ % SAFETY_SHED_DECIMATION));
 
-                if (res_l != res_r) {
-                    ROS_ERROR("Inconsistant SBC for left and right motors, left=%d, right=%d.", res_l, res_r);
-                }
+                if (consumed) {
+                    // Reading SBC
+                    readSafetyFunction(ezw::smccore::Controller::SafetyFunctionId::SBC_1, "SBC", res_l, res_r);
 
-                // Reading STO
-                err = m_left_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::STO, res_l);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading STO from left motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
+                    msg.safe_brake_control = !(res_l || res_r);
 
-                err = m_right_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::STO, res_r);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading STO from right motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
+                    if (res_l != res_r) {
+                        ROS_ERROR("Inconsistant SBC for left and right motors, left=%d, right=%d.", res_l, res_r);
+                        m_safety_stats.sbc_inconsistencies.fetch_add(1, std::memory_order_relaxed);
+                    }
 
-                msg.safe_torque_off = !(res_l || res_r);
+                    // Reading STO
+                    readSafetyFunction(ezw::smccore::Controller::SafetyFunctionId::STO, "STO", res_l, res_r);
 
-                if (res_l != res_r) {
-                    ROS_ERROR("Inconsistant STO for left and right motors, left=%d, right=%d.", res_l, res_r);
-                }
+                    msg.safe_torque_off = !(res_l || res_r);
 
-                // Reading SDI
-                bool sdi_l_p, sdi_l_n, sdi_r_p, sdi_r_n, sdi_p, sdi_n;
+                    if (res_l != res_r) {
+                        ROS_ERROR("Inconsistant STO for left and right motors, left=%d, right=%d.", res_l, res_r);
+                        m_safety_stats.sto_inconsistencies.fetch_add(1, std::memory_order_relaxed);
+                    }
 
-                err = m_left_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::SDIP_1, sdi_l_p);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading SDI+ from left motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
+                    // Reading SDI
+                    bool sdi_l_p, sdi_l_n, sdi_r_p, sdi_r_n, sdi_p, sdi_n;
 
-                err = m_left_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::SDIN_1, sdi_l_n);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading SDI- from left motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
+                    readSafetyFunction(ezw::smccore::Controller::SafetyFunctionId::SDIP_1, "SDI+", sdi_l_p, sdi_r_p);
+                    readSafetyFunction(ezw::smccore::Controller::SafetyFunctionId::SDIN_1, "SDI-", sdi_l_n, sdi_r_n);
 
-                err = m_right_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::SDIP_1, sdi_r_p);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading SDI+ from right motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
+                    // The wheels are mounted in opposite directions, a wheel read alone stands for both
+                    if (!m_right_safety) {
+                        sdi_r_p = sdi_l_n;
+                        sdi_r_n = sdi_l_p;
+                    } else if (!m_left_safety) {
+                        sdi_l_p = sdi_r_n;
+                        sdi_l_n = sdi_r_p;
+                    }
 
-                err = m_right_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::SDIN_1, sdi_r_n);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading SDI- from right motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
+                    if (m_left_wheel_polarity == 1) {
+                        sdi_p = !(sdi_l_p || sdi_r_n);
+                        sdi_n = !(sdi_l_n || sdi_r_p);
+                    } else {
+                        sdi_p = !(sdi_l_n || sdi_r_p);
+                        sdi_n = !(sdi_l_p || sdi_r_n);
+                    }
 
-                if (m_left_wheel_polarity == 1) {
-                    sdi_p = !(sdi_l_p || sdi_r_n);
-                    sdi_n = !(sdi_l_n || sdi_r_p);
+                    msg.safe_direction_indication_forward  = sdi_p;
+                    msg.safe_direction_indication_backward = sdi_n;
                 } else {
-                    sdi_p = !(sdi_l_n || sdi_r_p);
-                    sdi_n = !(sdi_l_p || sdi_r_n);
+                    // Keep the last known state of the functions that are not read
+                    std::lock_guard<std::mutex> lock(m_safety_msg_mtx);
+                    msg.safe_brake_control                 = m_safety_msg.safe_brake_control;
+                    msg.safe_torque_off                    = m_safety_msg.safe_torque_off;
+                    msg.safe_direction_indication_forward  = m_safety_msg.safe_direction_indication_forward;
+                    msg.safe_direction_indication_backward = m_safety_msg.safe_direction_indication_backward;
                 }
 
-                msg.safe_direction_indication_forward  = sdi_p;
-                msg.safe_direction_indication_backward = sdi_n;
-
                 // Reading SLS
-                err = m_left_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::SLS_1, res_l);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading SLS from left motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
-
-                err = m_right_controller.getSafetyFunctionCommand(ezw::smccore::Controller::SafetyFunctionId::SLS_1, res_r);
-                if (ERROR_NONE != err) {
-                    ROS_ERROR("Error reading SLS from right motor, EZW_ERR: SMCService : "
-                              "Controller::getSafetyFunctionCommand() return error code : %d",
-                              (int)err);
-                }
+                readSafetyFunction(ezw::smccore::Controller::SafetyFunctionId::SLS_1, "SLS", res_l, res_r);
 
                 msg.safety_limited_speed = !(res_r || res_l);
 
@@ -769,22 +2750,273 @@ namespace ezw
 #endif
 
                 m_safety_msg_mtx.lock();
+                bool edge = (msg.safe_torque_off != m_safety_msg.safe_torque_off) || (msg.safe_brake_control != m_safety_msg.safe_brake_control) ||
+                            (msg.safety_limited_speed != m_safety_msg.safety_limited_speed) || (msg.safe_direction_indication_forward != m_safety_msg.safe_direction_indication_forward) ||
+                            (msg.safe_direction_indication_backward != m_safety_msg.safe_direction_indication_backward);
                 m_safety_msg = msg;
                 m_safety_msg_mtx.unlock();
 
-                m_pub_safety.publish(msg);
+                if (edge) {
+                    m_safety_stats.edges.fetch_add(1, std::memory_order_relaxed);
+                    m_safety_stats.pending_edge_ns.store(StateStore::monotonicNs(), std::memory_order_relaxed);
+                }
+
+                if (consumed) {
+                    m_pub_safety.publish(msg);
+                }
             } else {
                 ROS_WARN("NMT state machine is not OK, no valid SafetyFunctions message to publish");
             }
 #endif
         }
 
+        void DiffDriveController::readSafetyFunction(ezw::smccore::Controller::SafetyFunctionId id, const char *name, bool &res_l, bool &res_r)
+        {
+            for (const auto &wheel : {std::make_tuple("left", m_left_controller.get(), m_left_safety, &res_l),
+                                      std::make_tuple("right", m_right_controller.get(), m_right_safety, &res_r)}) {
+                if (!std::get<2>(wheel)) {
+                    continue;
+                }
+
+                ezw_error_t err = std::get<1>(wheel)->getSafetyFunctionCommand(id, *std::get<3>(wheel));
+                if (ERROR_NONE != err) {
+                    ROS_ERROR("Error reading %s from %s motor, EZW_ERR: SMCService : "
+                              "Controller::getSafetyFunctionCommand() return error code : %d",
+                              name, std::get<0>(wheel), (int)err);
+                }
+            }
+
+            // A wheel whose safety functions can't be read reports the other wheel's ones
+            if (!m_left_safety) {
+                res_l = res_r;
+            } else if (!m_right_safety) {
+                res_r = res_l;
+            }
+        }
+
+        void DiffDriveController::cbMoveGoal()
+        {
+            swd_ros_controllers::RelativeMoveGoalConstPtr goal = m_move_server->acceptNewGoal();
+
+            // A new goal replaces the running move, from where the wheels are
+            if (m_move_active) {
+                stopMove();
+            }
+
+            std::string error;
+            if (!startMove(*goal, error)) {
+                ROS_ERROR("Relative move rejected: %s", error.c_str());
+                swd_ros_controllers::RelativeMoveResult result;
+                result.message = error;
+                m_move_server->setAborted(result, error);
+            }
+        }
+
+        void DiffDriveController::cbMovePreempt()
+        {
+            if (!m_move_active) {
+                return;
+            }
+
+            swd_ros_controllers::RelativeMoveResult result = moveResult("Canceled");
+            stopMove();
+            m_move_server->setPreempted(result, result.message);
+        }
+
+        ///
+        /// \brief Start a relative move in the drives' profile position mode
+        ///
+        bool DiffDriveController::startMove(const swd_ros_controllers::RelativeMoveGoal &goal, std::string &error)
+        {
+            if (!m_active) {
+                error = "The controller doesn't drive the wheels (hot standby)";
+                return false;
+            }
+
+            if (!m_nmt_ok || !m_pds_ok) {
+                error = "The drives are not operational";
+                return false;
+            }
+
+            // Wheel travels along the arc, corrected by the calibrated scales like the velocity commands
+            double  left_m   = goal.distance - goal.rotation * m_baseline_m / 2.0;
+            double  right_m  = goal.distance + goal.rotation * m_baseline_m / 2.0;
+            int32_t left_mm  = static_cast<int32_t>(std::lround(left_m * 1000.0 / m_left_scale));
+            int32_t right_mm = static_cast<int32_t>(std::lround(right_m * 1000.0 / m_right_scale));
+
+            if ((0 == left_mm) && (0 == right_mm)) {
+                error = "Null move";
+                return false;
+            }
+
+            // The wheel with the longest travel runs at the requested speed and acceleration, the other one's profile
+            // is scaled by the ratio of their travels so that both finish together
+            double speed_mps         = (goal.max_speed > 0.) ? goal.max_speed : m_move_speed_mps;
+            double longest_m         = M_MAX(std::abs(left_m), std::abs(right_m));
+            double left_rpm_per_mps  = std::abs(left_m) / longest_m * 60.0 * m_l_motor_reduction / (M_PI * m_left_wheel_diameter_m * m_left_scale);
+            double right_rpm_per_mps = std::abs(right_m) / longest_m * 60.0 * m_r_motor_reduction / (M_PI * m_right_wheel_diameter_m * m_right_scale);
+
+            // Same limits as the velocity commands
+            m_safety_msg_mtx.lock();
+            bool sls_signal = m_safety_msg.safety_limited_speed;
+            m_safety_msg_mtx.unlock();
+
+            double speed_limit = m_max_motor_speed_rpm;
+            if (sls_signal || (!m_have_backward_sls && (left_m < 0.) && (right_m < 0.))) {
+                speed_limit = M_MIN(speed_limit, m_motor_sls_rpm);
+            }
+
+            double faster_rpm = speed_mps * M_MAX(left_rpm_per_mps, right_rpm_per_mps);
+            if (faster_rpm > speed_limit) {
+                speed_mps *= speed_limit / faster_rpm;
+                m_command_stats.limited.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Trapezoidal profile of the longest travel, or triangular when it is too short to reach the speed
+            double accel_mps2 = m_move_acceleration_mps2;
+            double duration_s = (longest_m > speed_mps * speed_mps / accel_mps2) ? (longest_m / speed_mps + speed_mps / accel_mps2) : (2.0 * std::sqrt(longest_m / accel_mps2));
+
+            int32_t left_start_mm, right_start_mm;
+            if ((ERROR_NONE != m_left_controller->getOdometryValue(left_start_mm)) || (ERROR_NONE != m_right_controller->getOdometryValue(right_start_mm))) {
+                error = "Failed reading the encoders";
+                return false;
+            }
+
+            // The watchdog would stop the wheels in velocity mode
+            m_timer_watchdog.stop();
+
+            bool ok = true;
+            for (const auto &wheel : {std::make_tuple(m_left_controller.get(), left_rpm_per_mps, left_mm), std::make_tuple(m_right_controller.get(), right_rpm_per_mps, right_mm)}) {
+                DriveInterface *drive        = std::get<0>(wheel);
+                uint32_t        velocity     = static_cast<uint32_t>(M_MAX(1.0, std::round(speed_mps * std::get<1>(wheel))));
+                uint32_t        acceleration = static_cast<uint32_t>(M_MAX(1.0, std::round(accel_mps2 * std::get<1>(wheel))));
+
+                ok = ok && (ERROR_NONE == drive->setOperationMode(DriveInterface::OperationMode::PROFILE_POSITION)) &&
+                     (ERROR_NONE == drive->setProfile(velocity, acceleration, acceleration)) && (ERROR_NONE == drive->startRelativeMove(std::get<2>(wheel)));
+            }
+
+            if (!ok) {
+                stopMove();
+                error = "The drives rejected the profile position move";
+                return false;
+            }
+
+            m_move_active          = true;
+            m_move.left_start_mm   = left_start_mm;
+            m_move.right_start_mm  = right_start_mm;
+            m_move.left_target_mm  = left_mm;
+            m_move.right_target_mm = right_mm;
+            m_move.left_travel_mm  = 0;
+            m_move.right_travel_mm = 0;
+            m_move.left_started    = false;
+            m_move.right_started   = false;
+            m_move.deadline        = ros::Time::now() + ros::Duration(duration_s * MOVE_TIMEOUT_FACTOR + MOVE_TIMEOUT_MARGIN_S);
+            m_timer_move.start();
+
+            ROS_INFO("Relative move of (%d, %d) mm started, planned in %f s.", left_mm, right_mm, duration_s);
+            return true;
+        }
+
+        ///
+        /// \brief Put the drives back in velocity mode, stopped
+        ///
+        void DiffDriveController::stopMove()
+        {
+            m_move_active = false;
+            m_timer_move.stop();
+
+            applyVelocityMode();
+
+            setSpeeds(0, 0);
+            m_timer_watchdog.start();
+        }
+
+        swd_ros_controllers::RelativeMoveResult DiffDriveController::moveResult(const std::string &message) const
+        {
+            swd_ros_controllers::RelativeMoveResult result;
+            result.success      = false;
+            result.message      = message;
+            result.left_travel  = m_move.left_travel_mm * m_left_scale / 1000.0;
+            result.right_travel = m_move.right_travel_mm * m_right_scale / 1000.0;
+            return result;
+        }
+
+        ///
+        /// \brief Supervise the running relative move, its completion is reported by the drives
+        ///
+        void DiffDriveController::cbTimerMove()
+        {
+            if (!m_move_active) {
+                return;
+            }
+
+            int32_t left_mm, right_mm;
+            if ((ERROR_NONE == m_left_controller->getOdometryValue(left_mm)) && (ERROR_NONE == m_right_controller->getOdometryValue(right_mm))) {
+                m_move.left_travel_mm  = left_mm - m_move.left_start_mm;
+                m_move.right_travel_mm = right_mm - m_move.right_start_mm;
+            }
+
+            uint16_t sw_l, sw_r;
+            if ((ERROR_NONE != m_left_controller->getStatusWord(sw_l)) || (ERROR_NONE != m_right_controller->getStatusWord(sw_r))) {
+                ROS_ERROR_THROTTLE(1.0, "Failed reading the drives' status words during a relative move.");
+                sw_l = sw_r = 0;
+            } else if (!ActuationMonitor::operationEnabled(sw_l) || !ActuationMonitor::operationEnabled(sw_r)) {
+                swd_ros_controllers::RelativeMoveResult result = moveResult("The drives left the operation enabled state");
+                stopMove();
+                m_move_server->setAborted(result, result.message);
+                return;
+            }
+
+            // The target reached bit is cleared when a wheel starts its move, a short move may complete between two readings
+            bool left_reached  = (0 != (sw_l & STATUS_WORD_TARGET_REACHED));
+            bool right_reached = (0 != (sw_r & STATUS_WORD_TARGET_REACHED));
+            m_move.left_started |= !left_reached;
+            m_move.right_started |= !right_reached;
+
+            int32_t left_remaining_mm  = m_move.left_target_mm - m_move.left_travel_mm;
+            int32_t right_remaining_mm = m_move.right_target_mm - m_move.right_travel_mm;
+            bool    left_done          = (0 == m_move.left_target_mm) || (left_reached && (m_move.left_started || (std::abs(left_remaining_mm) <= MOVE_POSITION_TOLERANCE_MM)));
+            bool    right_done         = (0 == m_move.right_target_mm) || (right_reached && (m_move.right_started || (std::abs(right_remaining_mm) <= MOVE_POSITION_TOLERANCE_MM)));
+
+            if (left_done && right_done) {
+                swd_ros_controllers::RelativeMoveResult result = moveResult("Target reached");
+                result.success                                 = true;
+                stopMove();
+                ROS_INFO("Relative move completed, travel (%f, %f) m.", result.left_travel, result.right_travel);
+                m_move_server->setSucceeded(result, result.message);
+                return;
+            }
+
+            if (ros::Time::now() > m_move.deadline) {
+                swd_ros_controllers::RelativeMoveResult result = moveResult("Timeout, the target wasn't reached");
+                stopMove();
+                ROS_ERROR("Relative move timed out, travel (%f, %f) m.", result.left_travel, result.right_travel);
+                m_move_server->setAborted(result, result.message);
+                return;
+            }
+
+            swd_ros_controllers::RelativeMoveFeedback feedback;
+            feedback.left_remaining  = left_remaining_mm * m_left_scale / 1000.0;
+            feedback.right_remaining = right_remaining_mm * m_right_scale / 1000.0;
+            m_move_server->publishFeedback(feedback);
+        }
+
         ///
         /// \brief Callback qui s'active si aucun message de déplacement n'est reçu
         /// depuis m_watchdog_receive_ms
         ///
         void DiffDriveController::cbWatchdog()
         {
+            // The drives are in profile position mode, the move is supervised on its own
+            if (m_move_active) {
+                return;
+            }
+
+            // The last command went stale while the wheels were moving
+            if ((0 != m_left_setpoint_rpm) || (0 != m_right_setpoint_rpm)) {
+                m_command_stats.timeouts.fetch_add(1, std::memory_order_relaxed);
+            }
+
             setSpeeds(0, 0);
         }
     } // namespace swd
@@ -0,0 +1,427 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file DriveCharacterisation.cpp
+ */
+
+#include "diff_drive_controller/DriveCharacterisation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <ctime>
+#include <fstream>
+#include <limits>
+
+// Zero setpoint before the step and after the chirp
+#define PREROLL_S 0.5
+
+// The chirp is analysed by segments of two periods
+#define CHIRP_SEGMENT_RAD   (4.0 * M_PI)
+#define MIN_SEGMENT_SAMPLES 16
+
+// The steady state speed of the step is measured on the end of the step
+#define STEP_STEADY_RATIO 0.4
+
+// Step fit search ranges
+#define MAX_DEAD_TIME_S   0.5
+#define MIN_TIME_CONST_S  0.001
+#define TIME_CONST_POINTS 60
+
+namespace ezw
+{
+    namespace swd
+    {
+        namespace
+        {
+            // Position response of a first order plus dead time system to a unit speed step, s after the step
+            double stepPosition(double s, double dead_time_s, double time_constant_s)
+            {
+                if (s <= dead_time_s) {
+                    return 0.0;
+                }
+
+                double r = s - dead_time_s;
+                return r - time_constant_s * (1.0 - std::exp(-r / time_constant_s));
+            }
+
+            // Gaussian elimination with partial pivoting of a 4x4 system
+            bool solve4(double a[4][4], double b[4], double x[4])
+            {
+                double m[4][5];
+                for (int i = 0; i < 4; i++) {
+                    for (int j = 0; j < 4; j++) {
+                        m[i][j] = a[i][j];
+                    }
+                    m[i][4] = b[i];
+                }
+
+                for (int col = 0; col < 4; col++) {
+                    int pivot = col;
+                    for (int row = col + 1; row < 4; row++) {
+                        if (std::abs(m[row][col]) > std::abs(m[pivot][col])) {
+                            pivot = row;
+                        }
+                    }
+
+                    if (std::abs(m[pivot][col]) < 1e-12) {
+                        return false;
+                    }
+
+                    for (int j = 0; j < 5; j++) {
+                        std::swap(m[col][j], m[pivot][j]);
+                    }
+
+                    for (int row = col + 1; row < 4; row++) {
+                        double f = m[row][col] / m[col][col];
+                        for (int j = col; j < 5; j++) {
+                            m[row][j] -= f * m[col][j];
+                        }
+                    }
+                }
+
+                for (int i = 3; i >= 0; i--) {
+                    double sum = m[i][4];
+                    for (int j = i + 1; j < 4; j++) {
+                        sum -= m[i][j] * x[j];
+                    }
+                    x[i] = sum / m[i][i];
+                }
+
+                return true;
+            }
+        } // namespace
+
+        DriveCharacterisation::DriveCharacterisation(double step_s, double chirp_s, double chirp_min_hz, double chirp_max_hz) :
+            m_step_s(step_s), m_chirp_s(chirp_s), m_chirp_min_hz(chirp_min_hz), m_chirp_max_hz(chirp_max_hz)
+        {
+        }
+
+        double DriveCharacterisation::duration() const
+        {
+            return 2.0 * PREROLL_S + 2.0 * m_step_s + m_chirp_s;
+        }
+
+        double DriveCharacterisation::chirpPhase(double t) const
+        {
+            return 2.0 * M_PI * (m_chirp_min_hz * t + (m_chirp_max_hz - m_chirp_min_hz) * t * t / (2.0 * m_chirp_s));
+        }
+
+        double DriveCharacterisation::setpoint(double t) const
+        {
+            if (t < PREROLL_S) {
+                return 0.0;
+            }
+            t -= PREROLL_S;
+
+            if (t < m_step_s) {
+                return 1.0;
+            }
+            t -= m_step_s;
+
+            if (t < m_step_s) {
+                return 0.0;
+            }
+            t -= m_step_s;
+
+            // Starts and ends at 0 without discontinuity
+            if (t < m_chirp_s) {
+                return 0.5 - 0.5 * std::cos(chirpPhase(t));
+            }
+
+            return 0.0;
+        }
+
+        void DriveCharacterisation::record(double t, double left_cmd_mps, double right_cmd_mps, double left_m, double right_m)
+        {
+            m_samples.push_back({t, {left_cmd_mps, right_cmd_mps}, {left_m, right_m}});
+        }
+
+        size_t DriveCharacterisation::samples() const
+        {
+            return m_samples.size();
+        }
+
+        double DriveCharacterisation::sampleRate() const
+        {
+            if (m_samples.size() < 2) {
+                return 0.0;
+            }
+
+            return static_cast<double>(m_samples.size() - 1) / (m_samples.back().t - m_samples.front().t);
+        }
+
+        DriveCharacterisation::Result DriveCharacterisation::analyse(Wheel wheel) const
+        {
+            Result result;
+
+            analyseStep(wheel, result);
+            analyseChirp(wheel, result);
+
+            return result;
+        }
+
+        void DriveCharacterisation::analyseStep(Wheel wheel, Result &result) const
+        {
+            const int w = static_cast<int>(wheel);
+
+            // Samples of the step up, the step starts when its setpoint has been sent
+            size_t first = 0;
+            while ((first < m_samples.size()) && (m_samples[first].t < PREROLL_S)) {
+                first++;
+            }
+
+            size_t last = first;
+            while ((last < m_samples.size()) && (m_samples[last].t < PREROLL_S + m_step_s)) {
+                last++;
+            }
+
+            if (last - first < MIN_SEGMENT_SAMPLES) {
+                return;
+            }
+
+            double t_step     = m_samples[first].t;
+            double step_mps   = m_samples[first].cmd_mps[w];
+            double position_0 = m_samples[(first > 0) ? first - 1 : first].position_m[w];
+
+            if (std::abs(step_mps) < std::numeric_limits<double>::epsilon()) {
+                return;
+            }
+
+            // Steady state speed, by linear regression of the position at the end of the step
+            size_t steady = last - static_cast<size_t>(STEP_STEADY_RATIO * static_cast<double>(last - first));
+            double n = 0.0, st = 0.0, sp = 0.0, stt = 0.0, stp = 0.0;
+            for (size_t i = steady; i < last; i++) {
+                double t = m_samples[i].t - t_step;
+                double p = m_samples[i].position_m[w] - position_0;
+                n += 1.0;
+                st += t;
+                sp += p;
+                stt += t * t;
+                stp += t * p;
+            }
+
+            double denominator = n * stt - st * st;
+            if (std::abs(denominator) < std::numeric_limits<double>::epsilon()) {
+                return;
+            }
+
+            double steady_mps = (n * stp - st * sp) / denominator;
+            double gain       = steady_mps / step_mps;
+
+            auto cost = [&](double dead_time_s, double time_constant_s) {
+                double sum = 0.0;
+                for (size_t i = first; i < last; i++) {
+                    double e = m_samples[i].position_m[w] - position_0 - steady_mps * stepPosition(m_samples[i].t - t_step, dead_time_s, time_constant_s);
+                    sum += e * e;
+                }
+                return sum;
+            };
+
+            // Coarse grid search, linear on the dead time and logarithmic on the time constant
+            double max_dead_time_s = std::min(MAX_DEAD_TIME_S, m_step_s / 2.0);
+            double max_time_const  = m_step_s / 3.0;
+            double ratio           = std::pow(max_time_const / MIN_TIME_CONST_S, 1.0 / (TIME_CONST_POINTS - 1));
+            double best_cost = std::numeric_limits<double>::max(), best_dead_time = 0.0, best_time_const = MIN_TIME_CONST_S;
+
+            for (double dead_time_s = 0.0; dead_time_s <= max_dead_time_s; dead_time_s += 0.001) {
+                double time_constant_s = MIN_TIME_CONST_S;
+                for (int k = 0; k < TIME_CONST_POINTS; k++, time_constant_s *= ratio) {
+                    double c = cost(dead_time_s, time_constant_s);
+                    if (c < best_cost) {
+                        best_cost       = c;
+                        best_dead_time  = dead_time_s;
+                        best_time_const = time_constant_s;
+                    }
+                }
+            }
+
+            // Fine grid around the coarse optimum
+            double coarse_dead_time = best_dead_time, coarse_time_const = best_time_const;
+            for (int i = -20; i <= 20; i++) {
+                double dead_time_s = coarse_dead_time + i * 0.0001;
+                if (dead_time_s < 0.0) {
+                    continue;
+                }
+
+                for (int k = -20; k <= 20; k++) {
+                    double time_constant_s = coarse_time_const * std::pow(ratio, k / 20.0);
+                    double c               = cost(dead_time_s, time_constant_s);
+                    if (c < best_cost) {
+                        best_cost       = c;
+                        best_dead_time  = dead_time_s;
+                        best_time_const = time_constant_s;
+                    }
+                }
+            }
+
+            result.step_valid         = true;
+            result.dead_time_s        = best_dead_time;
+            result.time_constant_s    = best_time_const;
+            result.gain               = gain;
+            result.fit_rms_m          = std::sqrt(best_cost / static_cast<double>(last - first));
+            result.model_bandwidth_hz = 1.0 / (2.0 * M_PI * best_time_const);
+        }
+
+        void DriveCharacterisation::analyseChirp(Wheel wheel, Result &result) const
+        {
+            const int    w       = static_cast<int>(wheel);
+            const double t_chirp = PREROLL_S + 2.0 * m_step_s;
+
+            // Per segment, the commanded speed and the position are regressed on [1, t, sin(phase), cos(phase)].
+            // The frequency varies slowly enough over a segment for the position of the oscillating speed to
+            // follow the same phase, scaled by 1 / omega.
+            double ata[4][4], atu[4], atx[4], t_sum = 0.0;
+            int    segment = -1;
+            size_t n       = 0;
+
+            auto flush = [&]() {
+                double coef_u[4], coef_x[4];
+                if ((n < MIN_SEGMENT_SAMPLES) || !solve4(ata, atu, coef_u) || !solve4(ata, atx, coef_x)) {
+                    return;
+                }
+
+                double frequency_hz = m_chirp_min_hz + (m_chirp_max_hz - m_chirp_min_hz) * (t_sum / n) / m_chirp_s;
+                double omega        = 2.0 * M_PI * frequency_hz;
+
+                // Phasors of p.cos(phase) + q.sin(phase) are p - jq, the speed is the derivative of the position
+                std::complex<double> command(coef_u[3], -coef_u[2]);
+                std::complex<double> speed = std::complex<double>(0.0, omega) * std::complex<double>(coef_x[3], -coef_x[2]);
+
+                if (std::abs(command) < std::numeric_limits<double>::epsilon()) {
+                    return;
+                }
+
+                std::complex<double> h = speed / command;
+                result.response.push_back({frequency_hz, std::abs(h), std::arg(h)});
+            };
+
+            for (const Sample &sample : m_samples) {
+                double t = sample.t - t_chirp;
+                if ((t < 0.0) || (t >= m_chirp_s)) {
+                    continue;
+                }
+
+                double phase = chirpPhase(t);
+                int    s     = static_cast<int>(phase / CHIRP_SEGMENT_RAD);
+
+                if (s != segment) {
+                    if (segment >= 0) {
+                        flush();
+                    }
+
+                    segment = s;
+                    n       = 0;
+                    t_sum   = 0.0;
+                    for (int i = 0; i < 4; i++) {
+                        atu[i] = atx[i] = 0.0;
+                        for (int j = 0; j < 4; j++) {
+                            ata[i][j] = 0.0;
+                        }
+                    }
+                }
+
+                double r[4] = {1.0, t, std::sin(phase), std::cos(phase)};
+                for (int i = 0; i < 4; i++) {
+                    for (int j = 0; j < 4; j++) {
+                        ata[i][j] += r[i] * r[j];
+                    }
+                    atu[i] += r[i] * sample.cmd_mps[w];
+                    atx[i] += r[i] * sample.position_m[w];
+                }
+
+                t_sum += t;
+                n++;
+            }
+
+            if (segment >= 0) {
+                flush();
+            }
+
+            if (result.response.empty()) {
+                return;
+            }
+
+            // Unwrap the phase, the lag keeps increasing with the frequency
+            for (size_t i = 1; i < result.response.size(); i++) {
+                while (result.response[i].phase_rad - result.response[i - 1].phase_rad > M_PI) {
+                    result.response[i].phase_rad -= 2.0 * M_PI;
+                }
+                while (result.response[i].phase_rad - result.response[i - 1].phase_rad < -M_PI) {
+                    result.response[i].phase_rad += 2.0 * M_PI;
+                }
+            }
+
+            // -3 dB from the static gain, or the lowest frequency one without step, interpolated between the segments
+            double cutoff = (result.step_valid ? result.gain : result.response.front().gain) / std::sqrt(2.0);
+            for (size_t i = 1; i < result.response.size(); i++) {
+                const FrequencyPoint &a = result.response[i - 1];
+                const FrequencyPoint &b = result.response[i];
+
+                if (b.gain < cutoff) {
+                    result.bandwidth_hz = a.frequency_hz + (b.frequency_hz - a.frequency_hz) * (a.gain - cutoff) / (a.gain - b.gain);
+                    break;
+                }
+            }
+        }
+
+        bool DriveCharacterisation::writeReport(const std::string &path, const Result &left, const Result &right) const
+        {
+            std::ofstream report(path);
+            if (!report) {
+                return false;
+            }
+
+            char        date[32];
+            std::time_t now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+            report << "# Drive characterisation, step and chirp response of each wheel\n";
+            report << "date: " << date << "\n";
+            report << "samples: " << m_samples.size() << "\n";
+            report << "sample_rate_hz: " << sampleRate() << "\n";
+            report << "step_s: " << m_step_s << "\n";
+            report << "chirp_s: " << m_chirp_s << "\n";
+            report << "chirp_min_hz: " << m_chirp_min_hz << "\n";
+            report << "chirp_max_hz: " << m_chirp_max_hz << "\n";
+
+            for (int w = 0; w < 2; w++) {
+                const Result &result = (0 == w) ? left : right;
+
+                report << ((0 == w) ? "left:\n" : "right:\n");
+                report << "  step_valid: " << (result.step_valid ? "true" : "false") << "\n";
+                report << "  dead_time_ms: " << result.dead_time_s * 1000.0 << "\n";
+                report << "  time_constant_ms: " << result.time_constant_s * 1000.0 << "\n";
+                report << "  gain: " << result.gain << "\n";
+                report << "  fit_rms_mm: " << result.fit_rms_m * 1000.0 << "\n";
+                report << "  model_bandwidth_hz: " << result.model_bandwidth_hz << "\n";
+                report << "  bandwidth_hz: " << result.bandwidth_hz << "\n";
+                report << "  frequency_response:\n";
+                for (const FrequencyPoint &point : result.response) {
+                    report << "    - {frequency_hz: " << point.frequency_hz << ", gain: " << point.gain << ", phase_deg: " << point.phase_rad * 180.0 / M_PI << "}\n";
+                }
+            }
+
+            // Raw samples next to the report
+            std::string csv_path = path;
+            size_t      dot      = csv_path.find_last_of('.');
+            if ((std::string::npos != dot) && ((std::string::npos == csv_path.find_last_of('/')) || (dot > csv_path.find_last_of('/')))) {
+                csv_path.erase(dot);
+            }
+            csv_path += ".csv";
+
+            std::ofstream csv(csv_path);
+            if (!csv) {
+                return false;
+            }
+
+            csv << "t_s,left_cmd_mps,right_cmd_mps,left_m,right_m\n";
+            csv.precision(9);
+            for (const Sample &sample : m_samples) {
+                csv << sample.t << "," << sample.cmd_mps[0] << "," << sample.cmd_mps[1] << "," << sample.position_m[0] << "," << sample.position_m[1] << "\n";
+            }
+
+            return report.good() && csv.good();
+        }
+    } // namespace swd
+} // namespace ezw
@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file DriveStats.cpp
+ */
+
+#include "diff_drive_controller/DriveStats.hpp"
+
+#include <cmath>
+
+namespace ezw
+{
+    namespace swd
+    {
+        void LatencyHistogram::record(int64_t ns)
+        {
+            ns = (ns > 0) ? ns : 0;
+
+            // Bucket i holds [2^i, 2^(i+1)[ us, the first one also holds shorter durations
+            int64_t us     = ns / 1000;
+            int     bucket = 0;
+            while ((us > 1) && (bucket < BUCKETS - 1)) {
+                us >>= 1;
+                bucket++;
+            }
+
+            m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+            m_sum_ns.fetch_add(ns, std::memory_order_relaxed);
+
+            int64_t max = m_max_ns.load(std::memory_order_relaxed);
+            while ((ns > max) && !m_max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+            }
+        }
+
+        void LatencyHistogram::cumulative(uint64_t counts[BUCKETS], int64_t &sum_ns) const
+        {
+            for (int i = 0; i < BUCKETS; i++) {
+                counts[i] = m_counts[i].load(std::memory_order_relaxed);
+            }
+            sum_ns = m_sum_ns.load(std::memory_order_relaxed);
+        }
+
+        double LatencyHistogram::upperBoundUs(int bucket)
+        {
+            return static_cast<double>(uint64_t(1) << (bucket + 1));
+        }
+
+        LatencyHistogram::Summary LatencyHistogram::summarize()
+        {
+            Summary  summary;
+            uint64_t window[BUCKETS];
+
+            for (int i = 0; i < BUCKETS; i++) {
+                uint64_t count = m_counts[i].load(std::memory_order_relaxed);
+                window[i]      = count - m_previous[i];
+                m_previous[i]  = count;
+                summary.count += window[i];
+            }
+
+            summary.max_us = static_cast<double>(m_max_ns.exchange(0, std::memory_order_relaxed)) / 1000.0;
+
+            if (0 == summary.count) {
+                return summary;
+            }
+
+            auto percentile = [&](double p) {
+                // Nearest rank
+                uint64_t rank       = static_cast<uint64_t>(std::ceil(p * static_cast<double>(summary.count)));
+                uint64_t cumulative = 0;
+                for (int i = 0; i < BUCKETS; i++) {
+                    cumulative += window[i];
+                    if (cumulative >= rank) {
+                        return upperBoundUs(i);
+                    }
+                }
+                return upperBoundUs(BUCKETS - 1);
+            };
+
+            summary.p50_us = percentile(0.50);
+            summary.p90_us = percentile(0.90);
+            summary.p99_us = percentile(0.99);
+
+            return summary;
+        }
+
+        ScopedLatency::ScopedLatency(LatencyHistogram &histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now())
+        {
+        }
+
+        ScopedLatency::~ScopedLatency()
+        {
+            m_histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+        }
+
+        void ErrorCounters::record(ezw_error_t err)
+        {
+            int32_t code = static_cast<int32_t>(err);
+
+            m_total.fetch_add(1, std::memory_order_relaxed);
+
+            // Slots are claimed once, for the first error of each code, 0 being ERROR_NONE
+            for (size_t i = 0; i < SLOTS; i++) {
+                int32_t slot = m_codes[i].load(std::memory_order_acquire);
+                if ((0 == slot) && (m_codes[i].compare_exchange_strong(slot, code, std::memory_order_acq_rel) || (slot == code))) {
+                    m_counts[i].fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                if (slot == code) {
+                    m_counts[i].fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            m_others.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        size_t ErrorCounters::snapshot(std::pair<int32_t, uint64_t> *counters, size_t max) const
+        {
+            size_t n = 0;
+            for (size_t i = 0; (i < SLOTS) && (n < max); i++) {
+                int32_t code = m_codes[i].load(std::memory_order_acquire);
+                if (0 != code) {
+                    counters[n++] = std::make_pair(code, m_counts[i].load(std::memory_order_relaxed));
+                }
+            }
+            return n;
+        }
+
+        uint64_t ErrorCounters::total() const
+        {
+            return m_total.load(std::memory_order_relaxed);
+        }
+
+        uint64_t ErrorCounters::others() const
+        {
+            return m_others.load(std::memory_order_relaxed);
+        }
+    } // namespace swd
+} // namespace ezw
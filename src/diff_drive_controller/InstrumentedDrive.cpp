@@ -0,0 +1,124 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file InstrumentedDrive.cpp
+ */
+
+#include "diff_drive_controller/InstrumentedDrive.hpp"
+
+namespace ezw
+{
+    namespace swd
+    {
+        InstrumentedDrive::InstrumentedDrive(std::unique_ptr<DriveInterface> drive, DriveStats &stats) : m_drive(std::move(drive)), m_stats(stats)
+        {
+        }
+
+        template <typename Call>
+        ezw_error_t InstrumentedDrive::measure(Call call)
+        {
+            ezw_error_t err;
+
+            {
+                ScopedLatency latency(m_stats.latency);
+                err = call();
+            }
+
+            m_stats.calls.fetch_add(1, std::memory_order_relaxed);
+            if (ERROR_NONE != err) {
+                m_stats.errors.record(err);
+            }
+
+            return err;
+        }
+
+        double InstrumentedDrive::getDiameter() const
+        {
+            return m_drive->getDiameter();
+        }
+
+        double InstrumentedDrive::getReduction() const
+        {
+            return m_drive->getReduction();
+        }
+
+        ezw_error_t InstrumentedDrive::getOdometryValue(int32_t &dist_mm)
+        {
+            return measure([&]() { return m_drive->getOdometryValue(dist_mm); });
+        }
+
+        ezw_error_t InstrumentedDrive::getNMTState(smccore::Controller::NMTState &state)
+        {
+            ezw_error_t err = measure([&]() { return m_drive->getNMTState(state); });
+            m_stats.nmt_state.store((ERROR_NONE == err) ? static_cast<int>(state) : -1, std::memory_order_relaxed);
+            return err;
+        }
+
+        ezw_error_t InstrumentedDrive::setNMTState(smccore::Controller::NMTCommand command)
+        {
+            return measure([&]() { return m_drive->setNMTState(command); });
+        }
+
+        ezw_error_t InstrumentedDrive::getPDSState(smccore::Controller::PDSState &state)
+        {
+            ezw_error_t err = measure([&]() { return m_drive->getPDSState(state); });
+            m_stats.pds_state.store((ERROR_NONE == err) ? static_cast<int>(state) : -1, std::memory_order_relaxed);
+            return err;
+        }
+
+        ezw_error_t InstrumentedDrive::enterInOperationEnabledState()
+        {
+            return measure([&]() { return m_drive->enterInOperationEnabledState(); });
+        }
+
+        ezw_error_t InstrumentedDrive::setHalt(bool halt)
+        {
+            return measure([&]() { return m_drive->setHalt(halt); });
+        }
+
+        ezw_error_t InstrumentedDrive::setTargetVelocity(int32_t speed_rpm)
+        {
+            return measure([&]() { return m_drive->setTargetVelocity(speed_rpm); });
+        }
+
+        ezw_error_t InstrumentedDrive::getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value)
+        {
+            return measure([&]() { return m_drive->getSafetyFunctionCommand(id, value); });
+        }
+
+        ezw_error_t InstrumentedDrive::getVelocityDemand(int32_t &speed_rpm)
+        {
+            return measure([&]() { return m_drive->getVelocityDemand(speed_rpm); });
+        }
+
+        ezw_error_t InstrumentedDrive::getStatusWord(uint16_t &status_word)
+        {
+            return measure([&]() { return m_drive->getStatusWord(status_word); });
+        }
+
+        ezw_error_t InstrumentedDrive::setOperationMode(OperationMode mode)
+        {
+            return measure([&]() { return m_drive->setOperationMode(mode); });
+        }
+
+        ezw_error_t InstrumentedDrive::setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s)
+        {
+            return measure([&]() { return m_drive->setProfile(velocity_rpm, acceleration_rpm_s, deceleration_rpm_s); });
+        }
+
+        ezw_error_t InstrumentedDrive::startRelativeMove(int32_t distance_mm)
+        {
+            return measure([&]() { return m_drive->startRelativeMove(distance_mm); });
+        }
+
+        ezw_error_t InstrumentedDrive::setCommunicationTimeout(uint16_t timeout_ms)
+        {
+            return measure([&]() { return m_drive->setCommunicationTimeout(timeout_ms); });
+        }
+
+        ezw_error_t InstrumentedDrive::sendHeartbeat()
+        {
+            return measure([&]() { return m_drive->sendHeartbeat(); });
+        }
+    } // namespace swd
+} // namespace ezw
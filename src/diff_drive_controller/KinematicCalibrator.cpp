@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file KinematicCalibrator.cpp
+ */
+
+#include "diff_drive_controller/KinematicCalibrator.hpp"
+
+#include <cmath>
+
+// P is the inverse of the information (sum of phi.phi'), in 1/m^2. It is the variance
+// of the estimate relative to the variance of the gyro heading increments.
+#define INITIAL_P 100.0
+
+// The forgetting makes the variance of a direction the regressors don't excite (e.g. the turns
+// while driving straight) grow exponentially, it is suspended above the initial trace of P
+#define MAX_TRACE_P (2.0 * INITIAL_P)
+
+// Convergence criteria, both parameters must be excited (straight lines and turns)
+#define MIN_SAMPLES 50
+#define MAX_P       1.0
+
+namespace ezw
+{
+    namespace swd
+    {
+        KinematicCalibrator::KinematicCalibrator(double baseline_m, double forgetting_factor, double min_travel_m) :
+            m_lambda(forgetting_factor), m_min_travel_m(min_travel_m), m_a(1.0 / baseline_m), m_c(1.0 / baseline_m)
+        {
+            m_p[0][0] = m_p[1][1] = INITIAL_P;
+            m_p[0][1] = m_p[1][0] = 0.0;
+        }
+
+        bool KinematicCalibrator::update(double d_left, double d_right, double d_theta)
+        {
+            m_acc_left += d_left;
+            m_acc_right += d_right;
+            m_acc_theta += d_theta;
+
+            if ((std::abs(m_acc_left) + std::abs(m_acc_right)) < m_min_travel_m) {
+                return false;
+            }
+
+            // Regressor and measurement: d_theta = [d_right, -d_left] . [a, c]
+            double phi[2] = {m_acc_right, -m_acc_left};
+            double y      = m_acc_theta;
+
+            m_acc_left = m_acc_right = m_acc_theta = 0.0;
+
+            // Gain K = P.phi / (lambda + phi'.P.phi)
+            double p_phi[2] = {m_p[0][0] * phi[0] + m_p[0][1] * phi[1], m_p[1][0] * phi[0] + m_p[1][1] * phi[1]};
+            double denom    = m_lambda + phi[0] * p_phi[0] + phi[1] * p_phi[1];
+            double k[2]     = {p_phi[0] / denom, p_phi[1] / denom};
+
+            double innovation = y - (phi[0] * m_a + phi[1] * m_c);
+            m_a += k[0] * innovation;
+            m_c += k[1] * innovation;
+
+            // P = (P - K.phi'.P) / lambda, P is symmetric so phi'.P = (P.phi)'
+            for (int i = 0; i < 2; ++i) {
+                for (int j = 0; j < 2; ++j) {
+                    m_p[i][j] -= k[i] * p_phi[j];
+                }
+            }
+
+            double lambda = ((m_p[0][0] + m_p[1][1]) / m_lambda <= MAX_TRACE_P) ? m_lambda : 1.0;
+            for (int i = 0; i < 2; ++i) {
+                for (int j = 0; j < 2; ++j) {
+                    m_p[i][j] /= lambda;
+                }
+            }
+
+            m_samples++;
+            return true;
+        }
+
+        void KinematicCalibrator::discard()
+        {
+            m_acc_left = m_acc_right = m_acc_theta = 0.0;
+        }
+
+        double KinematicCalibrator::baseline() const
+        {
+            return 2.0 / (m_a + m_c);
+        }
+
+        double KinematicCalibrator::leftScale() const
+        {
+            return m_c * baseline();
+        }
+
+        double KinematicCalibrator::rightScale() const
+        {
+            return m_a * baseline();
+        }
+
+        uint32_t KinematicCalibrator::samples() const
+        {
+            return m_samples;
+        }
+
+        bool KinematicCalibrator::converged() const
+        {
+            return (m_samples >= MIN_SAMPLES) && (m_p[0][0] < MAX_P) && (m_p[1][1] < MAX_P);
+        }
+    } // namespace swd
+} // namespace ezw
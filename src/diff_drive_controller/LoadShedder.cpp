@@ -0,0 +1,81 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file LoadShedder.cpp
+ */
+
+#include "diff_drive_controller/LoadShedder.hpp"
+
+namespace ezw
+{
+    namespace swd
+    {
+        LoadShedder::LoadShedder(uint32_t window_cycles, double miss_ratio, uint32_t recover_windows) :
+            m_window_cycles(window_cycles > 0 ? window_cycles : 1), m_recover_windows(recover_windows > 0 ? recover_windows : 1), m_miss_ratio(miss_ratio)
+        {
+        }
+
+        bool LoadShedder::update(bool deadline_missed)
+        {
+            m_cycles++;
+            if (deadline_missed) {
+                m_misses++;
+            }
+
+            if (m_cycles < m_window_cycles) {
+                return false;
+            }
+
+            // End of the observation window
+            Level previous    = m_level;
+            m_last_miss_ratio = static_cast<double>(m_misses) / static_cast<double>(m_cycles);
+
+            if (m_last_miss_ratio > m_miss_ratio) {
+                // Sustained overload, shed one more step
+                m_clean_windows = 0;
+                if (Level::SHED_TELEMETRY != m_level) {
+                    m_level = static_cast<Level>(static_cast<int>(m_level) + 1);
+                }
+            } else if (0 == m_misses) {
+                // Restore one step after enough clean windows
+                m_clean_windows++;
+                if ((m_clean_windows >= m_recover_windows) && (Level::NOMINAL != m_level)) {
+                    m_level         = static_cast<Level>(static_cast<int>(m_level) - 1);
+                    m_clean_windows = 0;
+                }
+            } else {
+                m_clean_windows = 0;
+            }
+
+            m_cycles = 0;
+            m_misses = 0;
+
+            return previous != m_level;
+        }
+
+        LoadShedder::Level LoadShedder::level() const
+        {
+            return m_level;
+        }
+
+        double LoadShedder::lastMissRatio() const
+        {
+            return m_last_miss_ratio;
+        }
+
+        const char *LoadShedder::levelName(Level level)
+        {
+            switch (level) {
+                case Level::NOMINAL:
+                    return "nominal";
+                case Level::SHED_TF:
+                    return "TF decimated";
+                case Level::SHED_SAFETY_RATE:
+                    return "TF decimated, safety publication reduced";
+                case Level::SHED_TELEMETRY:
+                    return "TF decimated, safety publication reduced, telemetry dropped";
+            }
+            return "unknown";
+        }
+    } // namespace swd
+} // namespace ezw
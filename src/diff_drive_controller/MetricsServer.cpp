@@ -0,0 +1,143 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file MetricsServer.cpp
+ */
+
+#include "diff_drive_controller/MetricsServer.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Period of the stop flag checks
+#define ACCEPT_POLL_MS 200
+
+// A client has this long to send its request
+#define CLIENT_TIMEOUT_S 1
+
+// Scrapes don't compete with the control loop
+#define SERVER_NICE 19
+
+namespace ezw
+{
+    namespace swd
+    {
+        MetricsServer::MetricsServer(std::function<std::string()> render) : m_render(std::move(render))
+        {
+        }
+
+        MetricsServer::~MetricsServer()
+        {
+            stop();
+        }
+
+        bool MetricsServer::start(const std::string &address, uint16_t port)
+        {
+            sockaddr_in addr = {};
+            addr.sin_family  = AF_INET;
+            addr.sin_port    = htons(port);
+            if (1 != inet_pton(AF_INET, address.c_str(), &addr.sin_addr)) {
+                return false;
+            }
+
+            m_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (m_fd < 0) {
+                return false;
+            }
+
+            int reuse = 1;
+            setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            if ((0 != bind(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))) || (0 != listen(m_fd, 4))) {
+                close(m_fd);
+                m_fd = -1;
+                return false;
+            }
+
+            m_stop   = false;
+            m_thread = std::thread(&MetricsServer::run, this);
+            return true;
+        }
+
+        void MetricsServer::stop()
+        {
+            m_stop = true;
+
+            if (m_thread.joinable()) {
+                m_thread.join();
+            }
+
+            if (m_fd >= 0) {
+                close(m_fd);
+                m_fd = -1;
+            }
+        }
+
+        void MetricsServer::run()
+        {
+            setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), SERVER_NICE);
+
+            while (!m_stop) {
+                pollfd pfd = {m_fd, POLLIN, 0};
+                if (poll(&pfd, 1, ACCEPT_POLL_MS) <= 0) {
+                    continue;
+                }
+
+                int client = accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (client < 0) {
+                    continue;
+                }
+
+                serve(client);
+                close(client);
+            }
+        }
+
+        void MetricsServer::serve(int client)
+        {
+            timeval timeout = {CLIENT_TIMEOUT_S, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            // Only the request line matters
+            char    request[1024];
+            ssize_t n = recv(client, request, sizeof(request) - 1, 0);
+            if (n <= 0) {
+                return;
+            }
+            request[n] = '\0';
+
+            std::string line(request);
+            line = line.substr(0, line.find_first_of("\r\n"));
+
+            std::string status, body, type = "text/plain; charset=utf-8";
+            if ((0 == line.find("GET /metrics ")) || ("GET /metrics" == line)) {
+                status = "200 OK";
+                body   = m_render();
+                type   = "text/plain; version=0.0.4; charset=utf-8";
+            } else if (0 == line.find("GET ")) {
+                status = "404 Not Found";
+                body   = "Metrics are served on /metrics\n";
+            } else {
+                status = "405 Method Not Allowed";
+            }
+
+            std::string response = "HTTP/1.0 " + status + "\r\nContent-Type: " + type + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t s = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (s <= 0) {
+                    return;
+                }
+                sent += static_cast<size_t>(s);
+            }
+        }
+    } // namespace swd
+} // namespace ezw
@@ -0,0 +1,97 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file OdometryIntegrator.cpp
+ */
+
+#include "diff_drive_controller/OdometryIntegrator.hpp"
+
+#include <cmath>
+
+// Below this heading increment (rad), the arc of a step is integrated as a straight segment
+#define EXACT_MIN_D_THETA 1e-9
+
+namespace ezw
+{
+    namespace swd
+    {
+        OdometryIntegrator::OdometryIntegrator(Scheme scheme) : m_scheme(scheme)
+        {
+        }
+
+        void OdometryIntegrator::kinematics(double d_left, double d_right, double d_left_err, double d_right_err, double baseline, double &d_center, double &d_theta,
+                                            double &d_center_err, double &d_theta_err)
+        {
+            d_center = (d_left + d_right) / 2.0;
+            d_theta  = (d_right - d_left) / baseline;
+
+            // Error propagation (See https://en.wikipedia.org/wiki/Propagation_of_uncertainty#Non-linear_combinations)
+            d_center_err = std::sqrt(std::pow(d_left_err / 2.0, 2) + std::pow(d_right_err / 2.0, 2));
+            d_theta_err  = std::sqrt(std::pow(d_left_err / baseline, 2) + std::pow(d_right_err / baseline, 2));
+        }
+
+        OdometryPose OdometryIntegrator::step(const OdometryPose &prev, double d_center, double d_theta, double d_center_err, double d_theta_err) const
+        {
+            OdometryPose now;
+
+            // Heading the displacement is projected with
+            double heading = (Scheme::EULER == m_scheme) ? prev.theta : prev.theta + d_theta / 2.0;
+            double cos_h   = std::cos(heading);
+            double sin_h   = std::sin(heading);
+
+            if ((Scheme::EXACT == m_scheme) && (std::abs(d_theta) > EXACT_MIN_D_THETA)) {
+                // Chord of the arc, along the mean heading
+                double chord = d_center * std::sin(d_theta / 2.0) / (d_theta / 2.0);
+                now.x        = prev.x + chord * cos_h;
+                now.y        = prev.y + chord * sin_h;
+            } else {
+                now.x = prev.x + d_center * cos_h;
+                now.y = prev.y + d_center * sin_h;
+            }
+
+            now.theta = prev.theta + d_theta;
+            if (now.theta > M_PI) {
+                now.theta -= 2. * M_PI;
+            } else if (now.theta < -M_PI) {
+                now.theta += 2. * M_PI;
+            }
+
+            now.x_err     = std::sqrt(std::pow(prev.x_err, 2) + std::pow(cos_h * d_center_err, 2) + std::pow(-sin_h * d_center * prev.theta_err, 2));
+            now.y_err     = std::sqrt(std::pow(prev.y_err, 2) + std::pow(sin_h * d_center_err, 2) + std::pow(cos_h * d_center * prev.theta_err, 2));
+            now.theta_err = std::sqrt(std::pow(prev.theta_err, 2) + std::pow(d_theta_err, 2));
+
+            return now;
+        }
+
+        OdometryIntegrator::Scheme OdometryIntegrator::scheme() const
+        {
+            return m_scheme;
+        }
+
+        const char *OdometryIntegrator::schemeName(Scheme scheme)
+        {
+            switch (scheme) {
+                case Scheme::EULER:
+                    return "Euler";
+                case Scheme::MIDPOINT:
+                    return "Midpoint";
+                case Scheme::EXACT:
+                    return "Exact";
+            }
+
+            return "Unknown";
+        }
+
+        bool OdometryIntegrator::parseScheme(const std::string &name, Scheme &scheme)
+        {
+            for (Scheme candidate : {Scheme::EULER, Scheme::MIDPOINT, Scheme::EXACT}) {
+                if (name == schemeName(candidate)) {
+                    scheme = candidate;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    } // namespace swd
+} // namespace ezw
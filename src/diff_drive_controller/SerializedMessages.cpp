@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SerializedMessages.cpp
+ */
+
+#include "diff_drive_controller/SerializedMessages.hpp"
+
+namespace ezw
+{
+    namespace swd
+    {
+        namespace
+        {
+            nav_msgs::Odometry makeOdometry(const std::string &frame_id, const std::string &child_frame_id)
+            {
+                nav_msgs::Odometry msg;
+                msg.header.frame_id = frame_id;
+                msg.child_frame_id  = child_frame_id;
+                return msg;
+            }
+
+            tf2_msgs::TFMessage makeTransform(const std::string &frame_id, const std::string &child_frame_id)
+            {
+                tf2_msgs::TFMessage msg;
+                msg.transforms.resize(1);
+                msg.transforms[0].header.frame_id = frame_id;
+                msg.transforms[0].child_frame_id  = child_frame_id;
+                return msg;
+            }
+        } // namespace
+
+        SerializedOdometry::SerializedOdometry(const std::string &frame_id, const std::string &child_frame_id) :
+            SerializedMessage(makeOdometry(frame_id, child_frame_id))
+        {
+            using ros::serialization::serializationLength;
+
+            // Fields are serialised in declaration order, without padding
+            nav_msgs::Odometry msg    = makeOdometry(frame_id, child_frame_id);
+            m_pose_offset             = serializationLength(msg.header) + serializationLength(msg.child_frame_id);
+            m_pose_covariance_offset  = m_pose_offset + serializationLength(msg.pose.pose);
+            m_twist_offset            = m_pose_offset + serializationLength(msg.pose);
+            m_twist_covariance_offset = m_twist_offset + serializationLength(msg.twist.twist);
+
+            // Identity orientation until the first pose
+            patch(m_pose_offset + 6 * sizeof(double), 1.0);
+        }
+
+        void SerializedOdometry::setHeader(uint32_t seq, const ros::Time &stamp)
+        {
+            patchStamp(0, seq, stamp);
+        }
+
+        void SerializedOdometry::setPose(double x, double y, double qz, double qw, double var_x, double var_y, double var_theta)
+        {
+            // position (x y z) then orientation (x y z w)
+            patch(m_pose_offset, x);
+            patch(m_pose_offset + 1 * sizeof(double), y);
+            patch(m_pose_offset + 5 * sizeof(double), qz);
+            patch(m_pose_offset + 6 * sizeof(double), qw);
+
+            // (6 * 6) matrix (x y z Rx Ry Rz)
+            patch(m_pose_covariance_offset + 0 * sizeof(double), var_x);
+            patch(m_pose_covariance_offset + 7 * sizeof(double), var_y);
+            patch(m_pose_covariance_offset + 35 * sizeof(double), var_theta);
+        }
+
+        void SerializedOdometry::setTwist(double linear, double angular, double var_linear, double var_angular)
+        {
+            // linear (x y z) then angular (x y z)
+            patch(m_twist_offset, linear);
+            patch(m_twist_offset + 5 * sizeof(double), angular);
+
+            patch(m_twist_covariance_offset + 0 * sizeof(double), var_linear);
+            patch(m_twist_covariance_offset + 35 * sizeof(double), var_angular);
+        }
+
+        SerializedTransform::SerializedTransform(const std::string &frame_id, const std::string &child_frame_id) :
+            SerializedMessage(makeTransform(frame_id, child_frame_id))
+        {
+            using ros::serialization::serializationLength;
+
+            // The array length prefix, then the single transform
+            tf2_msgs::TFMessage msg = makeTransform(frame_id, child_frame_id);
+            m_header_offset         = sizeof(uint32_t);
+            m_transform_offset      = m_header_offset + serializationLength(msg.transforms[0].header) + serializationLength(msg.transforms[0].child_frame_id);
+
+            patch(m_transform_offset + 6 * sizeof(double), 1.0);
+        }
+
+        void SerializedTransform::setHeader(uint32_t seq, const ros::Time &stamp)
+        {
+            patchStamp(m_header_offset, seq, stamp);
+        }
+
+        void SerializedTransform::setTransform(double x, double y, double qz, double qw)
+        {
+            // translation (x y z) then rotation (x y z w)
+            patch(m_transform_offset, x);
+            patch(m_transform_offset + 1 * sizeof(double), y);
+            patch(m_transform_offset + 5 * sizeof(double), qz);
+            patch(m_transform_offset + 6 * sizeof(double), qw);
+        }
+    } // namespace swd
+} // namespace ezw
@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SharedMemory.cpp
+ */
+
+#include "diff_drive_controller/SharedMemory.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <ros/console.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ezw
+{
+    namespace swd
+    {
+        void *mapSharedMemory(const std::string &name, size_t size, bool &created)
+        {
+            created = false;
+
+            // Only one process creates and sizes the object, the others just open it
+            int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd >= 0) {
+                created = true;
+                if (0 != ftruncate(fd, static_cast<off_t>(size))) {
+                    ROS_ERROR("Failed sizing shared memory '%s': %s", name.c_str(), std::strerror(errno));
+                    close(fd);
+                    shm_unlink(name.c_str());
+                    return nullptr;
+                }
+            } else if (EEXIST == errno) {
+                fd = shm_open(name.c_str(), O_RDWR, 0600);
+                if (fd < 0) {
+                    ROS_ERROR("Failed opening shared memory '%s': %s", name.c_str(), std::strerror(errno));
+                    return nullptr;
+                }
+
+                // The creator may not have sized it yet
+                struct stat st;
+                for (int i = 0; (0 == fstat(fd, &st)) && (static_cast<size_t>(st.st_size) < size); ++i) {
+                    if (i >= 100) {
+                        ROS_ERROR("Shared memory '%s' has an unexpected size (%ld bytes, expected %zu)", name.c_str(), static_cast<long>(st.st_size), size);
+                        close(fd);
+                        return nullptr;
+                    }
+                    usleep(10000);
+                }
+            } else {
+                ROS_ERROR("Failed creating shared memory '%s': %s", name.c_str(), std::strerror(errno));
+                return nullptr;
+            }
+
+            void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+
+            if (MAP_FAILED == addr) {
+                ROS_ERROR("Failed mapping shared memory '%s': %s", name.c_str(), std::strerror(errno));
+                return nullptr;
+            }
+
+            return addr;
+        }
+
+        void *mapFile(const std::string &path, size_t size, bool &created)
+        {
+            created = false;
+
+            int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                ROS_ERROR("Failed opening file '%s': %s", path.c_str(), std::strerror(errno));
+                return nullptr;
+            }
+
+            struct stat st;
+            if (0 != fstat(fd, &st)) {
+                ROS_ERROR("Failed reading the size of file '%s': %s", path.c_str(), std::strerror(errno));
+                close(fd);
+                return nullptr;
+            }
+
+            // New file, or written by an incompatible version
+            if (static_cast<size_t>(st.st_size) != size) {
+                created = true;
+                if ((0 != ftruncate(fd, 0)) || (0 != ftruncate(fd, static_cast<off_t>(size)))) {
+                    ROS_ERROR("Failed sizing file '%s': %s", path.c_str(), std::strerror(errno));
+                    close(fd);
+                    return nullptr;
+                }
+            }
+
+            void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+
+            if (MAP_FAILED == addr) {
+                ROS_ERROR("Failed mapping file '%s': %s", path.c_str(), std::strerror(errno));
+                return nullptr;
+            }
+
+            return addr;
+        }
+
+        void unmapMemory(void *addr, size_t size)
+        {
+            if (nullptr != addr) {
+                munmap(addr, size);
+            }
+        }
+    } // namespace swd
+} // namespace ezw
@@ -0,0 +1,63 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SimClock.cpp
+ */
+
+#include "diff_drive_controller/SimClock.hpp"
+
+#include <rosgraph_msgs/Clock.h>
+
+#include <chrono>
+
+namespace ezw
+{
+    namespace swd
+    {
+        SimClock::SimClock(double factor, double step_s) : m_factor(factor), m_step_s(step_s)
+        {
+        }
+
+        SimClock::~SimClock()
+        {
+            stop();
+        }
+
+        void SimClock::start()
+        {
+            m_pub_clock = m_nh.advertise<rosgraph_msgs::Clock>("/clock", 1);
+            m_thread    = std::thread(&SimClock::run, this);
+
+            // Nothing may read the time before the first clock message went through
+            ros::Time::waitForValid();
+        }
+
+        void SimClock::stop()
+        {
+            m_stop = true;
+            if (m_thread.joinable()) {
+                m_thread.join();
+            }
+        }
+
+        void SimClock::run()
+        {
+            ros::WallTime        wall_start = ros::WallTime::now();
+            rosgraph_msgs::Clock msg;
+            msg.clock = ros::Time(wall_start.sec, wall_start.nsec);
+
+            ros::Duration sim_step(m_step_s);
+            auto          wall_step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(m_step_s / m_factor));
+            auto          next_tick = std::chrono::steady_clock::now();
+
+            while (!m_stop && ros::ok()) {
+                m_pub_clock.publish(msg);
+                msg.clock = msg.clock + sim_step;
+
+                // Paced on absolute deadlines, the simulated time doesn't drift from the requested rate
+                next_tick += wall_step;
+                std::this_thread::sleep_until(next_tick);
+            }
+        }
+    } // namespace swd
+} // namespace ezw
@@ -0,0 +1,428 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SimDrive.cpp
+ */
+
+#include "diff_drive_controller/SimDrive.hpp"
+#include "diff_drive_controller/SharedMemory.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <ros/console.h>
+#include <ros/time.h>
+#include <unistd.h>
+
+#define SIM_DRIVE_MAGIC 0x53494D34 // "SIM4", changes with the layout of the shared state
+
+namespace ezw
+{
+    namespace swd
+    {
+        namespace
+        {
+            void initState(std::atomic<uint32_t> &magic, pthread_mutex_t &mtx, bool process_shared)
+            {
+                pthread_mutexattr_t attr;
+                pthread_mutexattr_init(&attr);
+                if (process_shared) {
+                    // A controller may die while holding the lock, keep the mutex usable
+                    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+                    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+                }
+                pthread_mutex_init(&mtx, &attr);
+                pthread_mutexattr_destroy(&attr);
+                magic.store(SIM_DRIVE_MAGIC, std::memory_order_release);
+            }
+        } // namespace
+
+        SimDrive::Lock::Lock(State *state) : m_state(state)
+        {
+            if (EOWNERDEAD == pthread_mutex_lock(&m_state->mtx)) {
+                pthread_mutex_consistent(&m_state->mtx);
+            }
+        }
+
+        SimDrive::Lock::~Lock()
+        {
+            pthread_mutex_unlock(&m_state->mtx);
+        }
+
+        SimDrive::SimDrive(double diameter_mm, double reduction, double time_constant_s) :
+            m_diameter_mm(diameter_mm), m_reduction(reduction), m_time_constant_s(time_constant_s), m_state(&m_local_state)
+        {
+            m_local_state.nmt_state                  = static_cast<int32_t>(smccore::Controller::NMTState::PREOP);
+            m_local_state.pds_state                  = static_cast<int32_t>(smccore::Controller::PDSState::SWITCH_ON_DISABLED);
+            m_local_state.mode                       = static_cast<int32_t>(OperationMode::VELOCITY);
+            m_local_state.halt                       = false;
+            m_local_state.target_reached             = true;
+            m_local_state.target_rpm                 = 0.0;
+            m_local_state.demand_rpm                 = 0.0;
+            m_local_state.speed_rpm                  = 0.0;
+            m_local_state.position_mm                = 0.0;
+            m_local_state.target_position_mm         = 0.0;
+            m_local_state.profile_velocity_rpm       = 0.0;
+            m_local_state.profile_acceleration_rpm_s = 0.0;
+            m_local_state.profile_deceleration_rpm_s = 0.0;
+            m_local_state.last_update_ns             = 0;
+            m_local_state.heartbeat_timeout_ns       = 0;
+            m_local_state.last_heartbeat_ns          = 0;
+            initState(m_local_state.magic, m_local_state.mtx, false);
+        }
+
+        SimDrive::~SimDrive()
+        {
+            if (&m_local_state != m_state) {
+                unmapMemory(m_state, sizeof(State));
+            }
+            pthread_mutex_destroy(&m_local_state.mtx);
+        }
+
+        bool SimDrive::share(const std::string &shm_name)
+        {
+            bool   created;
+            State *state = static_cast<State *>(mapSharedMemory(shm_name, sizeof(State), created));
+
+            if (nullptr == state) {
+                return false;
+            }
+
+            if (created) {
+                Lock lock(&m_local_state);
+                state->nmt_state                  = m_local_state.nmt_state;
+                state->pds_state                  = m_local_state.pds_state;
+                state->mode                       = m_local_state.mode;
+                state->halt                       = m_local_state.halt;
+                state->target_reached             = m_local_state.target_reached;
+                state->target_rpm                 = m_local_state.target_rpm;
+                state->demand_rpm                 = m_local_state.demand_rpm;
+                state->speed_rpm                  = m_local_state.speed_rpm;
+                state->position_mm                = m_local_state.position_mm;
+                state->target_position_mm         = m_local_state.target_position_mm;
+                state->profile_velocity_rpm       = m_local_state.profile_velocity_rpm;
+                state->profile_acceleration_rpm_s = m_local_state.profile_acceleration_rpm_s;
+                state->profile_deceleration_rpm_s = m_local_state.profile_deceleration_rpm_s;
+                state->last_update_ns             = m_local_state.last_update_ns;
+                state->heartbeat_timeout_ns       = m_local_state.heartbeat_timeout_ns;
+                state->last_heartbeat_ns          = m_local_state.last_heartbeat_ns;
+                initState(state->magic, state->mtx, true);
+            } else {
+                // Wait for the creator to initialize the wheel
+                for (int i = 0; SIM_DRIVE_MAGIC != state->magic.load(std::memory_order_acquire); ++i) {
+                    if (i >= 100) {
+                        ROS_ERROR("Simulated drive '%s' has not been initialized", shm_name.c_str());
+                        unmapMemory(state, sizeof(State));
+                        return false;
+                    }
+                    usleep(10000);
+                }
+            }
+
+            m_state = state;
+            return true;
+        }
+
+        void SimDrive::update()
+        {
+            int64_t now_ns = static_cast<int64_t>(ros::Time::now().toNSec());
+
+            if (0 == m_state->last_update_ns) {
+                m_state->last_update_ns = now_ns;
+                return;
+            }
+
+            if (now_ns <= m_state->last_update_ns) {
+                return;
+            }
+
+            // Host heartbeat lost, the drive stopped at the end of the timeout, however late it is simulated.
+            // Its setpoint is dropped, the wheel only moves again on a new one once re-enabled.
+            if ((m_state->heartbeat_timeout_ns > 0) && powered()) {
+                int64_t expiry_ns = m_state->last_heartbeat_ns + m_state->heartbeat_timeout_ns;
+                if (expiry_ns < now_ns) {
+                    if (expiry_ns > m_state->last_update_ns) {
+                        step(static_cast<double>(expiry_ns - m_state->last_update_ns) * 1e-9);
+                        m_state->last_update_ns = expiry_ns;
+                    }
+
+                    m_state->pds_state  = static_cast<int32_t>(smccore::Controller::PDSState::QUICK_STOP_ACTIVE);
+                    m_state->target_rpm = 0.0;
+                    ROS_WARN_THROTTLE(1.0, "Simulated drive: host heartbeat lost for more than %ld ms, quick stop.", static_cast<long>(m_state->heartbeat_timeout_ns / 1000000));
+                }
+            }
+
+            step(static_cast<double>(now_ns - m_state->last_update_ns) * 1e-9);
+            m_state->last_update_ns = now_ns;
+        }
+
+        void SimDrive::step(double dt)
+        {
+            if (static_cast<int32_t>(OperationMode::PROFILE_POSITION) == m_state->mode) {
+                updatePosition(dt, powered() && !m_state->halt);
+                return;
+            }
+
+            double target = (powered() && !m_state->halt) ? m_state->target_rpm : 0.0;
+
+            // In profile velocity mode, the demand ramps towards the target, decelerating when slowing down or reversing
+            if (static_cast<int32_t>(OperationMode::PROFILE_VELOCITY) == m_state->mode) {
+                double demand       = m_state->demand_rpm;
+                bool   accelerating = (target * demand >= 0.0) && (std::abs(target) > std::abs(demand));
+                double rate         = accelerating ? m_state->profile_acceleration_rpm_s : m_state->profile_deceleration_rpm_s;
+                m_state->demand_rpm = demand + std::max(-rate * dt, std::min(rate * dt, target - demand));
+            } else {
+                m_state->demand_rpm = target;
+            }
+
+            // First order response, position integrated with the mean speed over the step
+            double speed_prev    = m_state->speed_rpm;
+            double alpha         = (m_time_constant_s > 0.0) ? (1.0 - std::exp(-dt / m_time_constant_s)) : 1.0;
+            m_state->speed_rpm   = speed_prev + (m_state->demand_rpm - speed_prev) * alpha;
+            double wheel_rps     = 0.5 * (speed_prev + m_state->speed_rpm) / (60.0 * m_reduction);
+            m_state->position_mm = m_state->position_mm + wheel_rps * M_PI * m_diameter_mm * dt;
+        }
+
+        void SimDrive::updatePosition(double dt, bool enabled)
+        {
+            // Motor rpm to wheel mm/s
+            double rpm_to_mm_s = M_PI * m_diameter_mm / (60.0 * m_reduction);
+            double speed       = m_state->speed_rpm * rpm_to_mm_s;
+            double remaining   = m_state->target_position_mm - m_state->position_mm;
+            double accel       = m_state->profile_acceleration_rpm_s * rpm_to_mm_s;
+            double decel       = m_state->profile_deceleration_rpm_s * rpm_to_mm_s;
+
+            // Fastest speed from which the target can still be reached, then ramp towards it
+            double desired = 0.0;
+            if (enabled && !m_state->target_reached) {
+                desired = std::copysign(std::min(m_state->profile_velocity_rpm * rpm_to_mm_s, std::sqrt(2.0 * decel * std::abs(remaining))), remaining);
+            }
+
+            double rate      = (std::abs(desired) > std::abs(speed)) ? accel : decel;
+            double new_speed = speed + std::max(-rate * dt, std::min(rate * dt, desired - speed));
+            double step      = 0.5 * (speed + new_speed) * dt;
+
+            // Stop on the target, never beyond
+            if (!m_state->target_reached && (std::abs(step) >= std::abs(remaining)) && (step * remaining >= 0.0)) {
+                m_state->position_mm    = m_state->target_position_mm;
+                m_state->speed_rpm      = 0.0;
+                m_state->target_reached = true;
+                return;
+            }
+
+            m_state->position_mm += step;
+            m_state->speed_rpm = new_speed / rpm_to_mm_s;
+        }
+
+        bool SimDrive::powered() const
+        {
+            // The motor is only powered when the drive is operational
+            return (static_cast<int32_t>(smccore::Controller::NMTState::OPER) == m_state->nmt_state) &&
+                   (static_cast<int32_t>(smccore::Controller::PDSState::OPERATION_ENABLED) == m_state->pds_state);
+        }
+
+        double SimDrive::getDiameter() const
+        {
+            return m_diameter_mm;
+        }
+
+        double SimDrive::getReduction() const
+        {
+            return m_reduction;
+        }
+
+        ezw_error_t SimDrive::getOdometryValue(int32_t &dist_mm)
+        {
+            Lock lock(m_state);
+            update();
+            dist_mm = static_cast<int32_t>(std::round(m_state->position_mm));
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::getNMTState(smccore::Controller::NMTState &state)
+        {
+            Lock lock(m_state);
+            state = static_cast<smccore::Controller::NMTState>(m_state->nmt_state);
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::setNMTState(smccore::Controller::NMTCommand command)
+        {
+            Lock lock(m_state);
+            update();
+
+            switch (command) {
+                case smccore::Controller::NMTCommand::OPER:
+                    m_state->nmt_state = static_cast<int32_t>(smccore::Controller::NMTState::OPER);
+                    break;
+                case smccore::Controller::NMTCommand::PREOP:
+                    m_state->nmt_state = static_cast<int32_t>(smccore::Controller::NMTState::PREOP);
+                    break;
+                default:
+                    m_state->nmt_state = static_cast<int32_t>(smccore::Controller::NMTState::STOP);
+                    break;
+            }
+
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::getPDSState(smccore::Controller::PDSState &state)
+        {
+            Lock lock(m_state);
+            state = static_cast<smccore::Controller::PDSState>(m_state->pds_state);
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::enterInOperationEnabledState()
+        {
+            Lock lock(m_state);
+            update();
+
+            if (static_cast<int32_t>(smccore::Controller::NMTState::OPER) != m_state->nmt_state) {
+                return DRIVE_ERROR_NOT_READY;
+            }
+
+            m_state->pds_state = static_cast<int32_t>(smccore::Controller::PDSState::OPERATION_ENABLED);
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::setHalt(bool halt)
+        {
+            Lock lock(m_state);
+            update();
+            m_state->halt = halt;
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::setTargetVelocity(int32_t speed_rpm)
+        {
+            Lock lock(m_state);
+            update();
+            m_state->target_rpm = static_cast<double>(speed_rpm);
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value)
+        {
+            (void)id;
+
+            // No safety function is ever requested on a simulated wheel
+            value = true;
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::getVelocityDemand(int32_t &speed_rpm)
+        {
+            Lock lock(m_state);
+            update();
+
+            // The setpoint is applied as soon as it is received, when the motor is powered
+            if (static_cast<int32_t>(OperationMode::PROFILE_POSITION) == m_state->mode) {
+                speed_rpm = static_cast<int32_t>(std::round(m_state->speed_rpm));
+            } else if (static_cast<int32_t>(OperationMode::PROFILE_VELOCITY) == m_state->mode) {
+                speed_rpm = static_cast<int32_t>(std::round(m_state->demand_rpm));
+            } else {
+                speed_rpm = (powered() && !m_state->halt) ? static_cast<int32_t>(m_state->target_rpm) : 0;
+            }
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::getStatusWord(uint16_t &status_word)
+        {
+            Lock lock(m_state);
+            update();
+
+            // Power drive state bits of the CiA 402 status word
+            switch (static_cast<smccore::Controller::PDSState>(m_state->pds_state)) {
+                case smccore::Controller::PDSState::READY_TO_SWITCH_ON:
+                    status_word = 0x0021;
+                    break;
+                case smccore::Controller::PDSState::SWITCHED_ON:
+                    status_word = 0x0023;
+                    break;
+                case smccore::Controller::PDSState::OPERATION_ENABLED:
+                    status_word = 0x0027;
+                    break;
+                case smccore::Controller::PDSState::QUICK_STOP_ACTIVE:
+                    status_word = 0x0007;
+                    break;
+                case smccore::Controller::PDSState::FAULT_REACTION_ACTIVE:
+                    status_word = 0x000F;
+                    break;
+                case smccore::Controller::PDSState::FAULT:
+                    status_word = 0x0008;
+                    break;
+                default:
+                    status_word = 0x0040;
+                    break;
+            }
+
+            // Target reached bit
+            bool reached = (static_cast<int32_t>(OperationMode::PROFILE_POSITION) == m_state->mode) ? m_state->target_reached
+                                                                                                  : (std::abs(m_state->speed_rpm - m_state->target_rpm) < 1.0);
+            if (reached) {
+                status_word |= 0x0400;
+            }
+
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::setOperationMode(OperationMode mode)
+        {
+            Lock lock(m_state);
+            update();
+
+            // A new mode starts from standstill setpoints, ramping down from the current speed
+            m_state->mode               = static_cast<int32_t>(mode);
+            m_state->target_rpm         = 0.0;
+            m_state->demand_rpm         = m_state->speed_rpm;
+            m_state->target_position_mm = m_state->position_mm;
+            m_state->target_reached     = true;
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s)
+        {
+            Lock lock(m_state);
+            update();
+            m_state->profile_velocity_rpm       = velocity_rpm;
+            m_state->profile_acceleration_rpm_s = acceleration_rpm_s;
+            m_state->profile_deceleration_rpm_s = deceleration_rpm_s;
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::startRelativeMove(int32_t distance_mm)
+        {
+            Lock lock(m_state);
+            update();
+
+            if (static_cast<int32_t>(OperationMode::PROFILE_POSITION) != m_state->mode) {
+                return DRIVE_ERROR_NOT_READY;
+            }
+
+            // Relative to the previous target, like the CiA 402 relative moves
+            m_state->target_position_mm += distance_mm;
+            m_state->target_reached = (0 == distance_mm);
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::setCommunicationTimeout(uint16_t timeout_ms)
+        {
+            Lock lock(m_state);
+            update();
+
+            // Counted from the configuration, like from a first heartbeat
+            m_state->heartbeat_timeout_ns = static_cast<int64_t>(timeout_ms) * 1000000;
+            m_state->last_heartbeat_ns    = static_cast<int64_t>(ros::Time::now().toNSec());
+            return ERROR_NONE;
+        }
+
+        ezw_error_t SimDrive::sendHeartbeat()
+        {
+            Lock lock(m_state);
+            update();
+            m_state->last_heartbeat_ns = static_cast<int64_t>(ros::Time::now().toNSec());
+            return ERROR_NONE;
+        }
+    } // namespace swd
+} // namespace ezw
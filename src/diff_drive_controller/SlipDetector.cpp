@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SlipDetector.cpp
+ */
+
+#include "diff_drive_controller/SlipDetector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ezw
+{
+    namespace swd
+    {
+        SlipDetector::SlipDetector(double response_time_s, double speed_tolerance_mps, double relative_tolerance, double yaw_rate_tolerance) :
+            m_response_time_s(response_time_s), m_speed_tolerance_mps(speed_tolerance_mps), m_relative_tolerance(relative_tolerance), m_yaw_rate_tolerance(yaw_rate_tolerance)
+        {
+        }
+
+        void SlipDetector::setRamps(double acceleration_mps2, double deceleration_mps2)
+        {
+            m_acceleration_mps2 = acceleration_mps2;
+            m_deceleration_mps2 = deceleration_mps2;
+        }
+
+        void SlipDetector::update(double left_cmd_mps, double right_cmd_mps, double left_mps, double right_mps, bool left_valid, bool right_valid, double dt)
+        {
+            // Velocity demand of the drives ramping the setpoints
+            m_left_ramped_mps  = ramp(m_left_ramped_mps, left_cmd_mps, dt);
+            m_right_ramped_mps = ramp(m_right_ramped_mps, right_cmd_mps, dt);
+
+            // First order response of the drives to their demand
+            double alpha = (m_response_time_s > 0.0) ? (1.0 - std::exp(-dt / m_response_time_s)) : 1.0;
+            m_left_expected_mps += alpha * (m_left_ramped_mps - m_left_expected_mps);
+            m_right_expected_mps += alpha * (m_right_ramped_mps - m_right_expected_mps);
+
+            // An extrapolated wheel keeps its previous state
+            if (left_valid) {
+                m_left_state = checkWheel(m_left_expected_mps, left_mps, m_left_error);
+            }
+
+            if (right_valid) {
+                m_right_state = checkWheel(m_right_expected_mps, right_mps, m_right_error);
+            }
+        }
+
+        void SlipDetector::reset()
+        {
+            // The wheels restart from rest with the next setpoints
+            m_left_ramped_mps    = 0.0;
+            m_right_ramped_mps   = 0.0;
+            m_left_expected_mps  = 0.0;
+            m_right_expected_mps = 0.0;
+            m_left_error         = 0.0;
+            m_right_error        = 0.0;
+            m_left_state         = WheelState::OK;
+            m_right_state        = WheelState::OK;
+        }
+
+        SlipDetector::WheelState SlipDetector::checkWheel(double expected_mps, double measured_mps, double &error) const
+        {
+            double tolerance = m_speed_tolerance_mps + m_relative_tolerance * std::abs(expected_mps);
+
+            error = measured_mps - expected_mps;
+
+            if (std::abs(error) <= tolerance) {
+                return WheelState::OK;
+            }
+
+            if ((std::abs(expected_mps) > tolerance) && (std::abs(measured_mps) < m_speed_tolerance_mps)) {
+                return WheelState::STALL;
+            }
+
+            return WheelState::SLIP;
+        }
+
+        double SlipDetector::ramp(double ramped_mps, double cmd_mps, double dt) const
+        {
+            if ((m_acceleration_mps2 <= 0.0) || (m_deceleration_mps2 <= 0.0)) {
+                return cmd_mps;
+            }
+
+            // Speeding up along the acceleration, slowing down or reversing along the deceleration
+            bool   accelerating = (ramped_mps * cmd_mps >= 0.0) && (std::abs(cmd_mps) > std::abs(ramped_mps));
+            double max_step     = (accelerating ? m_acceleration_mps2 : m_deceleration_mps2) * dt;
+
+            return ramped_mps + std::min(std::max(cmd_mps - ramped_mps, -max_step), max_step);
+        }
+
+        bool SlipDetector::checkYawRate(double wheels_yaw_rate, double imu_yaw_rate) const
+        {
+            return std::abs(wheels_yaw_rate - imu_yaw_rate) > m_yaw_rate_tolerance;
+        }
+
+        SlipDetector::WheelState SlipDetector::leftState() const
+        {
+            return m_left_state;
+        }
+
+        SlipDetector::WheelState SlipDetector::rightState() const
+        {
+            return m_right_state;
+        }
+
+        double SlipDetector::leftError() const
+        {
+            return m_left_error;
+        }
+
+        double SlipDetector::rightError() const
+        {
+            return m_right_error;
+        }
+
+        const char *SlipDetector::stateName(WheelState state)
+        {
+            switch (state) {
+                case WheelState::OK:
+                    return "ok";
+                case WheelState::SLIP:
+                    return "slip";
+                case WheelState::STALL:
+                    return "stall";
+            }
+            return "unknown";
+        }
+    } // namespace swd
+} // namespace ezw
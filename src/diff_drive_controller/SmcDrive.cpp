@@ -0,0 +1,168 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file SmcDrive.cpp
+ */
+
+#include "diff_drive_controller/SmcDrive.hpp"
+
+#include "ezw-smc-core/CANOpenDispatcher.hpp"
+#include "ezw-smc-core/Config.hpp"
+
+#include "ezw-canopen-service/DBusClient.hpp"
+
+#include <ros/console.h>
+
+namespace ezw
+{
+    namespace swd
+    {
+        ezw_error_t SmcDrive::init(const std::string &name, const std::string &config_file)
+        {
+            ezw_error_t err;
+
+            /* Config init */
+            auto lConfig = std::make_shared<ezw::smccore::Config>();
+            err          = lConfig->load(config_file);
+            if (err != ERROR_NONE) {
+                ROS_ERROR("Failed loading %s motor's config file <%s>, CONTEXT_ID: %d, EZW_ERR: SMCService : "
+                          "Config.init() return error code : %d",
+                          name.c_str(), config_file.c_str(), CON_APP, (int)err);
+                return err;
+            }
+
+            m_diameter_mm = lConfig->getDiameter();
+            m_reduction   = lConfig->getReduction();
+
+            /* CANOpenService client init */
+            auto lCOSClient = std::make_shared<ezw::canopenservice::DBusClient>();
+            err             = lCOSClient->init();
+            if (err != ERROR_NONE) {
+                ROS_ERROR("Failed initializing %s motor, CONTEXT_ID: %d, EZW_ERR: SMCService : "
+                          "COSDBusClient::init() return error code : %d",
+                          name.c_str(), lConfig->getContextId(), (int)err);
+                return err;
+            }
+
+            /* CANOpenDispatcher */
+            auto lCANOpenDispatcher = std::make_shared<ezw::smccore::CANOpenDispatcher>(lConfig, lCOSClient);
+            err                     = lCANOpenDispatcher->init();
+            if (err != ERROR_NONE) {
+                ROS_ERROR("Failed initializing %s motor, CONTEXT_ID: %d, EZW_ERR: SMCService : "
+                          "CANOpenDispatcher::init() return error code : %d",
+                          name.c_str(), lConfig->getContextId(), (int)err);
+                return err;
+            }
+
+            err = m_controller.init(lConfig, lCANOpenDispatcher);
+            if (ERROR_NONE != err) {
+                ROS_ERROR("Failed initializing %s motor, EZW_ERR: SMCService : "
+                          "Controller::init() return error code : %d",
+                          name.c_str(), (int)err);
+                return err;
+            }
+
+            return ERROR_NONE;
+        }
+
+        double SmcDrive::getDiameter() const
+        {
+            return m_diameter_mm;
+        }
+
+        double SmcDrive::getReduction() const
+        {
+            return m_reduction;
+        }
+
+        ezw_error_t SmcDrive::getOdometryValue(int32_t &dist_mm)
+        {
+            return m_controller.getOdometryValue(dist_mm);
+        }
+
+        ezw_error_t SmcDrive::getNMTState(smccore::Controller::NMTState &state)
+        {
+            return m_controller.getNMTState(state);
+        }
+
+        ezw_error_t SmcDrive::setNMTState(smccore::Controller::NMTCommand command)
+        {
+            return m_controller.setNMTState(command);
+        }
+
+        ezw_error_t SmcDrive::getPDSState(smccore::Controller::PDSState &state)
+        {
+            return m_controller.getPDSState(state);
+        }
+
+        ezw_error_t SmcDrive::enterInOperationEnabledState()
+        {
+            return m_controller.enterInOperationEnabledState();
+        }
+
+        ezw_error_t SmcDrive::setHalt(bool halt)
+        {
+            return m_controller.setHalt(halt);
+        }
+
+        ezw_error_t SmcDrive::setTargetVelocity(int32_t speed_rpm)
+        {
+            return m_controller.setTargetVelocity(speed_rpm);
+        }
+
+        ezw_error_t SmcDrive::getSafetyFunctionCommand(smccore::Controller::SafetyFunctionId id, bool &value)
+        {
+            return m_controller.getSafetyFunctionCommand(id, value);
+        }
+
+        ezw_error_t SmcDrive::getVelocityDemand(int32_t &speed_rpm)
+        {
+            (void)speed_rpm;
+
+            // Not exposed by the SMC core API
+            return DRIVE_ERROR_NOT_SUPPORTED;
+        }
+
+        ezw_error_t SmcDrive::getStatusWord(uint16_t &status_word)
+        {
+            (void)status_word;
+
+            return DRIVE_ERROR_NOT_SUPPORTED;
+        }
+
+        ezw_error_t SmcDrive::setOperationMode(OperationMode mode)
+        {
+            // The SMC core only drives the wheels in velocity mode
+            return (OperationMode::VELOCITY == mode) ? ERROR_NONE : DRIVE_ERROR_NOT_SUPPORTED;
+        }
+
+        ezw_error_t SmcDrive::setProfile(uint32_t velocity_rpm, uint32_t acceleration_rpm_s, uint32_t deceleration_rpm_s)
+        {
+            (void)velocity_rpm;
+            (void)acceleration_rpm_s;
+            (void)deceleration_rpm_s;
+
+            return DRIVE_ERROR_NOT_SUPPORTED;
+        }
+
+        ezw_error_t SmcDrive::startRelativeMove(int32_t distance_mm)
+        {
+            (void)distance_mm;
+
+            return DRIVE_ERROR_NOT_SUPPORTED;
+        }
+
+        ezw_error_t SmcDrive::setCommunicationTimeout(uint16_t timeout_ms)
+        {
+            (void)timeout_ms;
+
+            // The heartbeats are handled by the CANOpen service, out of reach of the SMC core API
+            return DRIVE_ERROR_NOT_SUPPORTED;
+        }
+
+        ezw_error_t SmcDrive::sendHeartbeat()
+        {
+            return DRIVE_ERROR_NOT_SUPPORTED;
+        }
+    } // namespace swd
+} // namespace ezw
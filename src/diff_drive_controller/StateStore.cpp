@@ -0,0 +1,174 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file StateStore.cpp
+ */
+
+#include "diff_drive_controller/StateStore.hpp"
+#include "diff_drive_controller/SharedMemory.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ros/console.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define STATE_STORE_MAGIC 0x53574431 // "SWD1"
+
+namespace ezw
+{
+    namespace swd
+    {
+        StateStore::~StateStore()
+        {
+            unmapMemory(m_segment, sizeof(Segment));
+        }
+
+        bool StateStore::openShared(const std::string &name)
+        {
+            bool created;
+            m_segment = static_cast<Segment *>(mapSharedMemory(name, sizeof(Segment), created));
+
+            if (nullptr == m_segment) {
+                return false;
+            }
+
+            if (created) {
+                // Freshly created objects are zero-filled: no owner, no state published
+                m_segment->magic.store(STATE_STORE_MAGIC, std::memory_order_release);
+                return true;
+            }
+
+            for (int i = 0; STATE_STORE_MAGIC != m_segment->magic.load(std::memory_order_acquire); ++i) {
+                if (i >= 100) {
+                    ROS_ERROR("Shared state '%s' has not been initialized", name.c_str());
+                    unmapMemory(m_segment, sizeof(Segment));
+                    m_segment = nullptr;
+                    return false;
+                }
+                usleep(10000);
+            }
+
+            return true;
+        }
+
+        bool StateStore::openFile(const std::string &path)
+        {
+            bool created;
+            m_segment = static_cast<Segment *>(mapFile(path, sizeof(Segment), created));
+
+            if (nullptr == m_segment) {
+                return false;
+            }
+
+            if (created || (STATE_STORE_MAGIC != m_segment->magic.load(std::memory_order_acquire))) {
+                std::memset(static_cast<void *>(m_segment), 0, sizeof(Segment));
+                m_segment->magic.store(STATE_STORE_MAGIC, std::memory_order_release);
+            }
+
+            // The owner of a previous run is meaningless
+            m_segment->owner_pid.store(0, std::memory_order_release);
+
+            return true;
+        }
+
+        bool StateStore::isOpen() const
+        {
+            return nullptr != m_segment;
+        }
+
+        void StateStore::write(const ControllerState &state)
+        {
+            uint32_t seq = m_segment->seq.load(std::memory_order_relaxed);
+
+            // Odd sequence: write in progress
+            m_segment->seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&m_segment->state, &state, sizeof(ControllerState));
+            m_segment->seq.store(seq + 2, std::memory_order_release);
+        }
+
+        bool StateStore::read(ControllerState &state) const
+        {
+            // Bounded, a writer may have died in the middle of a write
+            for (int i = 0; i < 1000; ++i) {
+                uint32_t seq_begin = m_segment->seq.load(std::memory_order_acquire);
+                if (0 == seq_begin) {
+                    return false;
+                }
+
+                if (seq_begin & 1) {
+                    continue;
+                }
+
+                std::memcpy(&state, &m_segment->state, sizeof(ControllerState));
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (m_segment->seq.load(std::memory_order_relaxed) == seq_begin) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool StateStore::tryAcquire(int64_t timeout_ns)
+        {
+            int32_t self  = static_cast<int32_t>(getpid());
+            int32_t owner = m_segment->owner_pid.load(std::memory_order_acquire);
+
+            if (self == owner) {
+                return true;
+            }
+
+            if ((0 != owner) && ownerAlive(timeout_ns)) {
+                return false;
+            }
+
+            // Several standbys may race for the ownership, only one wins
+            if (!m_segment->owner_pid.compare_exchange_strong(owner, self, std::memory_order_acq_rel)) {
+                return false;
+            }
+
+            heartbeat();
+            return true;
+        }
+
+        bool StateStore::isOwner() const
+        {
+            return static_cast<int32_t>(getpid()) == m_segment->owner_pid.load(std::memory_order_acquire);
+        }
+
+        bool StateStore::ownerAlive(int64_t timeout_ns) const
+        {
+            int32_t owner = m_segment->owner_pid.load(std::memory_order_acquire);
+
+            if (0 == owner) {
+                return false;
+            }
+
+            // A crashed owner is detected immediately, a stalled one by its heartbeat
+            if ((0 != kill(owner, 0)) && (ESRCH == errno)) {
+                return false;
+            }
+
+            return heartbeatAgeNs() <= timeout_ns;
+        }
+
+        void StateStore::heartbeat()
+        {
+            m_segment->heartbeat_ns.store(monotonicNs(), std::memory_order_release);
+        }
+
+        int64_t StateStore::heartbeatAgeNs() const
+        {
+            return monotonicNs() - m_segment->heartbeat_ns.load(std::memory_order_acquire);
+        }
+
+        int64_t StateStore::monotonicNs()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    } // namespace swd
+} // namespace ezw
@@ -5,6 +5,7 @@
  */
 
 #include <diff_drive_controller/DiffDriveController.hpp>
+#include <diff_drive_controller/SimClock.hpp>
 
 #include <cstdlib>
 #include <ros/console.h>
@@ -12,6 +13,8 @@
 
 using namespace std::chrono_literals;
 
+#define DEFAULT_SIM_CLOCK_STEP_MS 1.0
+
 int main(int argc, char **argv)
 {
     ros::init(argc, argv,
@@ -28,6 +31,28 @@ int main(int argc, char **argv)
 
     ROS_INFO("Ready !");
 
+    // Faster than real time simulation, this node drives the ROS clock. /use_sim_time has to be set
+    // before the first node handle is created, roscpp only reads it once.
+    double sim_time_factor   = DEFAULT_SIM_TIME_FACTOR;
+    double sim_clock_step_ms = DEFAULT_SIM_CLOCK_STEP_MS;
+    ros::param::get("~sim_time_factor", sim_time_factor);
+    ros::param::get("~sim_clock_step_ms", sim_clock_step_ms);
+
+    std::unique_ptr<ezw::swd::SimClock> sim_clock;
+    if (sim_time_factor > 0.) {
+        if (sim_clock_step_ms <= 0.) {
+            ROS_WARN("Invalid value %f for parameter 'sim_clock_step_ms', it should be a positive value. "
+                     "Falling back to default (%f)",
+                     sim_clock_step_ms, DEFAULT_SIM_CLOCK_STEP_MS);
+            sim_clock_step_ms = DEFAULT_SIM_CLOCK_STEP_MS;
+        }
+
+        ros::param::set("/use_sim_time", true);
+        sim_clock = std::make_unique<ezw::swd::SimClock>(sim_time_factor, sim_clock_step_ms / 1000.0);
+        sim_clock->start();
+        ROS_INFO("Publishing the simulated clock at %.1f times real time.", sim_time_factor);
+    }
+
     auto nh = std::make_shared<ros::NodeHandle>("~");
     try {
         ezw::swd::DiffDriveController diffDriveController(nh);
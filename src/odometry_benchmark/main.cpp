@@ -0,0 +1,357 @@
+/**
+ * Copyright (C) 2021 ez-Wheel S.A.S.
+ *
+ * @file main.cpp
+ *
+ * Accuracy versus cost of the odometry integration, offline and without any drive.
+ * Ground truth trajectories are sampled into encoder streams, the way the controller
+ * reads them (1 mm quantisation, timing jitter, delay between the two wheels), and
+ * integrated at several rates with each scheme of the OdometryIntegrator.
+ */
+
+#include <diff_drive_controller/OdometryIntegrator.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#define DEFAULT_JITTER_MS  1.0
+#define DEFAULT_SKEW_MS    0.5
+#define DEFAULT_SEED       42
+#define DEFAULT_BASELINE_M 0.5
+#define DEFAULT_BUDGET_MM  0.0 // No budget
+
+// Resolution of the ground truth
+#define TRUTH_STEP_S 1e-4
+
+// Relative error of the encoders, as the controller's default
+#define ENCODER_RELATIVE_ERROR 0.05
+
+// Integration runs are repeated until they used this CPU time, to be above the clock resolution
+#define MIN_CPU_TIME_NS 20000000
+
+using ezw::swd::OdometryIntegrator;
+using ezw::swd::OdometryPose;
+
+namespace
+{
+    struct Options {
+        double   jitter_ms  = DEFAULT_JITTER_MS;
+        double   skew_ms    = DEFAULT_SKEW_MS;
+        unsigned seed       = DEFAULT_SEED;
+        double   baseline_m = DEFAULT_BASELINE_M;
+        double   budget_mm  = DEFAULT_BUDGET_MM;
+    };
+
+    /**
+     * @brief Commanded base speeds (m/s, rad/s) over time
+     */
+    struct Trajectory {
+        const char                                     *name;
+        double                                          duration_s;
+        std::function<void(double, double &, double &)> speeds;
+    };
+
+    /**
+     * @brief Ground truth on a fine time grid: the wheels' travelled distances and the base pose
+     */
+    class Truth {
+      public:
+        Truth(const Trajectory &trajectory, double baseline_m)
+        {
+            size_t n = static_cast<size_t>(std::ceil(trajectory.duration_s / TRUTH_STEP_S)) + 1;
+            m_left.resize(n);
+            m_right.resize(n);
+            m_pose.resize(n);
+
+            m_left[0] = m_right[0] = 0.0;
+            m_pose[0]              = OdometryPose();
+
+            double theta = 0.0;
+            for (size_t i = 1; i < n; i++) {
+                // Speeds at the middle of the step
+                double linear, angular;
+                trajectory.speeds((i - 0.5) * TRUTH_STEP_S, linear, angular);
+
+                m_left[i]  = m_left[i - 1] + (linear - angular * baseline_m / 2.0) * TRUTH_STEP_S;
+                m_right[i] = m_right[i - 1] + (linear + angular * baseline_m / 2.0) * TRUTH_STEP_S;
+
+                double heading = theta + angular * TRUTH_STEP_S / 2.0;
+                m_pose[i].x    = m_pose[i - 1].x + linear * TRUTH_STEP_S * std::cos(heading);
+                m_pose[i].y    = m_pose[i - 1].y + linear * TRUTH_STEP_S * std::sin(heading);
+                theta += angular * TRUTH_STEP_S;
+                m_pose[i].theta = theta; // Unbounded
+            }
+        }
+
+        double duration() const
+        {
+            return (m_pose.size() - 1) * TRUTH_STEP_S;
+        }
+
+        double left(double t) const
+        {
+            return interpolate(m_left, t);
+        }
+
+        double right(double t) const
+        {
+            return interpolate(m_right, t);
+        }
+
+        void pose(double t, double &x, double &y, double &theta) const
+        {
+            size_t i;
+            double a;
+            locate(t, i, a);
+
+            x     = m_pose[i].x + a * (m_pose[i + 1].x - m_pose[i].x);
+            y     = m_pose[i].y + a * (m_pose[i + 1].y - m_pose[i].y);
+            theta = m_pose[i].theta + a * (m_pose[i + 1].theta - m_pose[i].theta);
+        }
+
+      private:
+        void locate(double t, size_t &i, double &a) const
+        {
+            double pos = std::min(std::max(t, 0.0), duration()) / TRUTH_STEP_S;
+            i          = std::min(static_cast<size_t>(pos), m_pose.size() - 2);
+            a          = pos - i;
+        }
+
+        double interpolate(const std::vector<double> &values, double t) const
+        {
+            size_t i;
+            double a;
+            locate(t, i, a);
+            return values[i] + a * (values[i + 1] - values[i]);
+        }
+
+        std::vector<double>       m_left, m_right;
+        std::vector<OdometryPose> m_pose;
+    };
+
+    /**
+     * @brief One read of both encoders, as the controller sees it
+     */
+    struct EncoderSample {
+        double  stamp_s;           // Read time of the left wheel, stamp of the odometry
+        int32_t left_mm, right_mm; // Quantised like the drives' position feedback
+    };
+
+    std::vector<EncoderSample> synthesise(const Truth &truth, double rate_hz, const Options &options, std::mt19937 &rng)
+    {
+        std::normal_distribution<double> jitter(0.0, options.jitter_ms / 1000.0);
+        double                           skew_s = options.skew_ms / 1000.0;
+        double                           period = 1.0 / rate_hz;
+
+        std::vector<EncoderSample> samples;
+        double                     prev_s = 0.0;
+        for (size_t k = 1; k * period <= truth.duration() - skew_s; k++) {
+            // Jittered, but the reads stay ordered
+            double t = std::min(std::max(k * period + jitter(rng), prev_s + 1e-6), truth.duration() - skew_s);
+            prev_s   = t;
+
+            EncoderSample sample;
+            sample.stamp_s  = t;
+            sample.left_mm  = static_cast<int32_t>(std::lround(truth.left(t) * 1000.0));
+            sample.right_mm = static_cast<int32_t>(std::lround(truth.right(t + skew_s) * 1000.0));
+            samples.push_back(sample);
+        }
+
+        return samples;
+    }
+
+    struct Result {
+        size_t samples            = 0;
+        double final_error_mm     = 0.0;
+        double max_error_mm       = 0.0;
+        double heading_error_mrad = 0.0;
+        double cpu_ns_per_sample  = 0.0;
+    };
+
+    int64_t cpuTimeNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    /**
+     * @brief Integrate the encoder stream, the same way as DiffDriveController::cbTimerOdom
+     * @param[out] poses Pose after each sample, may be null
+     */
+    OdometryPose integrate(const OdometryIntegrator &integrator, const std::vector<EncoderSample> &samples, double baseline_m, std::vector<OdometryPose> *poses)
+    {
+        OdometryPose pose;
+        int32_t      left_prev_mm = 0, right_prev_mm = 0;
+
+        for (const EncoderSample &sample : samples) {
+            double d_left  = (sample.left_mm - left_prev_mm) / 1000.0;
+            double d_right = (sample.right_mm - right_prev_mm) / 1000.0;
+
+            double d_center, d_theta, d_center_err, d_theta_err;
+            OdometryIntegrator::kinematics(d_left, d_right, ENCODER_RELATIVE_ERROR * std::abs(d_left), ENCODER_RELATIVE_ERROR * std::abs(d_right), baseline_m, d_center,
+                                           d_theta, d_center_err, d_theta_err);
+            pose = integrator.step(pose, d_center, d_theta, d_center_err, d_theta_err);
+
+            if (poses) {
+                poses->push_back(pose);
+            }
+
+            left_prev_mm  = sample.left_mm;
+            right_prev_mm = sample.right_mm;
+        }
+
+        return pose;
+    }
+
+    Result run(const Truth &truth, const std::vector<EncoderSample> &samples, OdometryIntegrator::Scheme scheme, double baseline_m)
+    {
+        OdometryIntegrator integrator(scheme);
+        Result             result;
+        result.samples = samples.size();
+
+        // Accuracy, against the ground truth at the stamp of each sample
+        std::vector<OdometryPose> poses;
+        poses.reserve(samples.size());
+        integrate(integrator, samples, baseline_m, &poses);
+
+        for (size_t k = 0; k < samples.size(); k++) {
+            double x, y, theta;
+            truth.pose(samples[k].stamp_s, x, y, theta);
+
+            double error_mm     = 1000.0 * std::hypot(poses[k].x - x, poses[k].y - y);
+            result.max_error_mm = std::max(result.max_error_mm, error_mm);
+
+            if (samples.size() - 1 == k) {
+                result.final_error_mm     = error_mm;
+                result.heading_error_mrad = 1000.0 * std::abs(std::remainder(poses[k].theta - theta, 2. * M_PI));
+            }
+        }
+
+        // Cost, of the integration only
+        size_t  runs  = 0;
+        double  sink  = 0.0;
+        int64_t start = cpuTimeNs();
+        int64_t elapsed;
+        do {
+            sink += integrate(integrator, samples, baseline_m, nullptr).x;
+            runs++;
+            elapsed = cpuTimeNs() - start;
+        } while (elapsed < MIN_CPU_TIME_NS);
+
+        // Keeps the runs from being optimised out
+        if (std::isnan(sink)) {
+            std::fprintf(stderr, "Diverged integration\n");
+        }
+
+        result.cpu_ns_per_sample = samples.empty() ? 0.0 : static_cast<double>(elapsed) / (runs * samples.size());
+        return result;
+    }
+
+    bool parseOption(const char *arg, const char *name, double &value)
+    {
+        size_t len = std::strlen(name);
+        if ((0 != std::strncmp(arg, name, len)) || ('=' != arg[len])) {
+            return false;
+        }
+
+        char *end;
+        value = std::strtod(arg + len + 1, &end);
+        return (end != arg + len + 1) && ('\0' == *end);
+    }
+
+    void usage(const char *program)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--jitter-ms=%.1f] [--skew-ms=%.1f] [--seed=%d] [--baseline-m=%.2f] [--budget-mm=<mm>]\n"
+                     "  --jitter-ms   Standard deviation of the sampling instants\n"
+                     "  --skew-ms     Delay between the reads of the left and right encoders\n"
+                     "  --seed        Seed of the jitter, runs are reproducible\n"
+                     "  --baseline-m  Distance between the wheels\n"
+                     "  --budget-mm   Maximum position error, prints the lowest rate within it\n",
+                     program, DEFAULT_JITTER_MS, DEFAULT_SKEW_MS, DEFAULT_SEED, DEFAULT_BASELINE_M);
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        double seed = options.seed;
+        if (!parseOption(argv[i], "--jitter-ms", options.jitter_ms) && !parseOption(argv[i], "--skew-ms", options.skew_ms) &&
+            !parseOption(argv[i], "--baseline-m", options.baseline_m) && !parseOption(argv[i], "--budget-mm", options.budget_mm) &&
+            !parseOption(argv[i], "--seed", seed)) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        options.seed = static_cast<unsigned>(seed);
+    }
+
+    if ((options.jitter_ms < 0.) || (options.skew_ms < 0.) || (options.baseline_m <= 0.) || (options.budget_mm < 0.)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::vector<Trajectory> trajectories = {
+        {"straight", 20.0, [](double, double &v, double &w) { v = 1.0, w = 0.0; }},
+        {"arc", 20.0, [](double, double &v, double &w) { v = 0.8, w = 0.4; }},
+        {"spin", 20.0, [](double, double &v, double &w) { v = 0.0, w = 1.0; }},
+        {"s_curve", 24.0, [](double t, double &v, double &w) { v = 0.8, w = 0.6 * std::sin(2. * M_PI * t / 8.0); }},
+    };
+    const std::vector<double>                     rates_hz = {10, 20, 25, 50, 100, 200};
+    const std::vector<OdometryIntegrator::Scheme> schemes  = {OdometryIntegrator::Scheme::EULER, OdometryIntegrator::Scheme::MIDPOINT, OdometryIntegrator::Scheme::EXACT};
+
+    std::printf("# jitter %.2f ms, skew %.2f ms, seed %u, baseline %.3f m\n", options.jitter_ms, options.skew_ms, options.seed, options.baseline_m);
+    std::printf("%-10s %-9s %8s %8s %12s %12s %14s %12s\n", "trajectory", "scheme", "rate_hz", "samples", "final_mm", "max_mm", "heading_mrad", "cpu_ns");
+
+    // Lowest rate within the budget, per trajectory and scheme
+    std::map<std::pair<std::string, std::string>, double> lowest_rate;
+
+    for (const Trajectory &trajectory : trajectories) {
+        Truth truth(trajectory, options.baseline_m);
+
+        for (double rate_hz : rates_hz) {
+            // Same encoder stream for all the schemes
+            std::mt19937               rng(options.seed);
+            std::vector<EncoderSample> samples = synthesise(truth, rate_hz, options, rng);
+
+            for (OdometryIntegrator::Scheme scheme : schemes) {
+                Result result = run(truth, samples, scheme, options.baseline_m);
+                std::printf("%-10s %-9s %8.0f %8zu %12.2f %12.2f %14.3f %12.1f\n", trajectory.name, OdometryIntegrator::schemeName(scheme), rate_hz, result.samples,
+                            result.final_error_mm, result.max_error_mm, result.heading_error_mrad, result.cpu_ns_per_sample);
+
+                auto key = std::make_pair(std::string(trajectory.name), std::string(OdometryIntegrator::schemeName(scheme)));
+                if ((options.budget_mm > 0.) && (result.max_error_mm <= options.budget_mm) && (0 == lowest_rate.count(key))) {
+                    lowest_rate[key] = rate_hz;
+                }
+            }
+        }
+    }
+
+    if (options.budget_mm > 0.) {
+        std::printf("\n# Lowest rate with a maximum position error within %.2f mm\n", options.budget_mm);
+        for (const Trajectory &trajectory : trajectories) {
+            for (OdometryIntegrator::Scheme scheme : schemes) {
+                auto key = std::make_pair(std::string(trajectory.name), std::string(OdometryIntegrator::schemeName(scheme)));
+                auto it  = lowest_rate.find(key);
+                if (lowest_rate.end() == it) {
+                    std::printf("%-10s %-9s none\n", trajectory.name, key.second.c_str());
+                } else {
+                    std::printf("%-10s %-9s %.0f Hz\n", trajectory.name, key.second.c_str(), it->second);
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}